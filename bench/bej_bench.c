@@ -0,0 +1,517 @@
+/** @file bej_bench.c
+ *  @brief Decoder benchmark suite:
+ *         bej_bench -s <schema.bin> [-b <payload.bej>]... [-g <shape>[:n] | -g all]...
+ *                   [-n iterations | -T seconds] [-j threads] [-o results.txt] [-c baseline.txt [-t percent]]
+ *         bej_bench -s <schema.bin> -g <shape>[:n] -w <out.bej>
+ *         bej_bench -s <schema.bin> -B <list.txt|dir> -O <out_dir> [-j threads] [-n iterations | -T seconds]
+ *
+ *  Every payload is run through a bare tuple walk, bej_validate,
+ *  bej_index_build, bej_decode_to_json (to /dev/null), bej_decode_to_buffer,
+ *  bej_decode_to_arena (reset between runs), bej_decode_parallel on -j
+ *  threads (default: one per core, to /dev/null), bej_decode_to_cbor and
+ *  bej_decode_to_msgpack (to /dev/null), and bej_decode_delta against a copy
+ *  whose last byte differs (one leaf changed, to /dev/null), and
+ *  bej_cache_decode with the payload already cached (hits, to /dev/null);
+ *  the dictionary through dict_load.
+ *  Rows report MB/s, properties/s, allocations per run and peak RSS; a size
+ *  line compares the JSON, CBOR and MessagePack output bytes.
+ *  With -B the files of a corpus are converted into -O by batch_decode (one
+ *  worker per file) and by batch_pipeline (read, decode and write stages),
+ *  and each row reports files/s and MB/s.
+ *  -o saves each row's input MB/s; -c compares against such a file and exits
+ *  with 1 when a row is more than -t percent (default 10) slower.
+ */
+
+#define _DEFAULT_SOURCE
+#include "batch.h"
+#include "bej.h"
+#include "bej_binary.h"
+#include "bej_cache.h"
+#include "bej_delta.h"
+#include "bej_index.h"
+#include "bej_gen.h"
+#include "dict.h"
+#include "io.h"
+#include "pool.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef BEJ_BENCH_COUNT_ALLOCS
+/* Linked with -Wl,--wrap so the library's heap calls pass through here. */
+static size_t alloc_count;
+void* __real_malloc(size_t n);
+void* __real_calloc(size_t n, size_t m);
+void* __real_realloc(void* p, size_t n);
+void* __wrap_malloc(size_t n) { alloc_count++; return __real_malloc(n); }
+void* __wrap_calloc(size_t n, size_t m) { alloc_count++; return __real_calloc(n, m); }
+void* __wrap_realloc(void* p, size_t n) { alloc_count++; return __real_realloc(p, n); }
+#endif
+
+#define MAX_RESULTS 128
+
+typedef struct {
+    char   key[64];
+    double mbps;
+} result_t;
+
+static result_t results[MAX_RESULTS];
+static size_t nresults;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static long peak_rss_kib(void) {
+    struct rusage ru;
+    return getrusage(RUSAGE_SELF, &ru) == 0 ? ru.ru_maxrss : -1;
+}
+
+typedef struct {
+    const bej_dictionary_t* dict;
+    const char* dict_path;
+    const uint8_t* bej;
+    size_t  bej_sz;
+    const uint8_t* prev;    /* bej with its last byte changed, for the delta row */
+    bej_cache_t* cache;     /* holding bej, for the cache row */
+    FILE*   devnull;
+    uint64_t tuples;
+    bej_arena_t arena;
+    int     threads;
+} bench_ctx_t;
+
+typedef int (*bench_fn)(bench_ctx_t* c);
+
+/* Walks one value, counting SFL tuples; containers recurse, leaves are skipped. */
+static int walk_value(bej_stream_t* s, uint64_t* tuples) {
+    uint64_t seq = 0, len = 0; uint8_t fmt = 0, flags = 0;
+    if (bej_read_sfl(s, &seq, &fmt, &len, &flags) != 0) return -1;
+    ++*tuples;
+    if (fmt == BEJ_FMT_SET || fmt == BEJ_FMT_ARRAY) {
+        uint64_t count = 0;
+        if (bej_read_nnint(s, &count) != 0) return -1;
+        for (uint64_t i = 0; i < count; ++i)
+            if (walk_value(s, tuples) != 0) return -1;
+        return 0;
+    }
+    if (len > s->size - s->pos) return -1;
+    s->pos += (size_t)len;
+    return 0;
+}
+
+static int count_tuples(const uint8_t* bej, size_t sz, uint64_t* tuples) {
+    bej_stream_t s;
+    if (sz < 7) return -1;
+    bej_stream_init(&s, bej + 7, sz - 7);
+    *tuples = 0;
+    return walk_value(&s, tuples);
+}
+
+static int run_walk(bench_ctx_t* c) {
+    uint64_t t;
+    return count_tuples(c->bej, c->bej_sz, &t);
+}
+
+static int run_validate(bench_ctx_t* c) {
+    return bej_validate(c->bej, c->bej_sz, c->dict, NULL);
+}
+
+static int run_index(bench_ctx_t* c) {
+    bej_index_t* idx = NULL;
+    int rc = bej_index_build(c->bej, c->bej_sz, &idx);
+    bej_index_free(idx);
+    return rc;
+}
+
+static int run_json(bench_ctx_t* c) {
+    return bej_decode_to_json(c->devnull, c->bej, c->bej_sz, c->dict);
+}
+
+static int run_buffer(bench_ctx_t* c) {
+    char* json = NULL;
+    int rc = bej_decode_to_buffer(c->bej, c->bej_sz, c->dict, &json, NULL);
+    free(json);
+    return rc;
+}
+
+static int run_arena(bench_ctx_t* c) {
+    char* json = NULL;
+    bej_arena_reset(&c->arena);
+    return bej_decode_to_arena(c->bej, c->bej_sz, c->dict, &c->arena, &json, NULL);
+}
+
+static int run_parallel(bench_ctx_t* c) {
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    if (bej_sink_init_file(&sink, c->devnull, buf, sizeof(buf)) != 0) return -1;
+    int rc = bej_decode_parallel(&sink, c->bej, c->bej_sz, c->dict, c->threads, NULL);
+    if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+    bej_sink_free(&sink);
+    return rc;
+}
+
+static int run_binary(bench_ctx_t* c, int msgpack) {
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    if (bej_sink_init_file(&sink, c->devnull, buf, sizeof(buf)) != 0) return -1;
+    int rc = msgpack ? bej_decode_to_msgpack(&sink, c->bej, c->bej_sz, c->dict, NULL)
+        : bej_decode_to_cbor(&sink, c->bej, c->bej_sz, c->dict, NULL);
+    if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+    bej_sink_free(&sink);
+    return rc;
+}
+
+static int run_cbor(bench_ctx_t* c) { return run_binary(c, 0); }
+static int run_msgpack(bench_ctx_t* c) { return run_binary(c, 1); }
+
+static int run_delta(bench_ctx_t* c) {
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    if (bej_sink_init_file(&sink, c->devnull, buf, sizeof(buf)) != 0) return -1;
+    int rc = bej_decode_delta(&sink, c->prev, c->bej_sz, c->bej, c->bej_sz, c->dict);
+    if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+    bej_sink_free(&sink);
+    return rc;
+}
+
+static int run_cache(bench_ctx_t* c) {
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    if (bej_sink_init_file(&sink, c->devnull, buf, sizeof(buf)) != 0) return -1;
+    int rc = bej_cache_decode(c->cache, &sink, c->bej, c->bej_sz, c->dict);
+    if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+    bej_sink_free(&sink);
+    return rc;
+}
+
+/* Output size of bej_decode_delta, 0 on failure. */
+static size_t delta_size(bench_ctx_t* c) {
+    bej_sink_t sink;
+    if (bej_sink_init_mem(&sink, 256) != 0) return 0;
+    size_t n = bej_decode_delta(&sink, c->prev, c->bej_sz, c->bej, c->bej_sz, c->dict) == 0 ? sink.len : 0;
+    bej_sink_free(&sink);
+    return n;
+}
+
+/* Output size of bej_decode_to_cbor or bej_decode_to_msgpack, 0 on failure. */
+static size_t binary_size(bench_ctx_t* c, int msgpack) {
+    bej_sink_t sink;
+    if (bej_sink_init_mem(&sink, c->bej_sz * 2 + 256) != 0) return 0;
+    int rc = msgpack ? bej_decode_to_msgpack(&sink, c->bej, c->bej_sz, c->dict, NULL)
+        : bej_decode_to_cbor(&sink, c->bej, c->bej_sz, c->dict, NULL);
+    size_t n = rc == 0 ? sink.len : 0;
+    bej_sink_free(&sink);
+    return n;
+}
+
+static int run_dict_load(bench_ctx_t* c) {
+    bej_dictionary_t d;
+    if (dict_load(c->dict_path, &d) != 0) return -1;
+    dict_free(&d);
+    return 0;
+}
+
+/* Runs @p fn for @p iters iterations, or until @p min_secs have passed when iters is 0. */
+static int measure(const char* label, const char* row, bench_fn fn, bench_ctx_t* c,
+    int iters, double min_secs, size_t in_sz, size_t out_sz, uint64_t props) {
+#ifdef BEJ_BENCH_COUNT_ALLOCS
+    size_t a0 = alloc_count;
+#endif
+    int n = 0;
+    double t0 = now_sec(), secs;
+    do {
+        if (fn(c) != 0) { fprintf(stderr, "%s.%s failed\n", label, row); return -1; }
+        ++n;
+        secs = now_sec() - t0;
+    } while (iters ? n < iters : secs < min_secs);
+
+    double in_mbps = (double)in_sz * n / (1024.0 * 1024.0) / secs;
+    double out_mbps = (double)out_sz * n / (1024.0 * 1024.0) / secs;
+    printf("%-14s %-9s %8d  %9.1f MB/s in  %9.1f MB/s out  %8.2f M props/s", label, row, n,
+        in_mbps, out_mbps, (double)props * n / secs / 1e6);
+#ifdef BEJ_BENCH_COUNT_ALLOCS
+    printf("  %9.1f allocs", (double)(alloc_count - a0) / n);
+#else
+    printf("  %9s allocs", "n/a");
+#endif
+    printf("  %8ld KiB peak\n", peak_rss_kib());
+
+    if (nresults < MAX_RESULTS) {
+        snprintf(results[nresults].key, sizeof(results[nresults].key), "%s.%s", label, row);
+        results[nresults++].mbps = in_mbps;
+    }
+    return 0;
+}
+
+static int bench_payload(const char* label, bench_ctx_t* c, int iters, double min_secs) {
+    char* json = NULL; size_t json_sz = 0;
+    if (count_tuples(c->bej, c->bej_sz, &c->tuples) != 0
+        || bej_decode_to_buffer(c->bej, c->bej_sz, c->dict, &json, &json_sz) != 0) {
+        fprintf(stderr, "%s: payload does not decode\n", label);
+        free(json);
+        return -1;
+    }
+    free(json);
+    int rc = 0;
+    rc |= measure(label, "walk", run_walk, c, iters, min_secs, c->bej_sz, 0, c->tuples);
+    if (bej_validate(c->bej, c->bej_sz, c->dict, NULL) == 0)
+        rc |= measure(label, "validate", run_validate, c, iters, min_secs, c->bej_sz, 0, c->tuples);
+    rc |= measure(label, "index", run_index, c, iters, min_secs, c->bej_sz, 0, c->tuples);
+    rc |= measure(label, "json", run_json, c, iters, min_secs, c->bej_sz, json_sz, c->tuples);
+    rc |= measure(label, "buffer", run_buffer, c, iters, min_secs, c->bej_sz, json_sz, c->tuples);
+    void* mem = malloc(json_sz + 64);
+    if (!mem) return -1;
+    bej_arena_init(&c->arena, mem, json_sz + 64);
+    rc |= measure(label, "arena", run_arena, c, iters, min_secs, c->bej_sz, json_sz, c->tuples);
+    free(mem);
+    rc |= measure(label, "parallel", run_parallel, c, iters, min_secs, c->bej_sz, json_sz, c->tuples);
+    size_t cbor_sz = binary_size(c, 0), msgpack_sz = binary_size(c, 1);
+    rc |= measure(label, "cbor", run_cbor, c, iters, min_secs, c->bej_sz, cbor_sz, c->tuples);
+    rc |= measure(label, "msgpack", run_msgpack, c, iters, min_secs, c->bej_sz, msgpack_sz, c->tuples);
+    printf("%-14s %-9s json %zu B, cbor %zu B (%.0f%%), msgpack %zu B (%.0f%%)\n", label, "size",
+        json_sz, cbor_sz, 100.0 * (double)cbor_sz / (double)json_sz,
+        msgpack_sz, 100.0 * (double)msgpack_sz / (double)json_sz);
+
+    /* The previous poll: the same payload with its last value byte changed. */
+    uint8_t* prev = (uint8_t*)malloc(c->bej_sz);
+    if (!prev) return -1;
+    memcpy(prev, c->bej, c->bej_sz);
+    prev[c->bej_sz - 1] ^= 1;
+    c->prev = prev;
+    size_t delta_sz = delta_size(c);
+    if (delta_sz) rc |= measure(label, "delta", run_delta, c, iters, min_secs, c->bej_sz, delta_sz, c->tuples);
+    c->prev = NULL;
+    free(prev);
+
+    /* Every run after the first is a hit. */
+    if (bej_cache_open(json_sz * 2 + c->bej_sz + 4096, &c->cache) != 0) return -1;
+    rc |= measure(label, "cache", run_cache, c, iters, min_secs, c->bej_sz, json_sz, c->tuples);
+    bej_cache_close(c->cache);
+    c->cache = NULL;
+    return rc;
+}
+
+typedef int (*corpus_fn)(const batch_item_t* items, size_t count, const batch_opts_t* opts);
+
+/* Converts the corpus with @p fn until @p iters runs or @p min_secs have passed. */
+static int measure_corpus(const char* label, const char* row, corpus_fn fn, const batch_item_t* items,
+    size_t count, const batch_opts_t* opts, int iters, double min_secs, size_t in_sz, size_t out_sz) {
+    int n = 0;
+    double t0 = now_sec(), secs;
+    do {
+        if (fn(items, count, opts) != 0) { fprintf(stderr, "%s.%s failed\n", label, row); return -1; }
+        ++n;
+        secs = now_sec() - t0;
+    } while (iters ? n < iters : secs < min_secs);
+
+    double in_mbps = (double)in_sz * n / (1024.0 * 1024.0) / secs;
+    printf("%-14s %-9s %8d  %9.1f files/s  %9.1f MB/s in  %9.1f MB/s out  %8ld KiB peak\n", label, row, n,
+        (double)count * n / secs, in_mbps, (double)out_sz * n / (1024.0 * 1024.0) / secs, peak_rss_kib());
+    if (nresults < MAX_RESULTS) {
+        snprintf(results[nresults].key, sizeof(results[nresults].key), "%s.%s", label, row);
+        results[nresults++].mbps = in_mbps;
+    }
+    return 0;
+}
+
+/* Both batch modes over the payloads listed in (or found under) @p list_or_dir. */
+static int bench_corpus(const char* list_or_dir, const char* out_dir, const bej_dictionary_t* dict,
+    int threads, int iters, double min_secs) {
+    batch_item_t* items = NULL; size_t count = 0;
+    if (batch_collect(list_or_dir, &items, &count) != 0 || count == 0) {
+        fprintf(stderr, "No payloads in %s\n", list_or_dir);
+        batch_free_items(items, count);
+        return -1;
+    }
+    /* Input and output bytes, from the files and a decode in memory. */
+    size_t in_sz = 0, out_sz = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t* bej = NULL; size_t bej_sz = 0;
+        char* json = NULL; size_t json_len = 0;
+        if (read_file_all(items[i].path, &bej, &bej_sz) == 0
+            && bej_decode_to_buffer(bej, bej_sz, dict, &json, &json_len) == 0) {
+            in_sz += bej_sz;
+            out_sz += json_len;
+        }
+        free(json);
+        free(bej);
+    }
+    const char* label = strrchr(list_or_dir, '/');
+    label = label && label[1] ? label + 1 : list_or_dir;
+    printf("%-14s %-9s %zu files, %zu B in, %zu B out\n", label, "corpus", count, in_sz, out_sz);
+
+    mkdir(out_dir, 0755);
+    batch_opts_t opts = { .dict = dict, .out_dir = out_dir, .threads = threads };
+    int rc = measure_corpus(label, "batch", batch_decode, items, count, &opts, iters, min_secs, in_sz, out_sz);
+    rc |= measure_corpus(label, "pipeline", batch_pipeline, items, count, &opts, iters, min_secs, in_sz, out_sz);
+    batch_free_items(items, count);
+    return rc;
+}
+
+static int save_results(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+    for (size_t i = 0; i < nresults; ++i) fprintf(f, "%s %.3f\n", results[i].key, results[i].mbps);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+/* Returns the number of rows more than @p threshold percent below the baseline, -1 on error. */
+static int compare_results(const char* path, double threshold) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    char key[64];
+    double base;
+    int regressed = 0;
+    printf("\n%-26s %10s %10s %8s\n", "row", "baseline", "current", "change");
+    while (fscanf(f, "%63s %lf", key, &base) == 2) {
+        const result_t* cur = NULL;
+        for (size_t i = 0; i < nresults && !cur; ++i)
+            if (!strcmp(results[i].key, key)) cur = &results[i];
+        if (!cur || base <= 0) continue;
+        double change = (cur->mbps / base - 1.0) * 100.0;
+        int bad = change < -threshold;
+        regressed += bad;
+        printf("%-26s %10.1f %10.1f %+7.1f%%%s\n", key, base, cur->mbps, change, bad ? "  REGRESSED" : "");
+    }
+    fclose(f);
+    return regressed;
+}
+
+#define USAGE \
+    "Usage: %s -s <schema.bin> [-b <payload.bej>]... [-g <shape>[:n] | -g all]...\n" \
+    "          [-n iterations | -T seconds] [-j threads] [-o results.txt] [-c baseline.txt [-t percent]]\n" \
+    "       %s -s <schema.bin> -g <shape>[:n] -w <out.bej>\n" \
+    "       %s -s <schema.bin> -B <list.txt|dir> -O <out_dir> [-j threads] [-n iterations | -T seconds]\n" \
+    "Shapes: wide, deep, array, strings, enums\n"
+
+int main(int argc, char** argv) {
+    const char* dict_path = NULL;
+    const char* payloads[16];
+    size_t npayloads = 0;
+    gen_shape_t shapes[16];
+    size_t shape_n[16];
+    size_t nshapes = 0;
+    const char* save_path = NULL;
+    const char* baseline_path = NULL;
+    const char* write_path = NULL;
+    const char* corpus_path = NULL;
+    const char* corpus_out = NULL;
+    double threshold = 10.0, min_secs = 0.3;
+    int iters = 0, threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) dict_path = argv[++i];
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc && npayloads < 16) payloads[npayloads++] = argv[++i];
+        else if (!strcmp(argv[i], "-g") && i + 1 < argc) {
+            char name[32];
+            const char* arg = argv[++i];
+            const char* colon = strchr(arg, ':');
+            size_t nl = colon ? (size_t)(colon - arg) : strlen(arg);
+            if (nl >= sizeof(name)) { fprintf(stderr, USAGE, argv[0], argv[0], argv[0]); return 2; }
+            memcpy(name, arg, nl);
+            name[nl] = '\0';
+            size_t n = colon ? (size_t)strtoull(colon + 1, NULL, 10) : 0;
+            if (!strcmp(name, "all")) {
+                for (int k = 0; k < GEN_SHAPE_COUNT && nshapes < 16; ++k) {
+                    shapes[nshapes] = (gen_shape_t)k;
+                    shape_n[nshapes++] = n;
+                }
+            }
+            else if (nshapes < 16 && gen_shape_parse(name, &shapes[nshapes]) == 0) shape_n[nshapes++] = n;
+            else { fprintf(stderr, "Unknown shape: %s\n", name); return 2; }
+        }
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) iters = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-T") && i + 1 < argc) min_secs = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) save_path = argv[++i];
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc) baseline_path = argv[++i];
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) threshold = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc) write_path = argv[++i];
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-B") && i + 1 < argc) corpus_path = argv[++i];
+        else if (!strcmp(argv[i], "-O") && i + 1 < argc) corpus_out = argv[++i];
+        else { fprintf(stderr, USAGE, argv[0], argv[0], argv[0]); return 2; }
+    }
+    if (!dict_path || iters < 0 || (write_path && (nshapes != 1 || npayloads))
+        || !corpus_path != !corpus_out || (corpus_path && (write_path || nshapes || npayloads))) {
+        fprintf(stderr, USAGE, argv[0], argv[0], argv[0]);
+        return 2;
+    }
+
+    bej_dictionary_t dict = { 0 };
+    if (dict_load(dict_path, &dict) != 0) { fprintf(stderr, "Failed to load dictionary: %s\n", dict_path); return 1; }
+    bench_ctx_t c = { .dict = &dict, .dict_path = dict_path,
+        .threads = threads > 0 ? threads : pool_default_threads() };
+    int rc = 0;
+
+    if (write_path) {
+        size_t n = shape_n[0] ? shape_n[0] : gen_shape_default_n(shapes[0]);
+        uint8_t* bej = gen_payload(&dict, shapes[0], n, &c.bej_sz);
+        if (!bej || write_file_all(write_path, (const char*)bej, c.bej_sz) != 0) {
+            fprintf(stderr, "Cannot write payload: %s\n", write_path);
+            rc = 1;
+        }
+        free(bej);
+        dict_free(&dict);
+        return rc;
+    }
+
+    if (corpus_path) {
+        rc = bench_corpus(corpus_path, corpus_out, &dict, threads, iters, min_secs) != 0;
+        dict_free(&dict);
+        if (rc == 0 && save_path && save_results(save_path) != 0) {
+            fprintf(stderr, "Cannot write results: %s\n", save_path);
+            rc = 1;
+        }
+        return rc;
+    }
+
+    c.devnull = fopen("/dev/null", "wb");
+    if (!c.devnull) { dict_free(&dict); return 1; }
+
+    uint8_t* raw = NULL; size_t raw_sz = 0;
+    if (read_file_all(dict_path, &raw, &raw_sz) == 0) free(raw);
+    if (measure("dict", "load", run_dict_load, &c, iters, min_secs, raw_sz, 0, dict.entry_count) != 0) rc = 1;
+
+    for (size_t i = 0; i < npayloads; ++i) {
+        uint8_t* bej = NULL;
+        if (read_file_all(payloads[i], &bej, &c.bej_sz) != 0) {
+            fprintf(stderr, "Failed to read BEJ payload: %s\n", payloads[i]);
+            rc = 1;
+            continue;
+        }
+        const char* label = strrchr(payloads[i], '/');
+        c.bej = bej;
+        if (bench_payload(label ? label + 1 : payloads[i], &c, iters, min_secs) != 0) rc = 1;
+        free(bej);
+    }
+    for (size_t i = 0; i < nshapes; ++i) {
+        size_t n = shape_n[i] ? shape_n[i] : gen_shape_default_n(shapes[i]);
+        uint8_t* bej = gen_payload(&dict, shapes[i], n, &c.bej_sz);
+        if (!bej) { fprintf(stderr, "Failed to generate %s payload\n", gen_shape_name(shapes[i])); rc = 1; continue; }
+        c.bej = bej;
+        if (bench_payload(gen_shape_name(shapes[i]), &c, iters, min_secs) != 0) rc = 1;
+        free(bej);
+    }
+    fclose(c.devnull);
+    dict_free(&dict);
+
+    if (save_path && save_results(save_path) != 0) {
+        fprintf(stderr, "Cannot write results: %s\n", save_path);
+        rc = 1;
+    }
+    if (baseline_path) {
+        int regressed = compare_results(baseline_path, threshold);
+        if (regressed < 0) { fprintf(stderr, "Cannot read baseline: %s\n", baseline_path); rc = 1; }
+        else if (regressed > 0) {
+            fprintf(stderr, "%d row(s) regressed by more than %.1f%%\n", regressed, threshold);
+            rc = 1;
+        }
+    }
+    return rc;
+}
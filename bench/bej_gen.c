@@ -0,0 +1,230 @@
+#include "bej_gen.h"
+#include "dict.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const struct { const char* name; size_t n; } shapes[GEN_SHAPE_COUNT] = {
+    { "wide", 20000 }, { "deep", 200 }, { "array", 100000 }, { "strings", 5000 }, { "enums", 20000 }
+};
+
+const char* gen_shape_name(gen_shape_t shape) {
+    return shapes[shape].name;
+}
+
+int gen_shape_parse(const char* name, gen_shape_t* out) {
+    for (int i = 0; i < GEN_SHAPE_COUNT; ++i) {
+        if (!strcmp(name, shapes[i].name)) { *out = (gen_shape_t)i; return 0; }
+    }
+    return -1;
+}
+
+size_t gen_shape_default_n(gen_shape_t shape) {
+    return shapes[shape].n;
+}
+
+typedef struct {
+    uint8_t* p;
+    size_t   len, cap;
+    int      oom;
+} gbuf_t;
+
+static void gb_put(gbuf_t* b, const void* src, size_t n) {
+    if (b->oom) return;
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 256;
+        while (cap < b->len + n) cap *= 2;
+        uint8_t* np = (uint8_t*)realloc(b->p, cap);
+        if (!np) { b->oom = 1; return; }
+        b->p = np;
+        b->cap = cap;
+    }
+    memcpy(b->p + b->len, src, n);
+    b->len += n;
+}
+
+static void gb_nnint(gbuf_t* b, uint64_t v) {
+    uint8_t t[9];
+    uint8_t n = 1;
+    while (n < 8 && (v >> (n * 8))) n++;
+    t[0] = n;
+    for (uint8_t i = 0; i < n; ++i) t[1 + i] = (uint8_t)(v >> (i * 8));
+    gb_put(b, t, (size_t)n + 1);
+}
+
+static void gb_tuple(gbuf_t* b, uint16_t seq, uint8_t fmt, const void* val, size_t n) {
+    uint8_t f = (uint8_t)(fmt << 4);
+    gb_nnint(b, (uint64_t)seq << 1);
+    gb_put(b, &f, 1);
+    gb_nnint(b, n);
+    gb_put(b, val, n);
+}
+
+static int is_leaf(const bej_dict_entry_t* e) {
+    switch (e->format) {
+    case BEJ_FMT_INTEGER: case BEJ_FMT_STRING: case BEJ_FMT_ENUM:
+    case BEJ_FMT_BOOLEAN: case BEJ_FMT_REAL:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* A value of @p fmt; enum values pick among the entry's variants. */
+static void gen_leaf(gbuf_t* b, const bej_dictionary_t* d, const bej_dict_entry_t* e,
+    uint16_t seq, uint8_t fmt, size_t i, int long_strings) {
+    uint8_t v[320];
+    size_t n = 0;
+    switch (fmt) {
+    case BEJ_FMT_INTEGER: {
+        int64_t x = (int64_t)(i * 2654435761u) >> (i % 48);
+        do { v[n++] = (uint8_t)x; x >>= 8; } while (n < 8 && !(x == 0 && !(v[n - 1] & 0x80)) && !(x == -1 && (v[n - 1] & 0x80)));
+        break;
+    }
+    case BEJ_FMT_STRING: {
+        static const char text[] = "Intel(R) Xeon(R) Gold 6338N CPU @ 2.20GHz, rev 0x0d \"SKU\"\\ ";
+        size_t len = long_strings ? 96 + i % 192 : 8 + i % 24;
+        for (; n < len; ++n) v[n] = (uint8_t)text[(n + i) % (sizeof(text) - 1)];
+        if (long_strings && i % 4 == 0) v[len / 2] = '\n';
+        v[n++] = 0;
+        break;
+    }
+    case BEJ_FMT_ENUM: {
+        size_t variants = e ? e->child_count : 0;
+        uint64_t val = variants ? dict_children(d, (int)(e - d->entries)).list[i % variants].seq : i % 4;
+        v[n++] = 1;
+        v[n++] = (uint8_t)val;
+        break;
+    }
+    case BEJ_FMT_BOOLEAN:
+        v[n++] = (uint8_t)(i & 1);
+        break;
+    default: {      /* REAL: (i % 100).5 */
+        const uint8_t r[] = { 1, 1, 0, 1, 0, 1, 5, 1, 0 };
+        memcpy(v, r, sizeof(r));
+        v[2] = (uint8_t)(i % 100);
+        n = sizeof(r);
+    }
+    }
+    gb_tuple(b, seq, fmt, v, n);
+}
+
+/* Leaf entries of @p sub with a format accepted by @p want (0 = any leaf). */
+static size_t pick_leaves(const dict_subset_t* sub, uint8_t want, const bej_dict_entry_t** out, size_t max) {
+    size_t k = 0;
+    for (uint16_t i = 0; i < sub->count && k < max; ++i) {
+        const bej_dict_entry_t* e = &sub->list[i];
+        if (is_leaf(e) && (!want || e->format == want) && (e->format != BEJ_FMT_ENUM || e->child_count))
+            out[k++] = e;
+    }
+    return k;
+}
+
+/* n leaves cycling through the schema's entries, or unnamed ones past its seqs. */
+static void gen_leaves(gbuf_t* b, const bej_dictionary_t* d, const dict_subset_t* sub,
+    uint8_t want, size_t n, int long_strings) {
+    const bej_dict_entry_t* picks[256];
+    size_t np = pick_leaves(sub, want, picks, 256);
+    for (size_t i = 0; i < n; ++i) {
+        if (np) {
+            const bej_dict_entry_t* e = picks[i % np];
+            gen_leaf(b, d, e, e->seq, e->format, i, long_strings);
+        }
+        else {
+            static const uint8_t kinds[] = { BEJ_FMT_INTEGER, BEJ_FMT_STRING, BEJ_FMT_BOOLEAN, BEJ_FMT_REAL };
+            gen_leaf(b, d, NULL, (uint16_t)(sub->count + 1000 + i % 64), want ? want : kinds[i % 4], i, long_strings);
+        }
+    }
+}
+
+static void wrap_set(gbuf_t* out, uint16_t seq, size_t count, const gbuf_t* members) {
+    gbuf_t body = { 0 };
+    gb_nnint(&body, count);
+    gb_put(&body, members->p, members->len);
+    gb_tuple(out, seq, BEJ_FMT_SET, body.p, body.len);
+    if (body.oom) out->oom = 1;
+    free(body.p);
+}
+
+uint8_t* gen_payload(const bej_dictionary_t* d, gen_shape_t shape, size_t n, size_t* out_sz) {
+    static const uint8_t header[7] = { 0x00, 0xF0, 0xF0, 0xF1, 0x00, 0x00, 0x00 };
+    dict_subset_t root = dict_children(d, -1);
+    gbuf_t members = { 0 };
+    size_t count = n;
+
+    switch (shape) {
+    case GEN_WIDE:    gen_leaves(&members, d, &root, 0, n, 0); break;
+    case GEN_STRINGS: gen_leaves(&members, d, &root, BEJ_FMT_STRING, n, 1); break;
+    case GEN_ENUMS:   gen_leaves(&members, d, &root, BEJ_FMT_ENUM, n, 0); break;
+
+    case GEN_ARRAY: {
+        /* The first array of leaves in the schema, else an unnamed integer array. */
+        const bej_dict_entry_t* arr = NULL;
+        const bej_dict_entry_t* elem = NULL;
+        for (uint16_t i = 0; i < root.count && !arr; ++i) {
+            if (root.list[i].format != BEJ_FMT_ARRAY || !root.list[i].child_count) continue;
+            dict_subset_t es = dict_children(d, (int)(&root.list[i] - d->entries));
+            if (is_leaf(&es.list[0])) { arr = &root.list[i]; elem = &es.list[0]; }
+        }
+        gbuf_t body = { 0 };
+        gb_nnint(&body, n);
+        for (size_t i = 0; i < n; ++i)
+            gen_leaf(&body, d, elem, (uint16_t)i, elem ? elem->format : BEJ_FMT_INTEGER, i, 0);
+        gb_tuple(&members, arr ? arr->seq : (uint16_t)(root.count + 1000), BEJ_FMT_ARRAY, body.p, body.len);
+        if (body.oom) members.oom = 1;
+        free(body.p);
+        count = 1;
+        break;
+    }
+
+    case GEN_DEEP: {
+        /* Follow set-valued entries down the schema while it lasts, then go
+         * unnamed; build from the innermost level outwards. */
+        if (n == 0) n = 1;
+        dict_subset_t* subs = (dict_subset_t*)calloc(n, sizeof(dict_subset_t));
+        uint16_t* seqs = (uint16_t*)calloc(n, sizeof(uint16_t));
+        if (!subs || !seqs) { free(subs); free(seqs); return NULL; }
+        subs[0] = root;
+        for (size_t l = 1; l < n; ++l) {
+            seqs[l] = 0xFFF0;
+            subs[l] = (dict_subset_t){ 0 };
+            for (uint16_t i = 0; i < subs[l - 1].count; ++i) {
+                const bej_dict_entry_t* e = &subs[l - 1].list[i];
+                if (e->format == BEJ_FMT_SET && e->child_count) {
+                    seqs[l] = e->seq;
+                    subs[l] = dict_children(d, (int)(e - d->entries));
+                    break;
+                }
+            }
+        }
+        gbuf_t inner = { 0 };
+        for (size_t l = n; l-- > 1;) {
+            gbuf_t level = { 0 };
+            gen_leaves(&level, d, &subs[l], 0, 2, 0);
+            if (inner.len) gb_put(&level, inner.p, inner.len);
+            inner.len = 0;
+            wrap_set(&inner, seqs[l], l + 1 < n ? 3 : 2, &level);
+            if (level.oom) inner.oom = 1;
+            free(level.p);
+        }
+        gen_leaves(&members, d, &root, 0, 2, 0);
+        gb_put(&members, inner.p, inner.len);
+        if (inner.oom) members.oom = 1;
+        free(inner.p);
+        free(subs);
+        free(seqs);
+        count = n > 1 ? 3 : 2;
+        break;
+    }
+    default:
+        break;
+    }
+
+    gbuf_t out = { 0 };
+    gb_put(&out, header, sizeof(header));
+    wrap_set(&out, 0, count, &members);
+    int oom = members.oom || out.oom;
+    free(members.p);
+    if (oom) { free(out.p); return NULL; }
+    *out_sz = out.len;
+    return out.p;
+}
@@ -0,0 +1,28 @@
+#ifndef BEJ_GEN_H
+#define BEJ_GEN_H
+
+#include "bej.h"
+#include <stddef.h>
+
+/* Synthetic BEJ payloads shaped after a dictionary, for benchmarks. Names
+ * resolve through the dictionary wherever it has a matching entry. */
+
+typedef enum {
+    GEN_WIDE,       /* one root set with n leaf properties of every kind */
+    GEN_DEEP,       /* n nested sets, two leaves per level */
+    GEN_ARRAY,      /* one array of n elements */
+    GEN_STRINGS,    /* n long string properties, some needing escapes */
+    GEN_ENUMS,      /* n enum properties */
+    GEN_SHAPE_COUNT
+} gen_shape_t;
+
+const char* gen_shape_name(gen_shape_t shape);
+/** Parses "wide", "deep", ...; returns -1 for an unknown name. */
+int gen_shape_parse(const char* name, gen_shape_t* out);
+/** Default size parameter used when none is given. */
+size_t gen_shape_default_n(gen_shape_t shape);
+
+/** Builds a malloc'd payload (header included); NULL on allocation failure. */
+uint8_t* gen_payload(const bej_dictionary_t* d, gen_shape_t shape, size_t n, size_t* out_sz);
+
+#endif /* BEJ_GEN_H */
@@ -0,0 +1,114 @@
+/** @file bejd_load.c
+ *  @brief Daemon load test:
+ *         bejd_load -L <socket> -b <payload.bej> [-d <schema>] [-c connections] [-n requests] [-r]
+ *
+ *  Each of -c connections (default 4) sends its share of -n requests
+ *  (default 10000) back to back, timing every round trip. -r opens a new
+ *  connection per request, as one-shot clients do. Prints requests/s and
+ *  the p50/p99/max latency; exits with 1 if any request fails.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "daemon.h"
+#include "io.h"
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    const char* socket_path;
+    const char* schema;
+    const uint8_t* bej;
+    size_t bej_sz;
+    size_t per_conn;
+    int reconnect;
+    double* lat;            /* per_conn slots per connection, in seconds */
+    size_t* failed;         /* one counter per connection */
+} load_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void run_conn(void* ctx, size_t c) {
+    load_t* l = (load_t*)ctx;
+    double* lat = l->lat + c * l->per_conn;
+    bejd_reply_t reply = { 0 };
+    int fd = -1;
+    for (size_t i = 0; i < l->per_conn; ++i) {
+        double t0 = now_sec();
+        if (fd < 0) fd = bejd_connect(l->socket_path);
+        int ok = fd >= 0 && bejd_request(fd, l->schema, l->bej, l->bej_sz, &reply) == 0 && reply.status == 0;
+        if (fd >= 0 && (l->reconnect || !ok)) { close(fd); fd = -1; }
+        lat[i] = now_sec() - t0;
+        l->failed[c] += !ok;
+    }
+    if (fd >= 0) close(fd);
+    bejd_reply_free(&reply);
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage:\n"
+        "  %s -L <socket> -b <payload.bej> [-d <schema>] [-c connections] [-n requests] [-r]\n", prog);
+}
+
+int main(int argc, char** argv) {
+    load_t l = { 0 };
+    const char* bej_path = NULL;
+    int conns = 4;
+    size_t total = 10000;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-L") && i + 1 < argc) l.socket_path = argv[++i];
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) bej_path = argv[++i];
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc) l.schema = argv[++i];
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc) conns = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) total = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "-r")) l.reconnect = 1;
+        else { usage(argv[0]); return 2; }
+    }
+    if (!l.socket_path || !bej_path || conns <= 0 || total == 0) { usage(argv[0]); return 2; }
+
+    uint8_t* bej = NULL;
+    if (read_file_all(bej_path, &bej, &l.bej_sz) != 0) {
+        fprintf(stderr, "Failed to read BEJ payload: %s\n", bej_path);
+        return 1;
+    }
+    l.bej = bej;
+    l.per_conn = (total + (size_t)conns - 1) / (size_t)conns;
+    size_t n = l.per_conn * (size_t)conns;
+    l.lat = (double*)malloc(n * sizeof(double));
+    l.failed = (size_t*)calloc((size_t)conns, sizeof(size_t));
+    if (!l.lat || !l.failed) { fprintf(stderr, "Out of memory\n"); return 1; }
+
+    double t0 = now_sec();
+    if (pool_run(conns, (size_t)conns, run_conn, &l) != 0) { fprintf(stderr, "Cannot start clients\n"); return 1; }
+    double wall = now_sec() - t0;
+
+    size_t failed = 0;
+    for (int c = 0; c < conns; ++c) failed += l.failed[c];
+    qsort(l.lat, n, sizeof(double), cmp_double);
+    printf("%zu requests over %d connection%s%s in %.3f s\n", n, conns, conns == 1 ? "" : "s",
+        l.reconnect ? " (reconnecting)" : "", wall);
+    printf("%-10s %12.0f\n", "req/s", (double)n / wall);
+    printf("%-10s %12.1f us\n", "p50", l.lat[n / 2] * 1e6);
+    printf("%-10s %12.1f us\n", "p99", l.lat[n - 1 - n / 100] * 1e6);
+    printf("%-10s %12.1f us\n", "max", l.lat[n - 1] * 1e6);
+    if (failed) printf("%-10s %12zu\n", "failed", failed);
+
+    free(l.lat);
+    free(l.failed);
+    free(bej);
+    return failed ? 1 : 0;
+}
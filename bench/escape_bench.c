@@ -0,0 +1,54 @@
+/** @file escape_bench.c
+ *  @brief JSON escaping throughput per scan kernel: escape_bench [-m MB per case]
+ */
+
+#include "bej_stats.h"
+#include "json_escape.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double now_sec(void) {
+    return (double)bej_stats_clock_ns() * 1e-9;
+}
+
+int main(int argc, char** argv) {
+    size_t mb = 64;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-m") && i + 1 < argc) mb = (size_t)strtoull(argv[++i], NULL, 10);
+        else { fprintf(stderr, "Usage: %s [-m MB per case]\n", argv[0]); return 2; }
+    }
+
+    static const size_t lens[] = { 8, 16, 36, 64, 256, 4096 };
+    static const struct { int id; const char* name; } impls[] = {
+        { JSON_ESCAPE_SCALAR, "scalar" }, { JSON_ESCAPE_SSE2, "sse2" }, { JSON_ESCAPE_AVX2, "avx2" }
+    };
+    char* text = (char*)malloc(4096);
+    bej_sink_t sink;
+    if (!text || bej_sink_init_mem(&sink, 64 * 1024) != 0) return 1;
+
+    printf("%-8s %6s %-6s %10s\n", "kernel", "len", "text", "MB/s");
+    for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); ++k) {
+        if (json_escape_select(impls[k].id) != 0) continue;
+        for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); ++l) {
+            for (int dirty = 0; dirty < 2; ++dirty) {
+                /* Clean: UUID/firmware-like ASCII. Dirty: a quote or newline every 40 bytes. */
+                for (size_t i = 0; i < lens[l]; ++i) text[i] = (char)('0' + i % 43);
+                if (dirty) for (size_t i = 39; i < lens[l]; i += 40) text[i] = i % 80 == 39 ? '"' : '\n';
+
+                size_t reps = mb * 1024 * 1024 / lens[l];
+                double t0 = now_sec();
+                for (size_t r = 0; r < reps; ++r) {
+                    json_escape_run(&sink, text, lens[l]);
+                    sink.len = 0;
+                }
+                double secs = now_sec() - t0;
+                printf("%-8s %6zu %-6s %10.1f\n", impls[k].name, lens[l], dirty ? "dirty" : "clean",
+                    (double)(reps * lens[l]) / (1024.0 * 1024.0) / secs);
+            }
+        }
+    }
+    bej_sink_free(&sink);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* Bump allocator over caller memory, for decoding without heap traffic:
+     * everything handed out lives until bej_arena_reset, typically called
+     * between payloads. The arena never allocates or frees anything itself. */
+
+    typedef struct {
+        uint8_t* base;
+        size_t   cap;
+        size_t   used;
+        size_t   peak;      /* largest used seen, across resets */
+    } bej_arena_t;
+
+    void bej_arena_init(bej_arena_t* a, void* buf, size_t cap);
+
+    /** @p n bytes aligned to 16, or NULL when the arena is full. */
+    void* bej_arena_alloc(bej_arena_t* a, size_t n);
+
+    /** Everything left (aligned to 16), for output of unknown size; @p room gets its
+     *  size. Nothing is taken until bej_arena_commit. NULL when the arena is full. */
+    void* bej_arena_rest(bej_arena_t* a, size_t* room);
+    /** Keeps the first @p n bytes of the last bej_arena_rest. */
+    void  bej_arena_commit(bej_arena_t* a, size_t n);
+
+    static inline void bej_arena_reset(bej_arena_t* a) { a->used = 0; }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARENA_H */
@@ -0,0 +1,42 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "bej.h"
+#include "bej_cache.h"
+#include "registry.h"
+#include <stddef.h>
+
+typedef struct {
+    char* path;
+    char* schema;       /* registry key from a "path<TAB>schema" list line, else NULL */
+} batch_item_t;
+
+typedef struct {
+    const bej_dictionary_t* dict;   /* used when registry is NULL */
+    dict_registry_t* registry;
+    const char* schema;             /* registry key for items without their own */
+    const char* out_dir;
+    int threads;                    /* <= 0: one per core */
+    const bej_projection_t* proj;   /* resolved against dict; NULL renders everything */
+    bej_cache_t* cache;             /* repeated payloads; NULL: none. Not used with proj */
+    int readers;                    /* batch_pipeline read threads; <= 0: 2 */
+    size_t depth;                   /* batch_pipeline payloads in flight; 0: 4 per decode thread */
+} batch_opts_t;
+
+/** Expands @p list_or_dir into payloads: every *.bej in a directory, or one
+ *  "path" or "path<TAB>schema" per line of a list file. Returns -2 when two
+ *  payloads share a basename, as both would write <out_dir>/<name>.json. */
+int batch_collect(const char* list_or_dir, batch_item_t** out_items, size_t* out_count);
+void batch_free_items(batch_item_t* items, size_t count);
+
+/** Decodes every payload into <out_dir>/<name>.json. Returns the number of failures, -1 on setup error. */
+int batch_decode(const batch_item_t* items, size_t count, const batch_opts_t* opts);
+
+/** batch_decode as three stages: @c readers threads read payloads ahead,
+ *  @c threads workers decode them in memory, and the calling thread writes
+ *  the outputs in list order. At most @c depth payloads are between reading
+ *  and writing, so a stage that falls behind holds the others back and
+ *  memory stays bounded. Same outputs and return value as batch_decode. */
+int batch_pipeline(const batch_item_t* items, size_t count, const batch_opts_t* opts);
+
+#endif /* BATCH_H */
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include "arena.h"
+#include "sink.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,26 +39,56 @@ extern "C" {
         uint16_t name_off;
     } bej_dict_entry_disk_t;
 
+    /** Resolved dictionary entry. Holds no pointers, so an entry table can be
+     *  used in place from a mapped image; see dict_entry_name(). */
     typedef struct bej_dict_entry_s {
         uint8_t  format;
         uint8_t  flags;
         uint16_t seq;
         int32_t  child_first_idx;
         uint16_t child_count;
-        const char* name;
+        uint16_t name_len;      /* without the NUL */
+        uint32_t name_off;      /* into bej_dictionary_t.names; 0 = unnamed */
     } bej_dict_entry_t;
 
+    enum {
+        BEJ_SEQ_IDX_NONE = 0,   /* no index: linear scan */
+        BEJ_SEQ_IDX_RANGE = 1,  /* child i has seq base + i */
+        BEJ_SEQ_IDX_DIRECT = 2, /* table[seq] = child position + 1 */
+        BEJ_SEQ_IDX_HASH = 3    /* open addressing, table[h] = child position + 1 */
+    };
+
+    /** Per-parent seq -> child lookup, built by dict_load. */
     typedef struct {
-        uint8_t* bytes;
+        uint8_t  kind;
+        uint8_t  reserved[3];
+        uint32_t span;
+        uint32_t off;
+    } bej_seq_index_t;
+
+    typedef struct {
+        const uint8_t* bytes;
         size_t   size;
+        int      bytes_mapped;
+        int      bytes_borrowed;    /* bytes belong to the caller (dict_load_mem) */
 
         uint8_t  version_tag;
         uint8_t  dict_flags;
         uint16_t entry_count;
         uint32_t schema_version;
         uint32_t dict_size;
+        uint64_t identity;          /* hash of the content, set by the loaders; 0: unknown */
+
+        const bej_dict_entry_t* entries;
+        const char* names;
+        const char* keys;           /* pre-rendered JSON keys; see dict_entry_key() */
+        const uint32_t* key_off;    /* entry_count + 1 offsets into keys */
 
-        bej_dict_entry_t* entries;
+        const bej_seq_index_t* seq_index;
+        const uint16_t* seq_pool;
+        size_t    seq_pool_len;
+
+        int       tables_borrowed;  /* entries/index/pool/keys live inside bytes (compiled image) */
 
         uint32_t header_size;
         uint32_t entry_size;
@@ -68,10 +100,70 @@ extern "C" {
         size_t  pos;
     } bej_stream_t;
 
+    /** Resolved JSON-pointer projection; see bej_project.h. */
+    typedef struct bej_projection_s bej_projection_t;
+
+    /** Decode counters and timings; see bej_stats.h. */
+    typedef struct bej_stats_s bej_stats_t;
+
+    /** Per-decode state. One context per thread; the dictionary is shared read-only. */
+    typedef struct {
+        const bej_dictionary_t* dict;
+        bej_sink_t* out;
+        int   pp_level;
+        const bej_projection_t* proj;   /* NULL: render everything */
+        int   has_member;   /* JSON writer: the open container has a member already */
+        int   named;        /* JSON writer: a property name precedes the next value */
+        bej_stats_t* stats; /* NULL: not counted */
+    } bej_decoder_t;
+
+    void bej_decoder_init(bej_decoder_t* dec, const bej_dictionary_t* dict_major, bej_sink_t* out);
+    /** Decodes into dec->out without flushing it; the caller owns the sink. */
+    int  bej_decoder_run(bej_decoder_t* dec, const uint8_t* bej, size_t bej_size);
+
+    int bej_decode_to_sink(bej_sink_t* out,
+        const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major);
+
+    /** Same output as bej_decode_to_sink, byte for byte, with large sets and
+     *  arrays split into runs of members rendered on @p threads workers
+     *  (<= 0: one per core) and stitched back in order. Runs are found by the
+     *  SFL lengths alone, before anything is rendered. Payloads too small to
+     *  split are decoded serially, as are ones that fail anywhere (so errors
+     *  and partial output match too). Needs memory for the whole output.
+     *  @p stats (may be NULL) gets the counts of all runs together. */
+    int bej_decode_parallel(bej_sink_t* out,
+        const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major, int threads, bej_stats_t* stats);
+
     int bej_decode_to_json(FILE* out,
         const uint8_t* bej, size_t bej_size,
         const bej_dictionary_t* dict_major);
 
+    int bej_decode_to_fd(int fd,
+        const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major);
+
+    /** Decodes into a malloc'd, NUL-terminated JSON string; free() it when done. */
+    int bej_decode_to_buffer(const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major,
+        char** out_json, size_t* out_len);
+
+    /** Decodes into the free space of @p arena without touching the heap. On
+     *  success *@p out_json points into the arena (NUL-terminated) and stays
+     *  valid until bej_arena_reset; -1 if the arena is too small. */
+    int bej_decode_to_arena(const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major, bej_arena_t* arena,
+        char** out_json, size_t* out_len);
+
+    /** Checks a payload without rendering it: every SFL tuple, that each length
+     *  field covers its value exactly, and that property seqs and enum values
+     *  resolve in the dictionary. Leaf values are skipped by length.
+     *  Returns 0 if valid, -1 if malformed, -2 if unsupported, -3 if it does not
+     *  match the dictionary; @p err_off (may be NULL) gets the failing tuple's offset. */
+    int bej_validate(const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major, size_t* err_off);
+
     void bej_stream_init(bej_stream_t* s, const uint8_t* buf, size_t n);
     int  bej_read_nnint(bej_stream_t* s, uint64_t* out);
     int  bej_peek_format(bej_stream_t* s, uint8_t* fmt, uint8_t* flags);
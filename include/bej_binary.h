@@ -0,0 +1,36 @@
+#ifndef BEJ_BINARY_H
+#define BEJ_BINARY_H
+
+#include "bej.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* Binary output: the same tree the JSON writer renders, as CBOR or
+     * MessagePack. Sets become maps keyed by the dictionary names ("_<seq>"
+     * for seqs missing from it), integers and reals are written as numbers
+     * (a real as a 32-bit float when that is exact, else 64-bit), and enums
+     * as their names (the number when unresolved). @p proj (may be NULL)
+     * limits the output as in bej_decode_projected. Both return 0, or the
+     * codes of bej_decode_to_sink; the caller owns and finishes the sink. */
+
+    /** CBOR (RFC 8949). Maps and arrays have indefinite length, so output streams. */
+    int bej_decode_to_cbor(bej_sink_t* out,
+        const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major,
+        const bej_projection_t* proj);
+
+    /** MessagePack. Its maps and arrays are counted up front, and the count is
+     *  patched in when the container ends; on a memory sink that happens in
+     *  place, on any other the output is put together in memory first. */
+    int bej_decode_to_msgpack(bej_sink_t* out,
+        const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major,
+        const bej_projection_t* proj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BEJ_BINARY_H */
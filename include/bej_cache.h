@@ -0,0 +1,53 @@
+#ifndef BEJ_CACHE_H
+#define BEJ_CACHE_H
+
+#include "bej.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* Decoded-output cache for payloads that repeat byte for byte (resources
+     * polled again and again). Entries are keyed by a 64-bit hash of the
+     * payload and the dictionary, and keep the payload itself: a hit is
+     * confirmed with a memcmp before the stored JSON is copied out, so hash
+     * collisions cannot return another payload's output. The least recently
+     * used entries are dropped once the cached bytes exceed the budget.
+     *
+     * Dictionaries are told apart by bej_dictionary_t.identity, a hash of
+     * their content set at load, so one freed and another loaded at the same
+     * address does not hit the first one's entries. Dictionaries without an
+     * identity (built by hand) bypass the cache. All calls are thread-safe;
+     * hits copy out without holding the cache lock. */
+
+    typedef struct bej_cache_s bej_cache_t;
+
+    /** @p mem_budget caps cached bytes: payloads, JSON and per-entry overhead. */
+    int  bej_cache_open(size_t mem_budget, bej_cache_t** out);
+    void bej_cache_close(bej_cache_t* c);
+
+    /** bej_decode_to_sink through the cache: same return codes, same bytes in
+     *  @p out. A miss is decoded and kept if it succeeds and fits the budget;
+     *  failed decodes are not cached. */
+    int bej_cache_decode(bej_cache_t* c, bej_sink_t* out,
+        const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major);
+
+    /** Drops every entry; counters are kept. */
+    void bej_cache_clear(bej_cache_t* c);
+
+    typedef struct {
+        size_t hits;
+        size_t misses;
+        size_t entries;
+        size_t bytes;
+        size_t evictions;
+    } bej_cache_stats_t;
+
+    void bej_cache_stats(bej_cache_t* c, bej_cache_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BEJ_CACHE_H */
@@ -0,0 +1,34 @@
+#ifndef BEJ_DELTA_H
+#define BEJ_DELTA_H
+
+#include "bej.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* Delta decoding: what changed between two payloads of the same resource,
+     * as a JSON merge patch (RFC 7396). The two trees are walked side by side
+     * and members are paired by seq. A pair whose tuples are byte-for-byte
+     * equal (format, length and value; one memcmp) is skipped without being
+     * decoded, however big the subtree under it. Sets that differ are compared
+     * member by member; any other value that differs, arrays included, is
+     * written whole from @p cur. Members only in @p prev become null. */
+
+    /** Writes the merge patch that turns the decode of @p prev into that of
+     *  @p cur, laid out like bej_decode_to_sink; "{}" when nothing changed.
+     *  A member whose new value is null is written as null too, which merge
+     *  patch readers take as a removal (RFC 7396 cannot set a null). If the
+     *  root is not a set in both, the patch is @p cur decoded in full.
+     *  Both payloads must have been encoded against @p dict_major. Returns 0,
+     *  or the codes of bej_decode_to_sink; the caller owns the sink. */
+    int bej_decode_delta(bej_sink_t* out,
+        const uint8_t* prev, size_t prev_size,
+        const uint8_t* cur, size_t cur_size,
+        const bej_dictionary_t* dict_major);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BEJ_DELTA_H */
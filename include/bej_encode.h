@@ -0,0 +1,34 @@
+#ifndef BEJ_ENCODE_H
+#define BEJ_ENCODE_H
+
+#include "bej.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* JSON -> BEJ. Property names resolve through the same dictionary the
+     * decoder uses; keys of the form "_<seq>" (what the decoder prints for
+     * properties missing from the dictionary) are encoded by seq, with the
+     * format taken from the JSON value. */
+
+    typedef struct bej_encoder_s bej_encoder_t;
+
+    /** Builds the name -> entry index for @p dict_major; the dictionary must outlive the encoder. */
+    bej_encoder_t* bej_encoder_new(const bej_dictionary_t* dict_major);
+    void bej_encoder_free(bej_encoder_t* enc);
+
+    /** Encodes a JSON object into a malloc'd BEJ payload (header included); free() it when done.
+     *  Returns -1 on malformed JSON, -2 when a value does not fit the dictionary
+     *  (unknown property or enum name, type mismatch, annotations). */
+    int bej_encode(bej_encoder_t* enc, const char* json, size_t json_len,
+        uint8_t** out_bej, size_t* out_len);
+
+    /** JSON offset of the last bej_encode error. */
+    size_t bej_encoder_offset(const bej_encoder_t* enc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BEJ_ENCODE_H */
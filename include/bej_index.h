@@ -0,0 +1,82 @@
+#ifndef BEJ_INDEX_H
+#define BEJ_INDEX_H
+
+#include "bej.h"
+#include "dict.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* Offset index over a BEJ payload, for repeated random access without
+     * decoding the whole document. One pass records every set and array:
+     * the offset of its SFL tuple and one 4-byte entry per child, either the
+     * child's tuple offset (leaves) or its container number. Set members are
+     * kept sorted by seq and array elements by position, so a JSON-pointer
+     * lookup is a binary search (sets) or a direct step (arrays) per level,
+     * and only the value asked for is decoded. Payloads up to 2 GiB. */
+
+    typedef struct bej_index_s bej_index_t;
+
+    /** Indexes @p bej (header included). Returns 0, -1 on malformed input or
+     *  allocation failure, -2 on unsupported content or a payload too large. */
+    int bej_index_build(const uint8_t* bej, size_t bej_size, bej_index_t** out);
+    void bej_index_free(bej_index_t* idx);
+
+    /** Number of indexed sets/arrays and of child entries. */
+    void bej_index_counts(const bej_index_t* idx, size_t* containers, size_t* children);
+
+    /** Serializes the index into a malloc'd, little-endian blob; free() it when done. */
+    int bej_index_save(const bej_index_t* idx, uint8_t** out, size_t* out_len);
+    /** Reads a blob written by bej_index_save. It is checked for internal
+     *  consistency and must belong to a payload of @p bej_size bytes.
+     *  Returns 0, -1 if it is damaged or for another payload. */
+    int bej_index_load(const uint8_t* data, size_t size, size_t bej_size, bej_index_t** out);
+
+    /* Lazy DOM over an index, its payload and the dictionary. Nodes are small
+     * values; nothing is decoded until bej_dom_render. */
+
+    typedef struct {
+        const bej_index_t* idx;
+        const uint8_t* bej;
+        size_t bej_size;
+        const bej_dictionary_t* dict;
+    } bej_dom_t;
+
+    typedef struct {
+        uint32_t ref;           /* index child entry; see bej_index.c */
+        int      has_ctx;
+        dict_subset_t ctx;      /* dictionary children the value's seq resolves in */
+    } bej_dom_node_t;
+
+    enum {
+        BEJ_DOM_ABSENT = 1      /* the pointer is valid but the payload does not have it */
+    };
+
+    /** Returns -1 when @p idx was not built for a payload of this size. */
+    int bej_dom_init(bej_dom_t* dom, const bej_index_t* idx,
+        const uint8_t* bej, size_t bej_size, const bej_dictionary_t* dict_major);
+
+    void bej_dom_root(const bej_dom_t* dom, bej_dom_node_t* out);
+
+    /** Follows a JSON pointer (as for bej_projection_new) from the root.
+     *  Returns 0, BEJ_DOM_ABSENT, or -2 if the pointer does not fit the dictionary. */
+    int bej_dom_lookup(const bej_dom_t* dom, const char* pointer, bej_dom_node_t* out);
+
+    /** Number of members (set) or elements (array); 0 for leaves. */
+    size_t bej_dom_count(const bej_dom_t* dom, const bej_dom_node_t* node);
+    /** The @p i-th element of an array, or member of a set in seq order. Returns 0 or BEJ_DOM_ABSENT. */
+    int bej_dom_child(const bej_dom_t* dom, const bej_dom_node_t* node, size_t i, bej_dom_node_t* out);
+
+    /** BEJ format of the node's value (BEJ_FMT_*). */
+    uint8_t bej_dom_format(const bej_dom_t* dom, const bej_dom_node_t* node);
+
+    /** Renders the node's value as JSON, exactly as the full decode prints it
+     *  (indentation restarting at the value). */
+    int bej_dom_render(const bej_dom_t* dom, const bej_dom_node_t* node, bej_sink_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BEJ_INDEX_H */
@@ -0,0 +1,39 @@
+#ifndef BEJ_PROJECT_H
+#define BEJ_PROJECT_H
+
+#include "bej.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* Projected decoding: only the properties named by a list of JSON
+     * pointers (RFC 6901, e.g. "/MemoryLocation/Channel") are rendered. The
+     * pointers are resolved against the dictionary once, into a tree of seqs
+     * and array indices; at decode time every subtree outside that tree is
+     * stepped over using the length in its SFL tuple, never parsed. Selected
+     * values keep their position in the document, so the output is the full
+     * JSON with everything else left out. */
+
+    /** Resolves @p count pointers against @p dict_major ("" selects the whole
+     *  document; "_<seq>" names properties missing from the dictionary, array
+     *  elements are selected by index). The projection only reads the
+     *  dictionary while it is being built.
+     *  Returns 0, -1 on allocation failure, -2 if a pointer does not resolve
+     *  (its index goes to @p bad_path, which may be NULL). */
+    int bej_projection_new(const bej_dictionary_t* dict_major,
+        const char* const* paths, size_t count,
+        bej_projection_t** out, size_t* bad_path);
+    void bej_projection_free(bej_projection_t* proj);
+
+    /** Like bej_decode_to_sink, rendering only what @p proj selects (NULL: everything). */
+    int bej_decode_projected(bej_sink_t* out,
+        const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major,
+        const bej_projection_t* proj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BEJ_PROJECT_H */
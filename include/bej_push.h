@@ -0,0 +1,42 @@
+#ifndef BEJ_PUSH_H
+#define BEJ_PUSH_H
+
+#include "bej.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* Push-style decoder: feed the payload in chunks of any size, JSON is
+     * written to the sink as soon as each piece can be rendered. State lives
+     * in an explicit frame stack, and only a small carry buffer holds tuples
+     * that straddle a chunk boundary, so memory stays bounded whatever the
+     * payload size. Output is byte-identical to bej_decode_to_sink. */
+
+    enum {
+        BEJ_PUSH_DONE = 0,
+        BEJ_PUSH_NEED_MORE = 1
+    };
+
+    typedef struct bej_push_s bej_push_t;
+
+    /** @p max_depth bounds set/array nesting (0 = 256). */
+    bej_push_t* bej_push_new(const bej_dictionary_t* dict_major, bej_sink_t* out, size_t max_depth);
+    void bej_push_free(bej_push_t* p);
+
+    /** Consumes @p n bytes. Returns BEJ_PUSH_NEED_MORE until the root value is
+     *  complete, then BEJ_PUSH_DONE (bytes after the root value are ignored);
+     *  -1 on malformed input, -2 on unsupported content, -3 when too deep. */
+    int bej_push_feed(bej_push_t* p, const uint8_t* data, size_t n);
+
+    /** End of input: 0 if the payload was complete, else the error (-1 if truncated). */
+    int bej_push_finish(bej_push_t* p);
+
+    /** Payload bytes consumed so far; on error, the offset of the failing token. */
+    size_t bej_push_offset(const bej_push_t* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BEJ_PUSH_H */
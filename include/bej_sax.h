@@ -0,0 +1,62 @@
+#ifndef BEJ_SAX_H
+#define BEJ_SAX_H
+
+#include "bej.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* Event-driven decoding: the traversal behind bej_decode_to_sink reports
+     * each value through a callback table instead of rendering JSON (the JSON
+     * writer is itself one such table). Consumers can build their own
+     * structures straight from the payload, with no text in between. */
+
+    /** A BEJ real: whole . (leading_zeros zeros) fract, times 10^exp. */
+    typedef struct {
+        int64_t  whole;
+        uint64_t leading_zeros;
+        uint64_t fract;
+        int64_t  exp;
+    } bej_real_t;
+
+    /** Any callback may be NULL. Each returns 0 to go on; any other value
+     *  stops the decode, and bej_sax_run returns it. */
+    typedef struct {
+        /** @p count: tuples in the payload, an upper bound on the members that
+         *  follow (annotations and members outside a projection are not reported). */
+        int (*begin_set)(void* ctx, uint64_t count);
+        int (*end_set)(void* ctx);
+        int (*begin_array)(void* ctx, uint64_t count);
+        int (*end_array)(void* ctx);
+        /** Precedes each set member's value; @p name is NULL for a seq missing from the dictionary. */
+        int (*name)(void* ctx, const char* name, size_t len, uint16_t seq);
+        int (*int64)(void* ctx, int64_t v);
+        int (*real)(void* ctx, const bej_real_t* v);
+        /** @p s points into the payload; not NUL-terminated. */
+        int (*string)(void* ctx, const char* s, size_t len);
+        int (*boolean)(void* ctx, bool v);
+        /** @p name is NULL when the value does not resolve in the dictionary. */
+        int (*enum_value)(void* ctx, const char* name, size_t len, uint64_t value);
+        int (*null)(void* ctx);
+        /** Optional stand-ins for name and enum_value that get the resolved
+         *  dictionary entry instead of its name (NULL @p def or @p variant:
+         *  not in the dictionary). When set, the matching event is not sent. */
+        int (*member)(void* ctx, const bej_dict_entry_t* def, uint16_t seq);
+        int (*enum_entry)(void* ctx, const bej_dict_entry_t* variant, uint64_t value);
+    } bej_sax_t;
+
+    /** Walks @p bej, reporting events to @p cb with @p ctx. @p proj (may be
+     *  NULL) limits the events to a projection, as in bej_decode_projected.
+     *  Returns 0, -1 on malformed input, -2 on unsupported content, or the
+     *  value a callback stopped with. */
+    int bej_sax_run(const bej_sax_t* cb, void* ctx,
+        const uint8_t* bej, size_t bej_size,
+        const bej_dictionary_t* dict_major,
+        const bej_projection_t* proj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BEJ_SAX_H */
@@ -0,0 +1,45 @@
+#ifndef BEJ_STATS_H
+#define BEJ_STATS_H
+
+#include "bej.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* Decode statistics. The counters live behind the BEJ_STATS build option
+     * (CMake -DBEJ_STATS=OFF compiles them out of the decoder entirely, and
+     * they then stay zero). A decode counts into the struct its
+     * bej_decoder_t.stats points at; NULL (the default) counts nothing.
+     * One struct per decode in flight; bej_stats_merge adds them up. */
+
+    struct bej_stats_s {
+        uint64_t bytes;             /* payload bytes consumed, header included */
+        uint64_t tuples[16];        /* SFL tuples decoded, by BEJ_FMT_* */
+        uint64_t dict_lookups;      /* member names and enum values resolved */
+        uint64_t dict_misses;       /* ...not found: "_<seq>" names, numeric enums */
+        uint64_t annotation_bytes;  /* annotation tuples stepped over */
+        uint32_t max_depth;         /* deepest set/array nesting */
+        uint32_t depth;             /* nesting while a decode runs */
+        uint64_t dict_load_ns;      /* filled by the caller (bej2json does) */
+        uint64_t read_ns;           /* likewise */
+        uint64_t decode_ns;         /* bej_decoder_run / bej_decode_parallel */
+    };
+
+    /** 1 when the library was built with BEJ_STATS. */
+    int bej_stats_enabled(void);
+
+    /** Monotonic clock for the timing fields. */
+    uint64_t bej_stats_clock_ns(void);
+
+    /** Adds @p from into @p into (max_depth: the larger). */
+    void bej_stats_merge(bej_stats_t* into, const bej_stats_t* from);
+
+    /** Writes @p st as one JSON object followed by a newline. */
+    int bej_stats_write_json(FILE* f, const bej_stats_t* st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BEJ_STATS_H */
@@ -0,0 +1,81 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "bej.h"
+#include "bej_cache.h"
+#include "registry.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Decoder daemon: keeps dictionaries loaded and decodes payloads sent over a
+ * Unix domain socket, so callers skip process start-up and dict_load.
+ *
+ * Every request and reply is a 16-byte little-endian header and a body:
+ *
+ *   request: "BEJQ" | u32 schema_len | u32 payload_len | u32 0   | schema key | payload
+ *   reply:   "BEJR" | i32 status     | u32 offset      | u32 len | JSON or error message
+ *
+ * The schema key ("Name" or "Name:version", as for dict_registry_acquire_key)
+ * picks the dictionary when the daemon serves a bundle; empty means the
+ * default. A connection carries any number of requests, answered in order. */
+
+#define BEJD_HEADER_SIZE 16u
+#define BEJD_DEFAULT_MAX_PAYLOAD (64u * 1024u * 1024u)
+#define BEJD_DEFAULT_IDLE_MS 30000
+#define BEJD_DEFAULT_REQUEST_MS 5000
+
+/** Reply statuses besides the decoder's 0 / -1 / -2 / -3. */
+enum {
+    BEJD_NO_SCHEMA = -10,   /* the schema key resolves to no dictionary */
+    BEJD_TOO_LARGE = -11,   /* payload over the daemon's limit; the connection is closed */
+    BEJD_BAD_FRAME = -12,   /* not a request header; the connection is closed */
+    BEJD_NO_MEMORY = -13
+};
+
+typedef struct {
+    const char* socket_path;
+    const bej_dictionary_t* dict;   /* used when registry is NULL */
+    dict_registry_t* registry;      /* resolves schema keys */
+    const char* schema;             /* registry key for requests without their own */
+    int threads;                    /* <= 0: one per core */
+    size_t max_payload;             /* 0: BEJD_DEFAULT_MAX_PAYLOAD */
+    bej_cache_t* cache;             /* answers repeated payloads; NULL: none */
+    int idle_timeout_ms;            /* connections idle between requests are closed; 0: BEJD_DEFAULT_IDLE_MS */
+    int request_timeout_ms;         /* a request must arrive in full within this of its first byte, and
+                                       a reply send may stall no longer; else the connection is closed.
+                                       0: BEJD_DEFAULT_REQUEST_MS */
+} bejd_opts_t;
+
+typedef struct bejd_server_s bejd_server_t;
+
+/** Binds and listens on opts->socket_path, replacing a stale socket file.
+ *  @p opts must outlive the server. Returns 0 or -1. */
+int  bejd_server_open(const bejd_opts_t* opts, bejd_server_t** out);
+/** Serves on opts->threads workers, each owning one connection at a time,
+ *  until bejd_server_stop. Clients that stall or stay idle past the
+ *  timeouts lose their connection, so they cannot hold a worker for long.
+ *  Returns 0 or -1. */
+int  bejd_server_run(bejd_server_t* srv);
+/** Asks bejd_server_run to return; safe from a signal handler. Workers
+ *  notice within ~100 ms and drop their connections, mid-request included. */
+void bejd_server_stop(bejd_server_t* srv);
+/** Closes the socket and removes its file. */
+void bejd_server_close(bejd_server_t* srv);
+
+typedef struct {
+    int32_t  status;        /* 0, a decoder error code or BEJD_* */
+    uint32_t offset;        /* where the payload stops validating, on decoder errors */
+    char*    body;          /* JSON, or the error message; NUL-terminated */
+    size_t   len;
+    size_t   cap;           /* body is reused across requests */
+} bejd_reply_t;
+
+/** Connects to a daemon; returns the socket or -1. */
+int  bejd_connect(const char* socket_path);
+/** Sends one request on @p fd and waits for its reply. @p schema may be NULL.
+ *  Returns 0 when a reply arrived (its status says how the decode went),
+ *  -1 on a socket or framing error. */
+int  bejd_request(int fd, const char* schema, const uint8_t* bej, size_t bej_size, bejd_reply_t* reply);
+void bejd_reply_free(bejd_reply_t* reply);
+
+#endif /* DAEMON_H */
@@ -3,15 +3,58 @@
 
 #include "bej.h"
 
+#define DICT_SEQ_INDEX_BUDGET_DEFAULT (256u * 1024u)
+
+/* Zero fields mean the defaults, so { 0 } loads as NULL opts do. */
+typedef struct {
+    size_t seq_index_budget;    /* bytes for DIRECT/HASH seq tables; 0: DICT_SEQ_INDEX_BUDGET_DEFAULT */
+    int    no_seq_tables;       /* build no DIRECT/HASH tables; those sets are scanned */
+    int    no_mmap;             /* copy the file to the heap instead of mapping it */
+} dict_load_opts_t;
+
 int dict_load(const char* path, bej_dictionary_t* out);
+/** @p opts may be NULL for defaults (default index budget, mmap on). */
+int dict_load_ex(const char* path, bej_dictionary_t* out, const dict_load_opts_t* opts);
+/** Parses a dictionary (raw or compiled) that the caller keeps alive until dict_free. */
+int dict_load_mem(const uint8_t* data, size_t size, bej_dictionary_t* out, const dict_load_opts_t* opts);
 void dict_free(bej_dictionary_t* d);
 
+/** Builds the per-parent seq lookup tables; called by dict_load_ex. */
+int dict_build_seq_index(bej_dictionary_t* d, size_t budget);
+/** Builds the pre-rendered JSON keys; called by dict_load_ex. Compiled images carry them. */
+int dict_build_keys(bej_dictionary_t* d);
+
 typedef struct {
     const bej_dict_entry_t* list;
     uint16_t count;
+    const bej_seq_index_t* idx;     /* NULL: linear scan */
+    const uint16_t* pool;
 } dict_subset_t;
 
+static inline const char* dict_entry_name(const bej_dictionary_t* d, const bej_dict_entry_t* e) {
+    return e->name_off ? d->names + e->name_off : NULL;
+}
+
+/** The entry's name quoted, escaped and followed by ": ", ready to copy into
+ *  JSON; its first *len - 2 bytes are the quoted name alone. NULL for unnamed
+ *  entries and for dictionaries built without keys. */
+static inline const char* dict_entry_key(const bej_dictionary_t* d, const bej_dict_entry_t* e, size_t* len) {
+    if (!d->keys || !e->name_off) return NULL;
+    const uint32_t* off = d->key_off + (e - d->entries);
+    *len = off[1] - off[0];
+    return d->keys + off[0];
+}
+
 dict_subset_t dict_children(const bej_dictionary_t* d, int parent_idx);
 const bej_dict_entry_t* dict_child_by_seq(const dict_subset_t* sub, uint16_t seq);
 
+/* Compiled dictionary images (see dict_image.c). dict_load accepts either form. */
+int dict_image_is(const uint8_t* data, size_t size);
+/** Validates the image held in d->bytes/d->size and points the tables into it. */
+int dict_image_attach(bej_dictionary_t* d);
+/** Serializes a loaded dictionary, with its seq index, into a malloc'd image. */
+int dict_image_build(const bej_dictionary_t* d, uint8_t** out_image, size_t* out_size);
+/** The checksum images carry, over any bytes; never 0, so it can serve as bej_dictionary_t.identity. */
+uint64_t dict_content_hash(const uint8_t* data, size_t size);
+
 #endif /* DICT_H */
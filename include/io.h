@@ -4,8 +4,14 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/** Reads a whole file into a malloc'd buffer. "-" reads stdin; pipes are read to EOF. */
 int read_file_all(const char* path, uint8_t** out_data, size_t* out_size);
 
+/** Maps a regular file read-only. Pipes, "-" (stdin) and empty files fall back to
+ *  read_file_all; *out_mapped says which, and must be passed to unmap_file_all. */
+int map_file_all(const char* path, const uint8_t** out_data, size_t* out_size, int* out_mapped);
+void unmap_file_all(const uint8_t* data, size_t size, int mapped);
+
 int write_file_all(const char* path, const char* data, size_t size);
 
 #endif
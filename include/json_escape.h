@@ -0,0 +1,30 @@
+#ifndef JSON_ESCAPE_H
+#define JSON_ESCAPE_H
+
+#include "sink.h"
+#include <stddef.h>
+
+/* JSON string escaping. The scan for bytes that need escaping (", \ and
+ * control characters) is vectorized; clean runs are copied in bulk. */
+
+enum {
+    JSON_ESCAPE_AUTO = 0,   /* best the CPU supports */
+    JSON_ESCAPE_SCALAR = 1, /* portable, 8 bytes per step */
+    JSON_ESCAPE_SSE2 = 2,
+    JSON_ESCAPE_AVX2 = 3
+};
+
+/** Index of the first byte in s[0..n) that needs escaping, or n. */
+size_t json_escape_scan(const char* s, size_t n);
+
+/** JSON-escapes @p n bytes without the surrounding quotes. */
+void json_escape_run(bej_sink_t* out, const char* s, size_t n);
+
+/** Pins the scan kernel (for tests and benchmarks); call it while no other
+ *  thread is escaping. Returns -1 if the CPU or build lacks it. */
+int json_escape_select(int impl);
+
+/** Name of the kernel in use: "scalar", "sse2" or "avx2". */
+const char* json_escape_impl(void);
+
+#endif /* JSON_ESCAPE_H */
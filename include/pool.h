@@ -0,0 +1,14 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/** Job callback: processes item @p idx of a pool_run() batch. */
+typedef void (*pool_job_fn)(void* ctx, size_t idx);
+
+int pool_default_threads(void);
+
+/** Runs fn(ctx, 0..njobs-1) on @p threads workers (<= 0: one per core). Blocks until done. */
+int pool_run(int threads, size_t njobs, pool_job_fn fn, void* ctx);
+
+#endif /* POOL_H */
@@ -0,0 +1,41 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "dict.h"
+
+/* Dictionary bundle: one file holding many dictionaries, indexed by schema
+ * name (the name of each dictionary's root entry) and schema version.
+ *
+ *   header | index[count] | name strings | members (4 KiB aligned)
+ *
+ * A registry maps a bundle, resolves (schema, version) in O(1) through a
+ * hash of the index, loads members lazily on first use and evicts the least
+ * recently used unpinned ones once the resident size exceeds its budget. */
+
+typedef struct dict_registry_s dict_registry_t;
+
+/** Writes a bundle of the given dictionaries (raw or compiled; raw ones are compiled). */
+int dict_bundle_write(const char* out_path, const char* const* dict_paths, size_t count);
+
+/** @p mem_budget caps resident dictionary bytes; 0 = unlimited. */
+int  dict_registry_open(const char* bundle_path, size_t mem_budget, dict_registry_t** out);
+void dict_registry_close(dict_registry_t* r);
+
+/** Pins and returns the dictionary for @p schema at @p schema_version (0 = newest).
+ *  NULL if unknown or it fails to load. Thread-safe; pair with dict_registry_release. */
+const bej_dictionary_t* dict_registry_acquire(dict_registry_t* r, const char* schema, uint32_t schema_version);
+/** Same, keyed by "Name" or "Name:version" with the version in hex. */
+const bej_dictionary_t* dict_registry_acquire_key(dict_registry_t* r, const char* key);
+void dict_registry_release(dict_registry_t* r, const bej_dictionary_t* d);
+
+typedef struct {
+    size_t members;
+    size_t resident;
+    size_t resident_bytes;
+    size_t loads;
+    size_t evictions;
+} dict_registry_stats_t;
+
+void dict_registry_stats(dict_registry_t* r, dict_registry_stats_t* out);
+
+#endif /* REGISTRY_H */
@@ -0,0 +1,70 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BEJ_SINK_BUFSZ (64u * 1024u)
+
+    typedef struct bej_sink_s bej_sink_t;
+
+    /** Drains @p n buffered bytes; returns 0 on success. NULL for memory sinks, whose buffer just grows. */
+    typedef int (*bej_sink_flush_fn)(bej_sink_t* sink, const char* data, size_t n);
+
+    struct bej_sink_s {
+        char*  buf;
+        size_t len;
+        size_t cap;
+        int    error;
+        int    owns_buf;
+        bej_sink_flush_fn flush;
+        FILE*  file;
+        int    fd;
+        int    fixed;       /* caller's buffer, never grown: running out is an error */
+    };
+
+    /** @p buf / @p cap may be NULL / 0 to get a heap buffer of BEJ_SINK_BUFSZ. */
+    int  bej_sink_init_file(bej_sink_t* sink, FILE* f, char* buf, size_t cap);
+    int  bej_sink_init_fd(bej_sink_t* sink, int fd, char* buf, size_t cap);
+    int  bej_sink_init_mem(bej_sink_t* sink, size_t initial_cap);
+    /** Memory sink over @p buf that never allocates; output past @p cap sets the error. */
+    int  bej_sink_init_fixed(bej_sink_t* sink, char* buf, size_t cap);
+
+    /** Makes room for @p n more bytes, flushing or growing; returns the write position or NULL. */
+    char* bej_sink_reserve(bej_sink_t* sink, size_t n);
+    int   bej_sink_flush(bej_sink_t* sink);
+    /** Flushes what is left and returns the first error seen, 0 if none. */
+    int   bej_sink_finish(bej_sink_t* sink);
+    /** Detaches a memory sink's buffer (NUL-terminated). The caller frees it. */
+    char* bej_sink_take(bej_sink_t* sink, size_t* out_len);
+    void  bej_sink_free(bej_sink_t* sink);
+
+    static inline void bej_sink_write(bej_sink_t* sink, const char* data, size_t n) {
+        if (sink->cap - sink->len < n && !bej_sink_reserve(sink, n)) return;
+        memcpy(sink->buf + sink->len, data, n);
+        sink->len += n;
+    }
+
+    static inline void bej_sink_putc(bej_sink_t* sink, char c) {
+        if (sink->len == sink->cap && !bej_sink_reserve(sink, 1)) return;
+        sink->buf[sink->len++] = c;
+    }
+
+    static inline void bej_sink_puts(bej_sink_t* sink, const char* s) {
+        bej_sink_write(sink, s, strlen(s));
+    }
+
+    void bej_sink_put_u64(bej_sink_t* sink, uint64_t v);
+    void bej_sink_put_i64(bej_sink_t* sink, int64_t v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SINK_H */
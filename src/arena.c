@@ -0,0 +1,37 @@
+#include "arena.h"
+
+#define ARENA_ALIGN 16
+
+void bej_arena_init(bej_arena_t* a, void* buf, size_t cap) {
+    a->base = (uint8_t*)buf;
+    a->cap = buf ? cap : 0;
+    a->used = 0;
+    a->peak = 0;
+}
+
+/* Offset of the next aligned byte, or cap when none is left. */
+static size_t arena_start(const bej_arena_t* a) {
+    uintptr_t p = (uintptr_t)(a->base + a->used);
+    size_t pad = (size_t)((ARENA_ALIGN - p % ARENA_ALIGN) % ARENA_ALIGN);
+    return pad > a->cap - a->used ? a->cap : a->used + pad;
+}
+
+void* bej_arena_alloc(bej_arena_t* a, size_t n) {
+    size_t start = arena_start(a);
+    if (n > a->cap - start || (n == 0 && start == a->cap)) return NULL;
+    a->used = start + n;
+    if (a->used > a->peak) a->peak = a->used;
+    return a->base + start;
+}
+
+void* bej_arena_rest(bej_arena_t* a, size_t* room) {
+    size_t start = arena_start(a);
+    *room = a->cap - start;
+    return *room ? a->base + start : NULL;
+}
+
+void bej_arena_commit(bej_arena_t* a, size_t n) {
+    size_t start = arena_start(a);
+    a->used = start + (n < a->cap - start ? n : a->cap - start);
+    if (a->used > a->peak) a->peak = a->used;
+}
@@ -0,0 +1,414 @@
+#define _POSIX_C_SOURCE 200809L
+#include "batch.h"
+#include "bej_project.h"
+#include "io.h"
+#include "pool.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char* str_dup_n(const char* s, size_t n) {
+    char* copy = (char*)malloc(n + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, n);
+    copy[n] = '\0';
+    return copy;
+}
+
+static int item_push(batch_item_t** items, size_t* count, size_t* cap,
+    const char* path, size_t path_len, const char* schema, size_t schema_len) {
+    if (*count == *cap) {
+        size_t ncap = *cap ? *cap * 2 : 64;
+        batch_item_t* ni = (batch_item_t*)realloc(*items, ncap * sizeof(batch_item_t));
+        if (!ni) return -1;
+        *items = ni; *cap = ncap;
+    }
+    batch_item_t it = { str_dup_n(path, path_len), schema ? str_dup_n(schema, schema_len) : NULL };
+    if (!it.path || (schema && !it.schema)) { free(it.path); free(it.schema); return -1; }
+    (*items)[(*count)++] = it;
+    return 0;
+}
+
+static int has_suffix(const char* s, const char* suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static int cmp_items(const void* a, const void* b) {
+    return strcmp(((const batch_item_t*)a)->path, ((const batch_item_t*)b)->path);
+}
+
+/* The output name of @p in_path: its basename without ".bej", @p len bytes. */
+static const char* output_name(const char* in_path, size_t* len) {
+    const char* base = strrchr(in_path, '/');
+    base = base ? base + 1 : in_path;
+    *len = strlen(base);
+    if (has_suffix(base, ".bej")) *len -= 4;
+    return base;
+}
+
+static int cmp_output_names(const void* a, const void* b) {
+    size_t na, nb;
+    const char* x = output_name((*(const batch_item_t* const*)a)->path, &na);
+    const char* y = output_name((*(const batch_item_t* const*)b)->path, &nb);
+    int c = memcmp(x, y, na < nb ? na : nb);
+    return c ? c : (na > nb) - (na < nb);
+}
+
+/* Whether two items would write the same <out_dir>/<name>.json. */
+static int has_duplicate_outputs(const batch_item_t* items, size_t count, int* dup) {
+    *dup = 0;
+    if (count < 2) return 0;
+    const batch_item_t** order = (const batch_item_t**)malloc(count * sizeof(*order));
+    if (!order) return -1;
+    for (size_t i = 0; i < count; ++i) order[i] = &items[i];
+    qsort(order, count, sizeof(*order), cmp_output_names);
+    for (size_t i = 1; i < count && !*dup; ++i) *dup = cmp_output_names(&order[i - 1], &order[i]) == 0;
+    free(order);
+    return 0;
+}
+
+static int collect_dir(const char* dir, batch_item_t** items, size_t* count, size_t* cap) {
+    DIR* d = opendir(dir);
+    if (!d) return -1;
+    size_t dlen = strlen(dir);
+    struct dirent* de;
+    int rc = 0;
+    while ((de = readdir(d)) != NULL) {
+        if (!has_suffix(de->d_name, ".bej")) continue;
+        size_t n = dlen + 1 + strlen(de->d_name);
+        char* full = (char*)malloc(n + 1);
+        if (!full) { rc = -1; break; }
+        snprintf(full, n + 1, "%s/%s", dir, de->d_name);
+        struct stat st;
+        int ok = stat(full, &st) == 0 && S_ISREG(st.st_mode);
+        if (ok && item_push(items, count, cap, full, n, NULL, 0) != 0) rc = -1;
+        free(full);
+        if (rc) break;
+    }
+    closedir(d);
+    return rc;
+}
+
+static int collect_list(const char* list, batch_item_t** items, size_t* count, size_t* cap) {
+    uint8_t* data = NULL; size_t size = 0;
+    if (read_file_all(list, &data, &size) != 0) return -1;
+    const char* p = (const char*)data;
+    const char* end = p + size;
+    int rc = 0;
+    while (p < end && rc == 0) {
+        const char* eol = memchr(p, '\n', (size_t)(end - p));
+        const char* line_end = eol ? eol : end;
+        size_t n = (size_t)(line_end - p);
+        if (n && p[n - 1] == '\r') n--;
+        const char* tab = memchr(p, '\t', n);
+        if (tab) rc = item_push(items, count, cap, p, (size_t)(tab - p), tab + 1, n - (size_t)(tab - p) - 1);
+        else if (n) rc = item_push(items, count, cap, p, n, NULL, 0);
+        p = eol ? eol + 1 : end;
+    }
+    free(data);
+    return rc;
+}
+
+int batch_collect(const char* list_or_dir, batch_item_t** out_items, size_t* out_count) {
+    *out_items = NULL; *out_count = 0;
+    batch_item_t* items = NULL; size_t count = 0, cap = 0;
+    struct stat st;
+    if (stat(list_or_dir, &st) != 0) return -1;
+
+    int rc;
+    if (S_ISDIR(st.st_mode)) {
+        rc = collect_dir(list_or_dir, &items, &count, &cap);
+        if (rc == 0) qsort(items, count, sizeof(batch_item_t), cmp_items);
+    }
+    else {
+        rc = collect_list(list_or_dir, &items, &count, &cap);
+    }
+    int dup = 0;
+    if (rc == 0) rc = has_duplicate_outputs(items, count, &dup);
+    if (rc != 0 || dup) { batch_free_items(items, count); return dup ? -2 : -1; }
+    *out_items = items;
+    *out_count = count;
+    return 0;
+}
+
+void batch_free_items(batch_item_t* items, size_t count) {
+    if (!items) return;
+    for (size_t i = 0; i < count; ++i) { free(items[i].path); free(items[i].schema); }
+    free(items);
+}
+
+typedef struct {
+    const batch_item_t* items;
+    const batch_opts_t* opts;
+    int* status;
+} batch_job_t;
+
+static char* output_path_for(const char* out_dir, const char* in_path) {
+    size_t blen;
+    const char* base = output_name(in_path, &blen);
+    size_t n = strlen(out_dir) + 1 + blen + 5;
+    char* path = (char*)malloc(n + 1);
+    if (!path) return NULL;
+    snprintf(path, n + 1, "%s/%.*s.json", out_dir, (int)blen, base);
+    return path;
+}
+
+/* The dictionary for @p item, acquired from the registry when there is one; NULL (reported) if none. */
+static const bej_dictionary_t* item_dict(const batch_opts_t* opts, const batch_item_t* item) {
+    if (!opts->registry) return opts->dict;
+    const char* key = item->schema ? item->schema : opts->schema;
+    const bej_dictionary_t* dict = key ? dict_registry_acquire_key(opts->registry, key) : NULL;
+    if (!dict) fprintf(stderr, "No dictionary for schema %s: %s\n", key ? key : "(none)", item->path);
+    return dict;
+}
+
+static int decode_item(bej_sink_t* sink, const uint8_t* bej, size_t bej_sz,
+    const bej_dictionary_t* dict, const batch_opts_t* opts) {
+    if (opts->cache && !opts->proj) return bej_cache_decode(opts->cache, sink, bej, bej_sz, dict);
+    return bej_decode_projected(sink, bej, bej_sz, dict, opts->proj);
+}
+
+static void batch_one(void* ctx, size_t idx) {
+    batch_job_t* job = (batch_job_t*)ctx;
+    const batch_opts_t* opts = job->opts;
+    const char* in_path = job->items[idx].path;
+    int rc = -1;
+
+    const uint8_t* bej = NULL; size_t bej_sz = 0; int bej_mapped = 0;
+    const bej_dictionary_t* dict = NULL;
+    char* out_path = output_path_for(opts->out_dir, in_path);
+    if (!out_path) goto done;
+    if (!(dict = item_dict(opts, &job->items[idx]))) goto done;
+    if (map_file_all(in_path, &bej, &bej_sz, &bej_mapped) != 0) {
+        fprintf(stderr, "Failed to read BEJ payload: %s\n", in_path);
+        goto done;
+    }
+    int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open output: %s\n", out_path);
+        goto done;
+    }
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    rc = bej_sink_init_fd(&sink, fd, buf, sizeof(buf));
+    if (rc == 0) {
+        rc = decode_item(&sink, bej, bej_sz, dict, opts);
+        if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+        bej_sink_free(&sink);
+    }
+    if (close(fd) != 0 && rc == 0) rc = -1;
+    if (rc != 0) fprintf(stderr, "Decode failed (code %d): %s\n", rc, in_path);
+
+done:
+    job->status[idx] = rc;
+    if (opts->registry && dict) dict_registry_release(opts->registry, dict);
+    unmap_file_all(bej, bej_sz, bej_mapped);
+    free(out_path);
+}
+
+int batch_decode(const batch_item_t* items, size_t count, const batch_opts_t* opts) {
+    int* status = (int*)calloc(count ? count : 1, sizeof(int));
+    if (!status) return -1;
+    batch_job_t job = { .items = items, .opts = opts, .status = status };
+    if (pool_run(opts->threads, count, batch_one, &job) != 0) { free(status); return -1; }
+
+    int failed = 0;
+    for (size_t i = 0; i < count; ++i) failed += status[i] != 0;
+    free(status);
+    return failed;
+}
+
+/* ---- pipeline: readers -> ready queue -> decoders -> writer, in a window of depth items ---- */
+
+typedef struct {
+    uint8_t* bej;
+    size_t   bej_sz;
+    bej_sink_t json;        /* decoded output (memory sink) */
+    int      rc;
+    int      has_output;    /* read and matched to a dictionary: the output file is written */
+    int      decoded;       /* under the lock: ready for the writer */
+} pipe_slot_t;
+
+typedef struct {
+    const batch_item_t* items;
+    size_t   count;
+    const batch_opts_t* opts;
+    pipe_slot_t* slots;     /* item i uses slots[i % depth] */
+    size_t   depth;
+    size_t*  ready;         /* read, waiting for a decoder: a ring of depth */
+    size_t   ready_head, ready_len;
+    size_t   next_read, next_write, queued;
+    int      go, cancel;
+    pthread_mutex_t lock;
+    pthread_cond_t can_read, can_decode, can_write;
+} pipe_t;
+
+static void* pipe_reader(void* arg) {
+    pipe_t* p = (pipe_t*)arg;
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        /* backpressure: item i is read only once item i - depth is written */
+        while (!p->cancel && (!p->go || (p->next_read < p->count && p->next_read - p->next_write >= p->depth)))
+            pthread_cond_wait(&p->can_read, &p->lock);
+        if (p->cancel || p->next_read >= p->count) break;
+        size_t idx = p->next_read++;
+        if (p->next_read == p->count) pthread_cond_broadcast(&p->can_read);
+        pthread_mutex_unlock(&p->lock);
+
+        pipe_slot_t* s = &p->slots[idx % p->depth];
+        s->has_output = 0;
+        s->rc = read_file_all(p->items[idx].path, &s->bej, &s->bej_sz);
+        if (s->rc != 0) fprintf(stderr, "Failed to read BEJ payload: %s\n", p->items[idx].path);
+
+        pthread_mutex_lock(&p->lock);
+        p->ready[(p->ready_head + p->ready_len++) % p->depth] = idx;
+        if (++p->queued == p->count) pthread_cond_broadcast(&p->can_decode);
+        else pthread_cond_signal(&p->can_decode);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static void pipe_decode(pipe_t* p, size_t idx) {
+    pipe_slot_t* s = &p->slots[idx % p->depth];
+    const bej_dictionary_t* dict = item_dict(p->opts, &p->items[idx]);
+    s->rc = -1;
+    if (dict) {
+        s->has_output = 1;
+        if (bej_sink_init_mem(&s->json, s->bej_sz * 2 + 256) == 0)
+            s->rc = decode_item(&s->json, s->bej, s->bej_sz, dict, p->opts);
+        if (p->opts->registry) dict_registry_release(p->opts->registry, dict);
+    }
+    free(s->bej);
+    s->bej = NULL;
+}
+
+static void* pipe_decoder(void* arg) {
+    pipe_t* p = (pipe_t*)arg;
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->cancel && !p->ready_len && p->queued < p->count)
+            pthread_cond_wait(&p->can_decode, &p->lock);
+        if (p->cancel || !p->ready_len) break;
+        size_t idx = p->ready[p->ready_head];
+        p->ready_head = (p->ready_head + 1) % p->depth;
+        p->ready_len--;
+        pthread_mutex_unlock(&p->lock);
+
+        if (p->slots[idx % p->depth].rc == 0) pipe_decode(p, idx);
+
+        pthread_mutex_lock(&p->lock);
+        p->slots[idx % p->depth].decoded = 1;
+        if (idx == p->next_write) pthread_cond_signal(&p->can_write);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static int write_fd_all(int fd, const char* data, size_t n) {
+    while (n) {
+        ssize_t w = write(fd, data, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += w; n -= (size_t)w;
+    }
+    return 0;
+}
+
+/* Writes item @p idx's output, as batch_one would have; returns its status. */
+static int pipe_write(pipe_t* p, size_t idx) {
+    pipe_slot_t* s = &p->slots[idx % p->depth];
+    int rc = s->rc;
+    if (!s->has_output) return rc;
+    const char* in_path = p->items[idx].path;
+    char* out_path = output_path_for(p->opts->out_dir, in_path);
+    int fd = out_path ? open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    if (fd < 0) {
+        if (out_path) fprintf(stderr, "Cannot open output: %s\n", out_path);
+        rc = -1;
+    }
+    else {
+        if (write_fd_all(fd, s->json.buf, s->json.len) != 0 && rc == 0) rc = -1;
+        if (close(fd) != 0 && rc == 0) rc = -1;
+        if (rc != 0) fprintf(stderr, "Decode failed (code %d): %s\n", rc, in_path);
+    }
+    free(out_path);
+    bej_sink_free(&s->json);
+    return rc;
+}
+
+int batch_pipeline(const batch_item_t* items, size_t count, const batch_opts_t* opts) {
+    if (count == 0) return 0;
+    int decoders = opts->threads > 0 ? opts->threads : pool_default_threads();
+    int readers = opts->readers > 0 ? opts->readers : 2;
+    size_t depth = opts->depth ? opts->depth : (size_t)decoders * 4;
+    if (depth > count) depth = count;
+    if ((size_t)decoders > depth) decoders = (int)depth;
+    if ((size_t)readers > depth) readers = (int)depth;
+    int nthreads = readers + decoders;
+
+    pipe_t p = { .items = items, .count = count, .opts = opts, .depth = depth };
+    int* status = (int*)calloc(count, sizeof(int));
+    p.slots = (pipe_slot_t*)calloc(depth, sizeof(pipe_slot_t));
+    p.ready = (size_t*)calloc(depth, sizeof(size_t));
+    pthread_t* tids = (pthread_t*)calloc((size_t)nthreads, sizeof(pthread_t));
+    int rc = status && p.slots && p.ready && tids ? 0 : -1;
+    if (rc == 0 && pthread_mutex_init(&p.lock, NULL) != 0) rc = -1;
+    if (rc == 0) {
+        pthread_cond_init(&p.can_read, NULL);
+        pthread_cond_init(&p.can_decode, NULL);
+        pthread_cond_init(&p.can_write, NULL);
+    }
+    if (rc != 0) {
+        free(tids); free(p.ready); free(p.slots); free(status);
+        return -1;
+    }
+
+    /* Workers wait for go; if any of them cannot be started, none runs. */
+    int started = 0;
+    for (; started < nthreads; ++started)
+        if (pthread_create(&tids[started], NULL, started < readers ? pipe_reader : pipe_decoder, &p) != 0) break;
+    pthread_mutex_lock(&p.lock);
+    if (started < nthreads) p.cancel = 1;
+    else p.go = 1;
+    pthread_cond_broadcast(&p.can_read);
+    pthread_cond_broadcast(&p.can_decode);
+
+    /* The calling thread is the writer: outputs go out in list order. */
+    while (!p.cancel && p.next_write < count) {
+        pipe_slot_t* s = &p.slots[p.next_write % depth];
+        if (!s->decoded) {
+            pthread_cond_wait(&p.can_write, &p.lock);
+            continue;
+        }
+        size_t idx = p.next_write;
+        pthread_mutex_unlock(&p.lock);
+        status[idx] = pipe_write(&p, idx);
+        pthread_mutex_lock(&p.lock);
+        s->decoded = 0;
+        p.next_write++;
+        pthread_cond_signal(&p.can_read);
+    }
+    pthread_mutex_unlock(&p.lock);
+    for (int i = 0; i < started; ++i) pthread_join(tids[i], NULL);
+
+    int failed = 0;
+    if (p.cancel) failed = batch_decode(items, count, opts);
+    else for (size_t i = 0; i < count; ++i) failed += status[i] != 0;
+
+    pthread_cond_destroy(&p.can_write);
+    pthread_cond_destroy(&p.can_decode);
+    pthread_cond_destroy(&p.can_read);
+    pthread_mutex_destroy(&p.lock);
+    free(tids); free(p.ready); free(p.slots); free(status);
+    return failed;
+}
@@ -0,0 +1,300 @@
+#include "bej_binary.h"
+#include "bej_sax.h"
+#include <float.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Leading zeros past this many are below anything a double resolves. */
+#define BIN_MAX_ZEROS 400
+
+typedef struct {
+    size_t   at;        /* header offset in the output */
+    uint32_t n;         /* members or elements so far */
+    int      is_map;
+} mp_frame_t;
+
+typedef struct {
+    bej_sink_t* out;
+    mp_frame_t* stack;  /* MessagePack: the open containers */
+    size_t depth, cap;
+} bin_writer_t;
+
+/* @p lead, then the low @p bytes bytes of @p v, big-endian. */
+static void put_be(bej_sink_t* out, uint8_t lead, uint64_t v, int bytes) {
+    char b[9];
+    b[0] = (char)lead;
+    for (int i = 0; i < bytes; ++i) b[1 + i] = (char)(v >> (8 * (bytes - 1 - i)));
+    bej_sink_write(out, b, (size_t)bytes + 1);
+}
+
+/* A 32-bit float when it holds the value exactly, else a 64-bit one. */
+static void put_float(bej_sink_t* out, uint8_t f32, uint8_t f64, double d) {
+    if (d >= -FLT_MAX && d <= FLT_MAX && (double)(float)d == d) {
+        float f = (float)d;
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        put_be(out, f32, u, 4);
+    }
+    else {
+        uint64_t u;
+        memcpy(&u, &d, sizeof(u));
+        put_be(out, f64, u, 8);
+    }
+}
+
+/* The real as the JSON writer prints it, read back by strtod so that the
+ * double is the correctly rounded one a JSON parser would get. */
+static double real_value(const bej_real_t* r) {
+    char text[64 + BIN_MAX_ZEROS];
+    int n = snprintf(text, 32, "%" PRId64 ".", r->whole);
+    size_t zeros = r->leading_zeros < BIN_MAX_ZEROS ? (size_t)r->leading_zeros : BIN_MAX_ZEROS;
+    memset(text + n, '0', zeros);
+    snprintf(text + n + zeros, sizeof(text) - n - zeros, "%" PRIu64 "e%" PRId64, r->fract, r->exp);
+    return strtod(text, NULL);
+}
+
+/* "_<seq>", the key of a property missing from the dictionary; @p buf holds 6 bytes. */
+static size_t seq_key(char* buf, uint16_t seq) {
+    size_t n = 1;
+    for (uint16_t v = seq; v >= 10; v /= 10) ++n;
+    buf[0] = '_';
+    for (size_t i = n; i > 0; --i, seq /= 10) buf[i] = (char)('0' + seq % 10);
+    return n + 1;
+}
+
+/* ---- CBOR ---- */
+
+static void cbor_head(bej_sink_t* out, uint8_t major, uint64_t v) {
+    uint8_t m = (uint8_t)(major << 5);
+    if (v < 24) bej_sink_putc(out, (char)(m | v));
+    else if (v <= 0xFF) put_be(out, m | 24, v, 1);
+    else if (v <= 0xFFFF) put_be(out, m | 25, v, 2);
+    else if (v <= 0xFFFFFFFFu) put_be(out, m | 26, v, 4);
+    else put_be(out, m | 27, v, 8);
+}
+
+static void cbor_text(bej_sink_t* out, const char* s, size_t n) {
+    cbor_head(out, 3, n);
+    bej_sink_write(out, s, n);
+}
+
+static int cbor_begin_set(void* ctx, uint64_t count) {
+    (void)count;
+    bej_sink_putc(((bin_writer_t*)ctx)->out, (char)0xBF);
+    return 0;
+}
+
+static int cbor_begin_array(void* ctx, uint64_t count) {
+    (void)count;
+    bej_sink_putc(((bin_writer_t*)ctx)->out, (char)0x9F);
+    return 0;
+}
+
+static int cbor_end(void* ctx) {
+    bej_sink_putc(((bin_writer_t*)ctx)->out, (char)0xFF);
+    return 0;
+}
+
+static int cbor_name(void* ctx, const char* name, size_t n, uint16_t seq) {
+    char buf[8];
+    if (!name) { n = seq_key(buf, seq); name = buf; }
+    cbor_text(((bin_writer_t*)ctx)->out, name, n);
+    return 0;
+}
+
+static int cbor_int64(void* ctx, int64_t v) {
+    bej_sink_t* out = ((bin_writer_t*)ctx)->out;
+    if (v >= 0) cbor_head(out, 0, (uint64_t)v);
+    else cbor_head(out, 1, ~(uint64_t)v);      /* -1 - v */
+    return 0;
+}
+
+static int cbor_real(void* ctx, const bej_real_t* r) {
+    put_float(((bin_writer_t*)ctx)->out, 0xFA, 0xFB, real_value(r));
+    return 0;
+}
+
+static int cbor_string(void* ctx, const char* s, size_t n) {
+    cbor_text(((bin_writer_t*)ctx)->out, s, n);
+    return 0;
+}
+
+static int cbor_bool(void* ctx, bool v) {
+    bej_sink_putc(((bin_writer_t*)ctx)->out, (char)(v ? 0xF5 : 0xF4));
+    return 0;
+}
+
+static int cbor_enum(void* ctx, const char* name, size_t n, uint64_t value) {
+    bej_sink_t* out = ((bin_writer_t*)ctx)->out;
+    if (name) cbor_text(out, name, n);
+    else cbor_head(out, 0, value);
+    return 0;
+}
+
+static int cbor_null(void* ctx) {
+    bej_sink_putc(((bin_writer_t*)ctx)->out, (char)0xF6);
+    return 0;
+}
+
+static const bej_sax_t cbor_sax = {
+    cbor_begin_set, cbor_end, cbor_begin_array, cbor_end, cbor_name,
+    cbor_int64, cbor_real, cbor_string, cbor_bool, cbor_enum, cbor_null, NULL, NULL
+};
+
+int bej_decode_to_cbor(bej_sink_t* out,
+    const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major,
+    const bej_projection_t* proj) {
+    bin_writer_t w = { out, NULL, 0, 0 };
+    int rc = bej_sax_run(&cbor_sax, &w, bej, bej_size, dict_major, proj);
+    if (rc == 0 && out->error) rc = -1;
+    return rc;
+}
+
+/* ---- MessagePack ---- */
+
+/* Counts a value that is an element of the open array. */
+static void mp_element(bin_writer_t* w) {
+    if (w->depth && !w->stack[w->depth - 1].is_map) w->stack[w->depth - 1].n++;
+}
+
+static void mp_int(bej_sink_t* out, int64_t v) {
+    if (v >= 0) {
+        if (v < 128) bej_sink_putc(out, (char)v);
+        else if (v <= 0xFF) put_be(out, 0xCC, (uint64_t)v, 1);
+        else if (v <= 0xFFFF) put_be(out, 0xCD, (uint64_t)v, 2);
+        else if (v <= 0xFFFFFFFF) put_be(out, 0xCE, (uint64_t)v, 4);
+        else put_be(out, 0xCF, (uint64_t)v, 8);
+    }
+    else if (v >= -32) bej_sink_putc(out, (char)(uint8_t)v);
+    else if (v >= INT8_MIN) put_be(out, 0xD0, (uint64_t)v, 1);
+    else if (v >= INT16_MIN) put_be(out, 0xD1, (uint64_t)v, 2);
+    else if (v >= INT32_MIN) put_be(out, 0xD2, (uint64_t)v, 4);
+    else put_be(out, 0xD3, (uint64_t)v, 8);
+}
+
+static void mp_str(bej_sink_t* out, const char* s, size_t n) {
+    if (n < 32) bej_sink_putc(out, (char)(0xA0 | n));
+    else if (n <= 0xFF) put_be(out, 0xD9, n, 1);
+    else if (n <= 0xFFFF) put_be(out, 0xDA, n, 2);
+    else put_be(out, 0xDB, n, 4);
+    bej_sink_write(out, s, n);
+}
+
+/* Opens a container with a header wide enough for @p count, the most members
+ * it can have; the real count goes in when it closes. */
+static int mp_begin(bin_writer_t* w, int is_map, uint64_t count) {
+    mp_element(w);
+    if (w->depth == w->cap) {
+        size_t cap = w->cap ? w->cap * 2 : 16;
+        mp_frame_t* s = (mp_frame_t*)realloc(w->stack, cap * sizeof(*s));
+        if (!s) return -1;
+        w->stack = s;
+        w->cap = cap;
+    }
+    mp_frame_t* f = &w->stack[w->depth++];
+    f->at = w->out->len;
+    f->n = 0;
+    f->is_map = is_map;
+    if (count < 16) bej_sink_putc(w->out, (char)(is_map ? 0x80 : 0x90));
+    else if (count <= 0xFFFF) put_be(w->out, is_map ? 0xDE : 0xDC, 0, 2);
+    else put_be(w->out, is_map ? 0xDF : 0xDD, 0, 4);
+    return 0;
+}
+
+static int mp_end(void* ctx) {
+    bin_writer_t* w = (bin_writer_t*)ctx;
+    const mp_frame_t* f = &w->stack[--w->depth];
+    if (w->out->error) return 0;
+    uint8_t* h = (uint8_t*)w->out->buf + f->at;
+    if ((h[0] & 0xE0) == 0x80) h[0] = (uint8_t)(h[0] | f->n);     /* fixmap, fixarray */
+    else if (h[0] == 0xDE || h[0] == 0xDC) { h[1] = (uint8_t)(f->n >> 8); h[2] = (uint8_t)f->n; }
+    else for (int i = 0; i < 4; ++i) h[1 + i] = (uint8_t)(f->n >> (8 * (3 - i)));
+    return 0;
+}
+
+static int mp_begin_set(void* ctx, uint64_t count) { return mp_begin((bin_writer_t*)ctx, 1, count); }
+static int mp_begin_array(void* ctx, uint64_t count) { return mp_begin((bin_writer_t*)ctx, 0, count); }
+
+static int mp_name(void* ctx, const char* name, size_t n, uint16_t seq) {
+    bin_writer_t* w = (bin_writer_t*)ctx;
+    char buf[8];
+    w->stack[w->depth - 1].n++;
+    if (!name) { n = seq_key(buf, seq); name = buf; }
+    mp_str(w->out, name, n);
+    return 0;
+}
+
+static int mp_int64(void* ctx, int64_t v) {
+    bin_writer_t* w = (bin_writer_t*)ctx;
+    mp_element(w);
+    mp_int(w->out, v);
+    return 0;
+}
+
+static int mp_real(void* ctx, const bej_real_t* r) {
+    bin_writer_t* w = (bin_writer_t*)ctx;
+    mp_element(w);
+    put_float(w->out, 0xCA, 0xCB, real_value(r));
+    return 0;
+}
+
+static int mp_string(void* ctx, const char* s, size_t n) {
+    bin_writer_t* w = (bin_writer_t*)ctx;
+    mp_element(w);
+    mp_str(w->out, s, n);
+    return 0;
+}
+
+static int mp_bool(void* ctx, bool v) {
+    bin_writer_t* w = (bin_writer_t*)ctx;
+    mp_element(w);
+    bej_sink_putc(w->out, (char)(v ? 0xC3 : 0xC2));
+    return 0;
+}
+
+static int mp_enum(void* ctx, const char* name, size_t n, uint64_t value) {
+    bin_writer_t* w = (bin_writer_t*)ctx;
+    mp_element(w);
+    if (name) mp_str(w->out, name, n);
+    else if (value <= INT64_MAX) mp_int(w->out, (int64_t)value);
+    else put_be(w->out, 0xCF, value, 8);
+    return 0;
+}
+
+static int mp_null(void* ctx) {
+    bin_writer_t* w = (bin_writer_t*)ctx;
+    mp_element(w);
+    bej_sink_putc(w->out, (char)0xC0);
+    return 0;
+}
+
+static const bej_sax_t msgpack_sax = {
+    mp_begin_set, mp_end, mp_begin_array, mp_end, mp_name,
+    mp_int64, mp_real, mp_string, mp_bool, mp_enum, mp_null, NULL, NULL
+};
+
+int bej_decode_to_msgpack(bej_sink_t* out,
+    const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major,
+    const bej_projection_t* proj) {
+    /* Headers are patched by offset: a sink that flushes may no longer hold them. */
+    bej_sink_t mem;
+    bej_sink_t* dst = out;
+    if (out->flush) {
+        if (bej_sink_init_mem(&mem, bej_size + 256) != 0) return -1;
+        dst = &mem;
+    }
+    bin_writer_t w = { dst, NULL, 0, 0 };
+    int rc = bej_sax_run(&msgpack_sax, &w, bej, bej_size, dict_major, proj);
+    if (rc == 0 && dst->error) rc = -1;
+    if (dst != out) {
+        if (rc == 0) bej_sink_write(out, mem.buf, mem.len);
+        bej_sink_free(&mem);
+        if (rc == 0 && out->error) rc = -1;
+    }
+    free(w.stack);
+    return rc;
+}
@@ -0,0 +1,248 @@
+#include "bej_cache.h"
+#include "bej_thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct cache_entry_s {
+    struct cache_entry_s* next;             /* hash chain */
+    struct cache_entry_s* lru_prev;
+    struct cache_entry_s* lru_next;
+    uint64_t hash;
+    uint64_t dict_id;       /* bej_dictionary_t.identity */
+    size_t   bej_size, json_len, cost;
+    int      refs;          /* readers copying out, plus one while linked */
+    unsigned char data[];   /* the payload, then its JSON */
+} cache_entry_t;
+
+struct bej_cache_s {
+    bej_mutex_t lock;
+    cache_entry_t** buckets;
+    size_t   mask;
+    cache_entry_t* lru_head;    /* most recently used */
+    cache_entry_t* lru_tail;
+    size_t   budget;
+    size_t   entries, bytes, hits, misses, evictions;
+};
+
+#define CACHE_MIN_BUCKETS 256u
+
+/* ---- hash: four 64-bit lanes, then a final mix ---- */
+
+#define H_P1 0x9E3779B185EBCA87ull
+#define H_P2 0xC2B2AE3D27D4EB4Full
+#define H_P3 0x165667B19E3779F9ull
+
+static inline uint64_t rotl64(uint64_t x, int r) { return x << r | x >> (64 - r); }
+
+static inline uint64_t load64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t lane(uint64_t acc, uint64_t v) {
+    return rotl64(acc + v * H_P2, 31) * H_P1;
+}
+
+static uint64_t payload_hash(const uint8_t* p, size_t n, uint64_t seed) {
+    uint64_t a = seed + H_P1 + H_P2, b = seed + H_P2, c = seed, d = seed - H_P1;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        a = lane(a, load64(p + i));
+        b = lane(b, load64(p + i + 8));
+        c = lane(c, load64(p + i + 16));
+        d = lane(d, load64(p + i + 24));
+    }
+    uint64_t h = rotl64(a, 1) + rotl64(b, 7) + rotl64(c, 12) + rotl64(d, 18) + (uint64_t)n;
+    for (; i + 8 <= n; i += 8) h = rotl64(h ^ lane(0, load64(p + i)), 27) * H_P1 + H_P3;
+    for (; i < n; ++i) h = rotl64(h ^ p[i] * H_P3, 11) * H_P1;
+    h ^= h >> 33; h *= H_P2;
+    h ^= h >> 29; h *= H_P3;
+    return h ^ h >> 32;
+}
+
+/* ---- table and LRU list; the caller holds the lock ---- */
+
+static void lru_unlink(bej_cache_t* c, cache_entry_t* e) {
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next; else c->lru_head = e->lru_next;
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev; else c->lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = NULL;
+}
+
+static void lru_push_front(bej_cache_t* c, cache_entry_t* e) {
+    e->lru_prev = NULL;
+    e->lru_next = c->lru_head;
+    if (c->lru_head) c->lru_head->lru_prev = e; else c->lru_tail = e;
+    c->lru_head = e;
+}
+
+static void entry_release(cache_entry_t* e) {
+    if (--e->refs == 0) free(e);
+}
+
+/* Takes @p e out of the table and the list; it is freed once no reader holds it. */
+static void entry_drop(bej_cache_t* c, cache_entry_t* e) {
+    cache_entry_t** p = &c->buckets[e->hash & c->mask];
+    while (*p != e) p = &(*p)->next;
+    *p = e->next;
+    lru_unlink(c, e);
+    c->entries--;
+    c->bytes -= e->cost;
+    entry_release(e);
+}
+
+static cache_entry_t* find(bej_cache_t* c, uint64_t hash, uint64_t dict_id, size_t bej_size) {
+    for (cache_entry_t* e = c->buckets[hash & c->mask]; e; e = e->next)
+        if (e->hash == hash && e->dict_id == dict_id && e->bej_size == bej_size) return e;
+    return NULL;
+}
+
+/* Doubles the bucket array; on allocation failure chains just get longer. */
+static void grow(bej_cache_t* c) {
+    size_t n = (c->mask + 1) * 2;
+    cache_entry_t** b = (cache_entry_t**)calloc(n, sizeof(*b));
+    if (!b) return;
+    for (size_t i = 0; i <= c->mask; ++i) {
+        cache_entry_t* e = c->buckets[i];
+        while (e) {
+            cache_entry_t* next = e->next;
+            e->next = b[e->hash & (n - 1)];
+            b[e->hash & (n - 1)] = e;
+            e = next;
+        }
+    }
+    free(c->buckets);
+    c->buckets = b;
+    c->mask = n - 1;
+}
+
+/* Adds a decoded payload unless an equal entry got there first. */
+static void insert(bej_cache_t* c, uint64_t hash, uint64_t dict_id,
+    const uint8_t* bej, size_t bej_size, const char* json, size_t json_len) {
+    size_t cost = sizeof(cache_entry_t) + bej_size + json_len;
+    if (cost > c->budget) return;
+    cache_entry_t* e = (cache_entry_t*)malloc(cost);
+    if (!e) return;
+    e->hash = hash;
+    e->dict_id = dict_id;
+    e->bej_size = bej_size;
+    e->json_len = json_len;
+    e->cost = cost;
+    e->refs = 1;
+    memcpy(e->data, bej, bej_size);
+    memcpy(e->data + bej_size, json, json_len);
+
+    bej_mutex_lock(&c->lock);
+    cache_entry_t* old = find(c, hash, dict_id, bej_size);
+    if (old && !memcmp(old->data, bej, bej_size)) {
+        bej_mutex_unlock(&c->lock);
+        free(e);
+        return;
+    }
+    e->next = c->buckets[hash & c->mask];
+    c->buckets[hash & c->mask] = e;
+    lru_push_front(c, e);
+    c->entries++;
+    c->bytes += cost;
+    while (c->bytes > c->budget && c->lru_tail != e) {
+        entry_drop(c, c->lru_tail);
+        c->evictions++;
+    }
+    if (c->entries > c->mask + 1) grow(c);
+    bej_mutex_unlock(&c->lock);
+}
+
+int bej_cache_open(size_t mem_budget, bej_cache_t** out) {
+    *out = NULL;
+    bej_cache_t* c = (bej_cache_t*)calloc(1, sizeof(*c));
+    if (!c) return -1;
+    c->buckets = (cache_entry_t**)calloc(CACHE_MIN_BUCKETS, sizeof(*c->buckets));
+    if (!c->buckets || bej_mutex_init(&c->lock) != 0) {
+        free(c->buckets);
+        free(c);
+        return -1;
+    }
+    c->mask = CACHE_MIN_BUCKETS - 1;
+    c->budget = mem_budget;
+    *out = c;
+    return 0;
+}
+
+void bej_cache_clear(bej_cache_t* c) {
+    bej_mutex_lock(&c->lock);
+    while (c->lru_head) entry_drop(c, c->lru_head);
+    bej_mutex_unlock(&c->lock);
+}
+
+void bej_cache_close(bej_cache_t* c) {
+    if (!c) return;
+    bej_cache_clear(c);
+    free(c->buckets);
+    bej_mutex_destroy(&c->lock);
+    free(c);
+}
+
+/* Stored JSON into @p out; output larger than a flushing sink's buffer goes
+ * straight to its flush instead of growing the buffer to hold a copy. */
+static void write_out(bej_sink_t* out, const char* data, size_t n) {
+    if (!out->flush || out->cap - out->len >= n) {
+        bej_sink_write(out, data, n);
+        return;
+    }
+    if (bej_sink_flush(out) == 0 && out->flush(out, data, n) != 0) out->error = -1;
+}
+
+int bej_cache_decode(bej_cache_t* c, bej_sink_t* out,
+    const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major) {
+    /* A dictionary the loaders did not fill in cannot be told from another. */
+    uint64_t dict_id = dict_major->identity;
+    if (!dict_id) return bej_decode_to_sink(out, bej, bej_size, dict_major);
+    uint64_t hash = payload_hash(bej, bej_size, dict_id * H_P3);
+
+    /* The lock covers the lookup only; the payload is compared and the JSON
+     * copied under a reference, so hits on other threads do not wait. */
+    bej_mutex_lock(&c->lock);
+    cache_entry_t* e = find(c, hash, dict_id, bej_size);
+    if (e) {
+        e->refs++;
+        lru_unlink(c, e);
+        lru_push_front(c, e);
+    }
+    bej_mutex_unlock(&c->lock);
+    int hit = e && !memcmp(e->data, bej, bej_size);
+    if (hit) write_out(out, (const char*)e->data + bej_size, e->json_len);
+    bej_mutex_lock(&c->lock);
+    if (e) entry_release(e);
+    if (hit) c->hits++; else c->misses++;
+    bej_mutex_unlock(&c->lock);
+    if (hit) return out->error ? -1 : 0;
+
+    /* A memory sink holds the new JSON in one piece; any other gets it copied
+     * from a memory sink once it is complete. */
+    int rc;
+    if (!out->flush) {
+        size_t start = out->len;
+        rc = bej_decode_to_sink(out, bej, bej_size, dict_major);
+        if (rc == 0) insert(c, hash, dict_id, bej, bej_size, out->buf + start, out->len - start);
+        return rc;
+    }
+    bej_sink_t tmp;
+    if (bej_sink_init_mem(&tmp, bej_size * 2 + 256) != 0) return -1;
+    rc = bej_decode_to_sink(&tmp, bej, bej_size, dict_major);
+    write_out(out, tmp.buf, tmp.len);
+    if (rc == 0 && out->error) rc = -1;
+    if (rc == 0) insert(c, hash, dict_id, bej, bej_size, tmp.buf, tmp.len);
+    bej_sink_free(&tmp);
+    return rc;
+}
+
+void bej_cache_stats(bej_cache_t* c, bej_cache_stats_t* out) {
+    bej_mutex_lock(&c->lock);
+    out->hits = c->hits;
+    out->misses = c->misses;
+    out->entries = c->entries;
+    out->bytes = c->bytes;
+    out->evictions = c->evictions;
+    bej_mutex_unlock(&c->lock);
+}
@@ -1,54 +1,28 @@
 ﻿#include "bej.h"
 #include "dict.h"
+#include "sink.h"
+#include "bej_internal.h"
+#include "bej_sax.h"
+#include "bej_stats.h"
+#include "json_escape.h"
+#include "pool.h"
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 #include <assert.h>
 
-static void json_write_escaped(FILE* out, const char* s, size_t n);
+static void json_write_escaped(bej_sink_t* out, const char* s, size_t n);
 
 
-static int pp_level = 0;
-
-static void pp_indent(FILE* out) {
-    for (int i = 0; i < pp_level * 2; ++i) fputc(' ', out);
-}
-
-
-static void pp_nl(FILE* out) {
-    fputc('\n', out);
-    pp_indent(out);
-}
-
-static int decode_enum_with_dict(FILE* out,
-    bej_stream_t* s,
-    uint64_t length,
-    const bej_dictionary_t* dict,
-    const dict_subset_t* current_children,
-    uint16_t seq_of_field) {
-    (void)length;
-
-    uint64_t val_seq = 0;
-    if (bej_read_nnint(s, &val_seq) != 0) return -1;
-
-    const bej_dict_entry_t* enum_field = dict_child_by_seq(current_children, (uint16_t)seq_of_field);
-    if (!enum_field) { fprintf(out, "%" PRIu64, val_seq); return 0; }
-
-
-    dict_subset_t variants = dict_children(dict, (int)(enum_field - dict->entries));
-    const bej_dict_entry_t* variant = dict_child_by_seq(&variants, (uint16_t)val_seq);
-    if (!variant || !variant->name) {
-        fprintf(out, "%" PRIu64, val_seq);
-        return 0;
-    }
-    
-    json_write_escaped(out, variant->name, strlen(variant->name));
-    return 0;
+void bej_pp_nl(bej_decoder_t* dec) {
+    size_t n = 1 + (size_t)dec->pp_level * 2;
+    char* p = bej_sink_reserve(dec->out, n);
+    if (!p) return;
+    p[0] = '\n';
+    memset(p + 1, ' ', n - 1);
+    dec->out->len += n;
 }
 
-
-
-
 void bej_stream_init(bej_stream_t* s, const uint8_t* buf, size_t n) {
     s->p = buf; s->size = n; s->pos = 0;
 }
@@ -73,260 +47,302 @@ int bej_expect_bytes(bej_stream_t* s, const uint8_t* bytes, size_t n) {
     return 0;
 }
 
-int bej_read_nnint(bej_stream_t* s, uint64_t* out) {
-    uint8_t count = 0;
-    if (bej_read_u8(s, &count) != 0) return -1;
-    if (count == 0) { *out = 0; return 0; }
+/* Little-endian load of 8 bytes from an unaligned address. */
+static inline uint64_t load_le64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+/* nnint at p with avail bytes left: the length byte, then up to 8 LE bytes.
+ * With 9 bytes available the value is one unaligned load and a mask. */
+static inline int nnint_at(const uint8_t* p, size_t avail, uint64_t* out, size_t* used) {
+    if (avail == 0) return -1;
+    uint8_t count = p[0];
     if (count > 8) return -1;
-    uint8_t buf[8] = { 0 };
-    if (bej_read(s, buf, count) != 0) return -1;
-    uint64_t v = 0;
-    for (int i = (int)count - 1; i >= 0; --i) v = (v << 8) | buf[i];
-    *out = v;
+    if (avail >= 9) {
+        uint64_t v = load_le64(p + 1);
+        *out = count == 8 ? v : v & ((UINT64_C(1) << (count * 8)) - 1);
+    }
+    else {
+        if ((size_t)count + 1 > avail) return -1;
+        uint64_t v = 0;
+        for (int i = count; i >= 1; --i) v = (v << 8) | p[i];
+        *out = v;
+    }
+    *used = (size_t)count + 1;
+    return 0;
+}
+
+int bej_read_nnint(bej_stream_t* s, uint64_t* out) {
+    size_t used;
+    if (nnint_at(s->p + s->pos, s->size - s->pos, out, &used) != 0) return -1;
+    s->pos += used;
     return 0;
 }
 
 int bej_peek_format(bej_stream_t* s, uint8_t* fmt, uint8_t* flags) {
-    size_t saved = s->pos;
     uint64_t dummy;
-    if (bej_read_nnint(s, &dummy) != 0) { s->pos = saved; return -1; }
-    uint8_t ff;
-    if (bej_read_u8(s, &ff) != 0) { s->pos = saved; return -1; }
+    size_t used;
+    if (nnint_at(s->p + s->pos, s->size - s->pos, &dummy, &used) != 0) return -1;
+    if (s->pos + used >= s->size) return -1;
+    uint8_t ff = s->p[s->pos + used];
     *fmt = (uint8_t)((ff >> 4) & 0x0F);
     *flags = (uint8_t)(ff & 0x0F);
-    s->pos = saved;
     return 0;
 }
 
 
 int bej_read_sfl(bej_stream_t* s, uint64_t* seq, uint8_t* fmt, uint64_t* len, uint8_t* flags) {
-    if (bej_read_nnint(s, seq) != 0) return -1;
-    uint8_t ff;
-    if (bej_read_u8(s, &ff) != 0) return -1;
+    const uint8_t* p = s->p + s->pos;
+    size_t avail = s->size - s->pos, u1, u2;
+    if (nnint_at(p, avail, seq, &u1) != 0 || u1 >= avail) return -1;
+    uint8_t ff = p[u1];
+    if (nnint_at(p + u1 + 1, avail - u1 - 1, len, &u2) != 0) return -1;
     *fmt = (uint8_t)((ff >> 4) & 0x0F);
     *flags = (uint8_t)(ff & 0x0F);
-    if (bej_read_nnint(s, len) != 0) return -1;
+    s->pos += u1 + 1 + u2;
     return 0;
 }
 
 
-static void json_write_escaped(FILE* out, const char* s, size_t n) {
-    fputc('"', out);
-    for (size_t i = 0; i < n; ++i) {
-        unsigned char c = (unsigned char)s[i];
-        switch (c) {
-        case '\"': fputs("\\\"", out); break;
-        case '\\': fputs("\\\\", out); break;
-        case '\b': fputs("\\b", out); break;
-        case '\f': fputs("\\f", out); break;
-        case '\n': fputs("\\n", out); break;
-        case '\r': fputs("\\r", out); break;
-        case '\t': fputs("\\t", out); break;
-        default:
-            if (c < 0x20) fprintf(out, "\\u%04x", c);
-            else fputc(c, out);
-        }
-    }
-    fputc('"', out);
+static void json_write_escaped(bej_sink_t* out, const char* s, size_t n) {
+    bej_sink_putc(out, '"');
+    json_escape_run(out, s, n);
+    bej_sink_putc(out, '"');
 }
 
-static int json_write_name(FILE* out, const char* name) {
+int bej_json_name(bej_sink_t* out, const char* name, size_t n) {
     if (!name) return -1;
-    json_write_escaped(out, name, strlen(name));
-    fputc(':', out);
-    fputc(' ', out); 
+    json_write_escaped(out, name, n);
+    bej_sink_write(out, ": ", 2);
     return 0;
 }
 
-
-static int read_exact(bej_stream_t* s, uint8_t* buf, size_t n) {
-    return bej_read(s, buf, n);
+void bej_json_seq_name(bej_sink_t* out, uint16_t seq) {
+    bej_sink_write(out, "\"_", 2);
+    bej_sink_put_u64(out, seq);
+    bej_sink_write(out, "\": ", 3);
 }
 
-
-
-static int decode_enum(FILE* out, bej_stream_t* s, uint64_t length) {
-    (void)length;
-    uint64_t val = 0;
-    if (bej_read_nnint(s, &val) != 0) return -1;
-    fprintf(out, "%" PRIu64, val);
-    return 0;
+void bej_json_key(bej_sink_t* out, const bej_dictionary_t* dict, const bej_dict_entry_t* def, uint16_t seq) {
+    size_t n;
+    const char* key = def && def->name_len ? dict_entry_key(dict, def, &n) : NULL;
+    if (key) bej_sink_write(out, key, n);
+    else if (def && def->name_len) bej_json_name(out, dict_entry_name(dict, def), def->name_len);
+    else bej_json_seq_name(out, seq);
 }
 
-static int decode_string(FILE* out, bej_stream_t* s, uint64_t length) {
-    if (length == 0 || length > (1ull << 31)) return -1;
-    char* tmp = (char*)malloc((size_t)length);
-    if (!tmp) return -1;
-    if (read_exact(s, (uint8_t*)tmp, (size_t)length) != 0) { free(tmp); return -1; }
 
-    size_t n = (size_t)length;
-    if (n && tmp[n - 1] == '\0') n -= 1;
-    json_write_escaped(out, tmp, n);
-    free(tmp);
-    return 0;
+/* ---- traversal: one walk over the SFL tuples, reported as bej_sax_t events ---- */
+
+typedef struct par_plan_s par_plan_t;
+
+typedef struct {
+    const bej_dictionary_t* dict;
+    const bej_projection_t* proj;
+    const bej_sax_t* cb;
+    void* ctx;
+    par_plan_t* par;        /* JSON writer only: large containers are split into runs (bej_decode_parallel) */
+    bej_stats_t* stats;     /* NULL: not counted */
+} sax_walk_t;
+
+#ifdef BEJ_STATS
+#define STAT_ADD(w, field, n) do { if ((w)->stats) (w)->stats->field += (n); } while (0)
+#define STAT_ENTER(w) do { bej_stats_t* st_ = (w)->stats; \
+    if (st_ && ++st_->depth > st_->max_depth) st_->max_depth = st_->depth; } while (0)
+#define STAT_LEAVE(w) do { if ((w)->stats) (w)->stats->depth--; } while (0)
+#else
+#define STAT_ADD(w, field, n) ((void)(w), (void)sizeof(n))
+#define STAT_ENTER(w) ((void)0)
+#define STAT_LEAVE(w) ((void)0)
+#endif
+
+/* A run of consecutive members or elements of one container, rendered on its own. */
+typedef struct {
+    size_t   start, end;    /* the run's tuples in the payload */
+    uint64_t count;
+    int      is_set;
+    int      has_sub;
+    dict_subset_t sub;      /* what the members resolve in */
+    int      pp_level;
+    int      comma;         /* the container has output before the run */
+    size_t   at;            /* where the run goes in the main output */
+    bej_sink_t out;
+    int      rc;
+    bej_stats_t stats;
+} par_run_t;
+
+struct par_plan_s {
+    const uint8_t* bej;
+    size_t   bej_size;
+    const bej_dictionary_t* dict;
+    size_t   run_bytes;     /* target run size; containers at least this big are split */
+    par_run_t* runs;
+    size_t   count, cap;
+    bej_stats_t* stats;
+};
+
+#define SAX_EMIT(w, fn, ...) ((w)->cb->fn ? (w)->cb->fn((w)->ctx, __VA_ARGS__) : 0)
+#define SAX_EMIT0(w, fn) ((w)->cb->fn ? (w)->cb->fn((w)->ctx) : 0)
+
+/* Two's complement, little-endian, 1..8 bytes. */
+static int64_t sign_extend(const uint8_t* b, size_t n) {
+    uint64_t v = 0;
+    for (size_t i = n; i-- > 0;) v = (v << 8) | b[i];
+    if (n < 8 && (b[n - 1] & 0x80)) v |= ~UINT64_C(0) << (n * 8);
+    return (int64_t)v;
 }
 
-static int decode_boolean(FILE* out, bej_stream_t* s, uint64_t length) {
-    if (length != 1) return -1;
-    uint8_t v;
-    if (bej_read_u8(s, &v) != 0) return -1;
-    fputs(v ? "true" : "false", out);
-    return 0;
+static int decode_integer(const sax_walk_t* w, bej_stream_t* s, uint64_t length) {
+    if (length == 0 || length > 8 || length > s->size - s->pos) return -1;
+    int64_t v = sign_extend(s->p + s->pos, (size_t)length);
+    s->pos += (size_t)length;
+    return SAX_EMIT(w, int64, v);
 }
 
-static int decode_integer(FILE* out, bej_stream_t* s, uint64_t length) {
-    if (length == 0 || length > 8) return -1;
-    uint8_t buf[8] = { 0 };
-    if (read_exact(s, buf, (size_t)length) != 0) return -1;
-    int64_t v = 0;
-    for (int i = (int)length - 1; i >= 0; --i) v = (v << 8) | buf[i];
-
-    if (length < 8 && (buf[length - 1] & 0x80)) {
-        for (int i = (int)length; i < 8; ++i) ((uint8_t*)&v)[i] = 0xFF;
-    }
-    fprintf(out, "%" PRId64, v);
-    return 0;
-}
-
-static int decode_real(FILE* out, bej_stream_t* s, uint64_t length) {
+static int decode_real(const sax_walk_t* w, bej_stream_t* s, uint64_t length) {
     size_t start = s->pos;
+    bej_real_t r = { 0, 0, 0, 0 };
     uint64_t lenWhole = 0; if (bej_read_nnint(s, &lenWhole) != 0) return -1;
-    if (lenWhole > 8) return -1;
-    int64_t whole = 0; 
-    if (lenWhole) {
-        uint8_t w[8] = { 0 }; if (read_exact(s, w, (size_t)lenWhole) != 0) return -1;
-        for (int i = (int)lenWhole - 1; i >= 0; --i) whole = (whole << 8) | w[i];
-        if (lenWhole < 8 && (w[lenWhole - 1] & 0x80)) { for (int i = (int)lenWhole; i < 8; ++i) ((uint8_t*)&whole)[i] = 0xFF; }
-    }
-    uint64_t lz = 0; if (bej_read_nnint(s, &lz) != 0) return -1;
-    uint64_t fract = 0; if (bej_read_nnint(s, &fract) != 0) return -1;
+    if (lenWhole > 8 || lenWhole > s->size - s->pos) return -1;
+    if (lenWhole) r.whole = sign_extend(s->p + s->pos, (size_t)lenWhole);
+    s->pos += (size_t)lenWhole;
+    if (bej_read_nnint(s, &r.leading_zeros) != 0) return -1;
+    if (bej_read_nnint(s, &r.fract) != 0) return -1;
     uint64_t lenExp = 0; if (bej_read_nnint(s, &lenExp) != 0) return -1;
-    int64_t expv = 0;
-    if (lenExp) {
-        if (lenExp > 8) return -1;
-        uint8_t e[8] = { 0 }; if (read_exact(s, e, (size_t)lenExp) != 0) return -1;
-        for (int i = (int)lenExp - 1; i >= 0; --i) expv = (expv << 8) | e[i];
-        if (lenExp < 8 && (e[lenExp - 1] & 0x80)) { for (int i = (int)lenExp; i < 8; ++i) ((uint8_t*)&expv)[i] = 0xFF; }
-    }
-  
-    fprintf(out, "%lld.", (long long)whole);
-    for (uint64_t i = 0; i < lz; ++i) fputc('0', out);
-    fprintf(out, "%llu", (unsigned long long)fract);
-    if (expv) fprintf(out, "e%lld", (long long)expv);
+    if (lenExp > 8 || lenExp > s->size - s->pos) return -1;
+    if (lenExp) r.exp = sign_extend(s->p + s->pos, (size_t)lenExp);
+    s->pos += (size_t)lenExp;
 
-   
     if ((uint64_t)(s->pos - start) != length) return -1;
-    return 0;
+    return SAX_EMIT(w, real, &r);
 }
 
+/* Reported straight from the payload: no copy, no allocation. */
+static int decode_string(const sax_walk_t* w, bej_stream_t* s, uint64_t length) {
+    if (length == 0 || length > s->size - s->pos) return -1;
+    const char* str = (const char*)s->p + s->pos;
+    size_t n = (size_t)length;
+    s->pos += n;
+    if (str[n - 1] == '\0') n -= 1;
+    return SAX_EMIT(w, string, str, n);
+}
 
-static int decode_value(FILE* out,
-    bej_stream_t* s,
-    const bej_dictionary_t* dict,
-    const dict_subset_t* current_children,
-    bool is_array_elem);
+static int decode_boolean(const sax_walk_t* w, bej_stream_t* s, uint64_t length) {
+    uint8_t v;
+    if (length != 1 || bej_read_u8(s, &v) != 0) return -1;
+    return SAX_EMIT(w, boolean, v != 0);
+}
 
-static int decode_set(FILE* out,
-    bej_stream_t* s,
-    const bej_dictionary_t* dict,
-    const dict_subset_t* parent_children) {
-    uint64_t seq_with_sel = 0, len = 0;
-    uint8_t fmt = 0, flags = 0;
-    if (bej_read_sfl(s, &seq_with_sel, &fmt, &len, &flags) != 0) return -1;
-    if (fmt != BEJ_FMT_SET) return -1;
-
-    uint64_t count = 0; if (bej_read_nnint(s, &count) != 0) return -1;
-
-    uint16_t seq = (uint16_t)((seq_with_sel >> 1) & 0xFFFF);
-    uint8_t selector = (uint8_t)(seq_with_sel & 0x1);
-    if (selector != BEJ_SEL_MAJOR) return -2; 
-
-    const bej_dict_entry_t* entry = NULL;
-    dict_subset_t children;
-    if (parent_children) {
-        entry = dict_child_by_seq(parent_children, seq);
-        if (!entry) return -1;
-        children = dict_children(dict, (int)(entry - dict->entries));
+static int decode_enum(const sax_walk_t* w, bej_stream_t* s,
+    const dict_subset_t* current_children, uint16_t seq_of_field) {
+    const bej_dictionary_t* dict = w->dict;
+    uint64_t val_seq = 0;
+    if (bej_read_nnint(s, &val_seq) != 0) return -1;
+
+    const bej_dict_entry_t* enum_field = dict_child_by_seq(current_children, seq_of_field);
+    const bej_dict_entry_t* variant = NULL;
+    if (enum_field) {
+        dict_subset_t variants = dict_children(dict, (int)(enum_field - dict->entries));
+        variant = dict_child_by_seq(&variants, (uint16_t)val_seq);
     }
-    else {
-        children = dict_children(dict, -1);
+    STAT_ADD(w, dict_lookups, 1);
+    if (!variant || !variant->name_off) {
+        STAT_ADD(w, dict_misses, 1);
+        variant = NULL;
     }
+    if (w->cb->enum_entry) return w->cb->enum_entry(w->ctx, variant, val_seq);
+    if (!variant) return SAX_EMIT(w, enum_value, NULL, 0, val_seq);
+    return SAX_EMIT(w, enum_value, dict_entry_name(dict, variant), variant->name_len, val_seq);
+}
 
-    fputc('{', out);
-    for (uint64_t i = 0; i < count; ++i) {
-        if (i) fputc(',', out);
-        uint8_t cf = 0, cflags = 0;
-        if (bej_peek_format(s, &cf, &cflags) != 0) return -1;
-
-        size_t saved = s->pos;
-        uint64_t cseq_sel = 0, clen = 0; uint8_t cfmt = 0, cfl = 0;
-        if (bej_read_sfl(s, &cseq_sel, &cfmt, &clen, &cfl) != 0) return -1;
-        s->pos = saved;
-
-        uint16_t cseq = (uint16_t)((cseq_sel >> 1) & 0xFFFF);
-        uint8_t csel = (uint8_t)(cseq_sel & 0x1);
-
-        if (csel == BEJ_SEL_MAJOR) {
-            const bej_dict_entry_t* child_def = dict_child_by_seq(&children, cseq);
-            if (!child_def) return -1;
-            if (child_def->name && *child_def->name) {
-                json_write_name(out, child_def->name);
-            }
-            else {
-                fprintf(out, "\"_%u\":", cseq);
-            }
-            if (decode_value(out, s, dict, &children, false) != 0) return -1;
-        }
-        else {
-
-            uint64_t skip_seq = 0, skip_len = 0; uint8_t skip_fmt = 0, skip_flags2 = 0;
-            if (bej_read_sfl(s, &skip_seq, &skip_fmt, &skip_len, &skip_flags2) != 0) return -1;
-
-            if (s->pos + skip_len > s->size) return -1;
-            s->pos += (size_t)skip_len;
-
-            return -2;
-        }
+/* A non-container value whose SFL tuple has been read. */
+static int decode_leaf(const sax_walk_t* w, bej_stream_t* s,
+    uint8_t fmt, uint64_t seq_sel, uint64_t len,
+    const dict_subset_t* current_children) {
+    switch (fmt) {
+    case BEJ_FMT_STRING:  return decode_string(w, s, len);
+    case BEJ_FMT_INTEGER: return decode_integer(w, s, len);
+    case BEJ_FMT_BOOLEAN: return decode_boolean(w, s, len);
+    case BEJ_FMT_REAL:    return decode_real(w, s, len);
+    case BEJ_FMT_ENUM:
+        return decode_enum(w, s, current_children, (uint16_t)((seq_sel >> 1) & 0xFFFF));
+    case BEJ_FMT_NULL:
+        if (len > s->size - s->pos) return -1;
+        s->pos += (size_t)len;
+        return SAX_EMIT0(w, null);
+    default:
+        return -1;
     }
-    fputc('}', out);
-    return 0;
 }
 
-static int decode_array(FILE* out,
+static int decode_tuple_value(const sax_walk_t* w,
     bej_stream_t* s,
-    const bej_dictionary_t* dict,
-    const dict_subset_t* parent_children) {
-    uint64_t seq_with_sel = 0, len = 0; uint8_t fmt = 0, flags = 0;
-    if (bej_read_sfl(s, &seq_with_sel, &fmt, &len, &flags) != 0) return -1;
-    if (fmt != BEJ_FMT_ARRAY) return -1;
-
-    uint64_t count = 0; if (bej_read_nnint(s, &count) != 0) return -1;
+    uint64_t seq_sel, uint8_t fmt, uint64_t len,
+    const dict_subset_t* current_children,
+    const bej_proj_node_t* pn);
+
+static int par_container(const sax_walk_t* w, bej_stream_t* s, int is_set, uint64_t count,
+    const dict_subset_t* sub);
+
+/* Named dictionary entry of member @p seq of a set whose children are @p kids (NULL: unknown set). */
+static const bej_dict_entry_t* member_def(const sax_walk_t* w, const dict_subset_t* kids, uint16_t seq) {
+    const bej_dict_entry_t* def = kids ? dict_child_by_seq(kids, seq) : NULL;
+    STAT_ADD(w, dict_lookups, 1);
+    if (def && def->name_len) return def;
+    STAT_ADD(w, dict_misses, 1);
+    return NULL;
+}
 
-    uint16_t seq = (uint16_t)((seq_with_sel >> 1) & 0xFFFF);
-    uint8_t selector = (uint8_t)(seq_with_sel & 0x1);
-    if (selector != BEJ_SEL_MAJOR) return -2;
+static int emit_name(const sax_walk_t* w, const bej_dict_entry_t* def, uint16_t seq) {
+    if (w->cb->member) return w->cb->member(w->ctx, def, seq);
+    return SAX_EMIT(w, name, def ? dict_entry_name(w->dict, def) : NULL, def ? def->name_len : 0, seq);
+}
 
-    const bej_dict_entry_t* arr_def = dict_child_by_seq(parent_children, seq);
-    if (!arr_def) return -1;
+static int decode_value(const sax_walk_t* w,
+    bej_stream_t* s,
+    const dict_subset_t* current_children,
+    const bej_proj_node_t* pn) {
+    uint64_t seq_sel = 0, len = 0; uint8_t fmt = 0, flags = 0;
+    if (bej_read_sfl(s, &seq_sel, &fmt, &len, &flags) != 0) return -1;
+    return decode_tuple_value(w, s, seq_sel, fmt, len, current_children, pn);
+}
 
-    dict_subset_t elem_sub = dict_children(dict, (int)(arr_def - dict->entries));
+/* Projection step for a member or element with @p key: returns 0 to report it
+ * (*child is NULL when the whole subtree is wanted), 1 to skip it. A path that
+ * continues below a leaf selects nothing there. */
+static int proj_step(const sax_walk_t* w, const bej_proj_node_t* pn,
+    uint32_t key, uint8_t fmt, const bej_proj_node_t** child) {
+    *child = NULL;
+    if (!pn) return 0;
+    const bej_proj_node_t* c = bej_proj_child(w->proj, pn, key);
+    if (!c) return 1;
+    if (c->all) return 0;
+    if (fmt != BEJ_FMT_SET && fmt != BEJ_FMT_ARRAY) return 1;
+    *child = c;
+    return 0;
+}
 
-    fputc('[', out);
-    for (uint64_t i = 0; i < count; ++i) {
-        if (i) fputc(',', out);
-        if (decode_value(out, s, dict, &elem_sub, true) != 0) return -1;
-    }
-    fputc(']', out);
+/* Steps over the rest of a container once every selected child has been seen. */
+static int proj_skip_rest(bej_stream_t* s, size_t start, uint64_t len) {
+    if (len > s->size - start || start + (size_t)len < s->pos) return -1;
+    s->pos = start + (size_t)len;
     return 0;
 }
 
-static int decode_value(FILE* out,
+/* The value of a set or array tuple, after its SFL header. */
+static int decode_container(const sax_walk_t* w,
     bej_stream_t* s,
-    const bej_dictionary_t* dict,
+    uint64_t seq_sel, uint8_t fmt, uint64_t len,
     const dict_subset_t* current_children,
-    bool is_array_elem) {
-    uint64_t seq_sel = 0, len = 0; uint8_t fmt = 0, flags = 0;
-    if (bej_read_sfl(s, &seq_sel, &fmt, &len, &flags) != 0) return -1;
+    const bej_proj_node_t* pn) {
+    const bej_dictionary_t* dict = w->dict;
+    size_t start = s->pos;
+    int rc;
 
     switch (fmt) {
     case BEJ_FMT_SET: {
@@ -350,49 +366,39 @@ static int decode_value(FILE* out,
             }
         }
 
-        fputc('{', out);
-        int emitted = 0;
-        if (count == 0) { fputc('}', out); return 0; }
-        pp_level++;
-        pp_nl(out);
-
+        if ((rc = SAX_EMIT(w, begin_set, count)) != 0) return rc;
+        if (w->par && !pn && len >= w->par->run_bytes) {
+            rc = par_container(w, s, 1, count, have_schema ? &kids : NULL);
+            return rc ? rc : SAX_EMIT0(w, end_set);
+        }
+        uint32_t emitted = 0;
         for (uint64_t i = 0; i < count; ++i) {
-            size_t saved = s->pos;
+            if (pn && emitted == pn->child_count) {
+                if (proj_skip_rest(s, start, len) != 0) return -1;
+                break;
+            }
+            size_t at = s->pos;
             uint64_t cseq_sel = 0, clen = 0; uint8_t cfmt = 0, cfl = 0;
             if (bej_read_sfl(s, &cseq_sel, &cfmt, &clen, &cfl) != 0) return -1;
-            s->pos = saved;
 
             uint16_t cseq = (uint16_t)((cseq_sel >> 1) & 0xFFFF);
             uint8_t  csel = (uint8_t)(cseq_sel & 0x1);
 
-            if (csel == BEJ_SEL_MAJOR) {
-                const char* nm = NULL;
-                if (have_schema) {
-                    const bej_dict_entry_t* child_def = dict_child_by_seq(&kids, cseq);
-                    if (child_def && child_def->name && *child_def->name) nm = child_def->name;
-                }
-                if (emitted++) { fputc(',', out); pp_nl(out); }
-                if (nm) {
-                    json_write_escaped(out, nm, strlen(nm));
-                    fputc(':', out); fputc(' ', out);
-                    if (decode_value(out, s, dict, &kids, false) != 0) return -1;
-                }
-                else {
-                    fprintf(out, "\"_%u\": ", cseq);
-                    if (decode_value(out, s, dict, NULL, false) != 0) return -1;
-                }
+            const bej_proj_node_t* cpn = NULL;
+            if (csel == BEJ_SEL_MAJOR && proj_step(w, pn, cseq, cfmt, &cpn) == 0) {
+                const bej_dict_entry_t* def = member_def(w, have_schema ? &kids : NULL, cseq);
+                emitted++;
+                if ((rc = emit_name(w, def, cseq)) != 0) return rc;
+                rc = decode_tuple_value(w, s, cseq_sel, cfmt, clen, def ? &kids : NULL, cpn);
+                if (rc != 0) return rc;
             }
             else {
-                uint64_t skip_seq = 0, skip_len = 0; uint8_t skip_fmt = 0, skip_flags2 = 0;
-                if (bej_read_sfl(s, &skip_seq, &skip_fmt, &skip_len, &skip_flags2) != 0) return -1;
-                if (s->pos + skip_len > s->size) return -1;
-                s->pos += (size_t)skip_len;
+                if (clen > s->size - s->pos) return -1;
+                s->pos += (size_t)clen;
+                if (csel != BEJ_SEL_MAJOR) STAT_ADD(w, annotation_bytes, s->pos - at);
             }
         }
-        pp_level--;
-        pp_nl(out);
-        fputc('}', out);
-        return 0;
+        return SAX_EMIT0(w, end_set);
     }
 
     case BEJ_FMT_ARRAY: {
@@ -411,37 +417,37 @@ static int decode_value(FILE* out,
             }
         }
 
-        fputc('[', out);
-        if (count == 0) { fputc(']', out); return 0; }
-        pp_level++;
-        pp_nl(out);
-
-        for (uint64_t i = 0; i < count; ++i) {
-            if (i) { fputc(',', out); pp_nl(out); }
-            if (decode_value(out, s, dict, have_schema ? &elem_sub : NULL, true) != 0) return -1;
+        if ((rc = SAX_EMIT(w, begin_array, count)) != 0) return rc;
+        if (w->par && !pn && len >= w->par->run_bytes) {
+            rc = par_container(w, s, 0, count, have_schema ? &elem_sub : NULL);
+            return rc ? rc : SAX_EMIT0(w, end_array);
         }
-        pp_level--;
-        pp_nl(out);
-        fputc(']', out);
-        return 0;
-    }
-
-    case BEJ_FMT_STRING:  return decode_string(out, s, len);
-    case BEJ_FMT_INTEGER: return decode_integer(out, s, len);
-    case BEJ_FMT_BOOLEAN: return decode_boolean(out, s, len);
-    case BEJ_FMT_REAL:    return decode_real(out, s, len);
-
-    case BEJ_FMT_ENUM: {
-        
-        uint16_t seq_field = (uint16_t)((seq_sel >> 1) & 0xFFFF);
-        return decode_enum_with_dict(out, s, len, dict, current_children, seq_field);
-    }
-    case BEJ_FMT_NULL: {
-
-        if (s->pos + len > s->size) return -1;
-        s->pos += (size_t)len;
-        fputs("null", out);
-        return 0;
+        if (!pn) {
+            for (uint64_t i = 0; i < count; ++i)
+                if ((rc = decode_value(w, s, have_schema ? &elem_sub : NULL, NULL)) != 0) return rc;
+        }
+        else {
+            /* Selected elements keep their order; the rest are stepped over by length. */
+            uint32_t emitted = 0;
+            for (uint64_t i = 0; i < count; ++i) {
+                if (emitted == pn->child_count) {
+                    if (proj_skip_rest(s, start, len) != 0) return -1;
+                    break;
+                }
+                uint64_t eseq_sel = 0, elen = 0; uint8_t efmt = 0, efl = 0;
+                if (bej_read_sfl(s, &eseq_sel, &efmt, &elen, &efl) != 0) return -1;
+                const bej_proj_node_t* epn = NULL;
+                if (i > UINT32_MAX || proj_step(w, pn, (uint32_t)i, efmt, &epn) != 0) {
+                    if (elen > s->size - s->pos) return -1;
+                    s->pos += (size_t)elen;
+                    continue;
+                }
+                emitted++;
+                rc = decode_tuple_value(w, s, eseq_sel, efmt, elen, have_schema ? &elem_sub : NULL, epn);
+                if (rc != 0) return rc;
+            }
+        }
+        return SAX_EMIT0(w, end_array);
     }
 
     default:
@@ -449,9 +455,25 @@ static int decode_value(FILE* out,
     }
 }
 
-int bej_decode_to_json(FILE* out,
-    const uint8_t* bej, size_t bej_size,
-    const bej_dictionary_t* dict_major) {
+/** Walks the value of a tuple whose SFL header has already been read.
+ *  @p pn is the projection node for this value; NULL reports all of it. */
+static int decode_tuple_value(const sax_walk_t* w,
+    bej_stream_t* s,
+    uint64_t seq_sel, uint8_t fmt, uint64_t len,
+    const dict_subset_t* current_children,
+    const bej_proj_node_t* pn) {
+    STAT_ADD(w, tuples[fmt & 0x0F], 1);
+    if (fmt != BEJ_FMT_SET && fmt != BEJ_FMT_ARRAY)
+        return decode_leaf(w, s, fmt, seq_sel, len, current_children);
+    /* Entered and left here, so no way out of a container leaves the depth raised. */
+    STAT_ENTER(w);
+    int rc = decode_container(w, s, seq_sel, fmt, len, current_children, pn);
+    STAT_LEAVE(w);
+    return rc;
+}
+
+/* Header, then the root tuple; bytes after the root value are ignored. */
+static int sax_walk(const sax_walk_t* w, const uint8_t* bej, size_t bej_size) {
     bej_stream_t ss; bej_stream_init(&ss, bej, bej_size);
 
     uint8_t ver[4];
@@ -462,5 +484,439 @@ int bej_decode_to_json(FILE* out,
     if (!(schemaClass == 0x00 || schemaClass == 0x01)) {
         return -2;
     }
-    return decode_value(out, &ss, dict_major, NULL, false);
+    const bej_proj_node_t* root = w->proj ? &w->proj->nodes[0] : NULL;
+    int rc = decode_value(w, &ss, NULL, root && !root->all ? root : NULL);
+    STAT_ADD(w, bytes, ss.pos);
+    return rc;
+}
+
+int bej_sax_run(const bej_sax_t* cb, void* ctx,
+    const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major,
+    const bej_projection_t* proj) {
+    sax_walk_t w = { dict_major, proj, cb, ctx, NULL, NULL };
+    return sax_walk(&w, bej, bej_size);
+}
+
+/* ---- JSON writer: the bej_sax_t consumer behind bej_decode_to_sink ---- */
+
+/* Plain value writers, also used by the push decoder, which lays out
+ * separators and indentation itself. */
+
+static int json_raw_int64(void* ctx, int64_t v) {
+    bej_sink_put_i64(((bej_decoder_t*)ctx)->out, v);
+    return 0;
+}
+
+static int json_raw_real(void* ctx, const bej_real_t* r) {
+    bej_sink_t* out = ((bej_decoder_t*)ctx)->out;
+    bej_sink_put_i64(out, r->whole);
+    bej_sink_putc(out, '.');
+    for (uint64_t i = 0; i < r->leading_zeros; ++i) bej_sink_putc(out, '0');
+    bej_sink_put_u64(out, r->fract);
+    if (r->exp) { bej_sink_putc(out, 'e'); bej_sink_put_i64(out, r->exp); }
+    return 0;
+}
+
+static int json_raw_string(void* ctx, const char* s, size_t n) {
+    json_write_escaped(((bej_decoder_t*)ctx)->out, s, n);
+    return 0;
+}
+
+static int json_raw_bool(void* ctx, bool v) {
+    bej_sink_t* out = ((bej_decoder_t*)ctx)->out;
+    if (v) bej_sink_write(out, "true", 4);
+    else bej_sink_write(out, "false", 5);
+    return 0;
+}
+
+static int json_raw_enum(void* ctx, const char* name, size_t n, uint64_t value) {
+    bej_sink_t* out = ((bej_decoder_t*)ctx)->out;
+    if (name) json_write_escaped(out, name, n);
+    else bej_sink_put_u64(out, value);
+    return 0;
+}
+
+/* Named values go out as the dictionary's pre-rendered key, less its ": ". */
+static int json_raw_enum_entry(void* ctx, const bej_dict_entry_t* variant, uint64_t value) {
+    bej_decoder_t* dec = (bej_decoder_t*)ctx;
+    size_t n;
+    const char* key = variant ? dict_entry_key(dec->dict, variant, &n) : NULL;
+    if (key) {
+        bej_sink_write(dec->out, key, n - 2);
+        return 0;
+    }
+    return json_raw_enum(ctx, variant ? dict_entry_name(dec->dict, variant) : NULL,
+        variant ? variant->name_len : 0, value);
+}
+
+static int json_raw_null(void* ctx) {
+    bej_sink_write(((bej_decoder_t*)ctx)->out, "null", 4);
+    return 0;
+}
+
+static const bej_sax_t json_leaf_sax = {
+    .int64 = json_raw_int64, .real = json_raw_real, .string = json_raw_string,
+    .boolean = json_raw_bool, .enum_value = json_raw_enum, .null = json_raw_null,
+    .enum_entry = json_raw_enum_entry
+};
+
+/* Separator and indentation for the next member or element. */
+static void json_child(bej_decoder_t* dec) {
+    if (dec->has_member) bej_sink_putc(dec->out, ',');
+    bej_pp_nl(dec);
+    dec->has_member = 1;
+}
+
+/* Called before every value: array elements lay out their own line. */
+static void json_value(bej_decoder_t* dec) {
+    if (dec->named) dec->named = 0;
+    else if (dec->pp_level) json_child(dec);
+}
+
+static int json_open(void* ctx, char c) {
+    bej_decoder_t* dec = (bej_decoder_t*)ctx;
+    json_value(dec);
+    bej_sink_putc(dec->out, c);
+    dec->pp_level++;
+    dec->has_member = 0;
+    return 0;
+}
+
+/* Empty containers (or ones a projection left empty) stay on one line. */
+static int json_close(void* ctx, char c) {
+    bej_decoder_t* dec = (bej_decoder_t*)ctx;
+    dec->pp_level--;
+    if (dec->has_member) bej_pp_nl(dec);
+    bej_sink_putc(dec->out, c);
+    dec->has_member = 1;
+    return 0;
+}
+
+static int json_begin_set(void* ctx, uint64_t count) { (void)count; return json_open(ctx, '{'); }
+static int json_end_set(void* ctx) { return json_close(ctx, '}'); }
+static int json_begin_array(void* ctx, uint64_t count) { (void)count; return json_open(ctx, '['); }
+static int json_end_array(void* ctx) { return json_close(ctx, ']'); }
+
+static int json_name(void* ctx, const char* name, size_t n, uint16_t seq) {
+    bej_decoder_t* dec = (bej_decoder_t*)ctx;
+    json_child(dec);
+    if (name) bej_json_name(dec->out, name, n);
+    else bej_json_seq_name(dec->out, seq);
+    dec->named = 1;
+    return 0;
+}
+
+static int json_key(void* ctx, const bej_dict_entry_t* def, uint16_t seq) {
+    bej_decoder_t* dec = (bej_decoder_t*)ctx;
+    json_child(dec);
+    bej_json_key(dec->out, dec->dict, def, seq);
+    dec->named = 1;
+    return 0;
+}
+
+static int json_int64(void* ctx, int64_t v) { json_value((bej_decoder_t*)ctx); return json_raw_int64(ctx, v); }
+static int json_real(void* ctx, const bej_real_t* r) { json_value((bej_decoder_t*)ctx); return json_raw_real(ctx, r); }
+static int json_string(void* ctx, const char* s, size_t n) { json_value((bej_decoder_t*)ctx); return json_raw_string(ctx, s, n); }
+static int json_bool(void* ctx, bool v) { json_value((bej_decoder_t*)ctx); return json_raw_bool(ctx, v); }
+static int json_enum(void* ctx, const char* name, size_t n, uint64_t value) {
+    json_value((bej_decoder_t*)ctx);
+    return json_raw_enum(ctx, name, n, value);
+}
+static int json_enum_entry(void* ctx, const bej_dict_entry_t* variant, uint64_t value) {
+    json_value((bej_decoder_t*)ctx);
+    return json_raw_enum_entry(ctx, variant, value);
+}
+static int json_null(void* ctx) { json_value((bej_decoder_t*)ctx); return json_raw_null(ctx); }
+
+static const bej_sax_t json_sax = {
+    json_begin_set, json_end_set, json_begin_array, json_end_array, json_name,
+    json_int64, json_real, json_string, json_bool, json_enum, json_null,
+    json_key, json_enum_entry
+};
+
+int bej_json_leaf(bej_decoder_t* dec,
+    bej_stream_t* s,
+    uint8_t fmt, uint64_t seq_sel, uint64_t len,
+    const dict_subset_t* current_children) {
+    sax_walk_t w = { dec->dict, NULL, &json_leaf_sax, dec, NULL, NULL };
+    return decode_leaf(&w, s, fmt, seq_sel, len, current_children);
+}
+
+int bej_json_value(bej_decoder_t* dec, bej_stream_t* s, const dict_subset_t* current_children) {
+    sax_walk_t w = { dec->dict, NULL, &json_sax, dec, NULL, NULL };
+    dec->has_member = dec->named = 0;
+    return decode_value(&w, s, current_children, NULL);
+}
+
+int bej_json_tuple(bej_decoder_t* dec, bej_stream_t* s,
+    uint64_t seq_sel, uint8_t fmt, uint64_t len,
+    const dict_subset_t* current_children) {
+    sax_walk_t w = { dec->dict, NULL, &json_sax, dec, NULL, NULL };
+    return decode_tuple_value(&w, s, seq_sel, fmt, len, current_children, NULL);
+}
+
+void bej_json_member_key(bej_decoder_t* dec, const bej_dict_entry_t* def, uint16_t seq) {
+    json_key(dec, def, seq);
+}
+
+void bej_json_open(bej_decoder_t* dec, char c) { json_open(dec, c); }
+void bej_json_close(bej_decoder_t* dec, char c) { json_close(dec, c); }
+void bej_json_null(bej_decoder_t* dec) { json_null(dec); }
+
+void bej_decoder_init(bej_decoder_t* dec, const bej_dictionary_t* dict_major, bej_sink_t* out) {
+    memset(dec, 0, sizeof(*dec));
+    dec->dict = dict_major;
+    dec->out = out;
+}
+
+int bej_decoder_run(bej_decoder_t* dec, const uint8_t* bej, size_t bej_size) {
+    sax_walk_t w = { dec->dict, dec->proj, &json_sax, dec, NULL, dec->stats };
+    dec->pp_level = 0;
+    dec->has_member = dec->named = 0;
+#ifdef BEJ_STATS
+    uint64_t t0 = dec->stats ? bej_stats_clock_ns() : 0;
+#endif
+    int rc = sax_walk(&w, bej, bej_size);
+    if (rc == 0 && dec->out->error) rc = -1;
+#ifdef BEJ_STATS
+    if (dec->stats) dec->stats->decode_ns += bej_stats_clock_ns() - t0;
+#endif
+    return rc;
+}
+
+int bej_decode_to_sink(bej_sink_t* out,
+    const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major) {
+    bej_decoder_t dec;
+    bej_decoder_init(&dec, dict_major, out);
+    return bej_decoder_run(&dec, bej, bej_size);
+}
+
+int bej_decode_to_json(FILE* out,
+    const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major) {
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    if (bej_sink_init_file(&sink, out, buf, sizeof(buf)) != 0) return -1;
+    int rc = bej_decode_to_sink(&sink, bej, bej_size, dict_major);
+    if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+    bej_sink_free(&sink);
+    return rc;
+}
+
+int bej_decode_to_fd(int fd,
+    const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major) {
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    if (bej_sink_init_fd(&sink, fd, buf, sizeof(buf)) != 0) return -1;
+    int rc = bej_decode_to_sink(&sink, bej, bej_size, dict_major);
+    if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+    bej_sink_free(&sink);
+    return rc;
+}
+
+int bej_decode_to_arena(const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major, bej_arena_t* arena,
+    char** out_json, size_t* out_len) {
+    *out_json = NULL;
+    if (out_len) *out_len = 0;
+    size_t room = 0;
+    char* buf = (char*)bej_arena_rest(arena, &room);
+    bej_sink_t sink;
+    if (!buf || bej_sink_init_fixed(&sink, buf, room) != 0) return -1;
+    int rc = bej_decode_to_sink(&sink, bej, bej_size, dict_major);
+    bej_sink_putc(&sink, '\0');
+    if (rc == 0 && sink.error) rc = -1;
+    if (rc == 0) {
+        bej_arena_commit(arena, sink.len);
+        *out_json = buf;
+        if (out_len) *out_len = sink.len - 1;
+    }
+    return rc;
+}
+
+int bej_decode_to_buffer(const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major,
+    char** out_json, size_t* out_len) {
+    *out_json = NULL;
+    if (out_len) *out_len = 0;
+    bej_sink_t sink;
+    if (bej_sink_init_mem(&sink, bej_size * 4 + 256) != 0) return -1;
+    int rc = bej_decode_to_sink(&sink, bej, bej_size, dict_major);
+    if (rc == 0) {
+        *out_json = bej_sink_take(&sink, out_len);
+        if (!*out_json) rc = -1;
+    }
+    bej_sink_free(&sink);
+    return rc;
+}
+
+/* ---- parallel decoding ---- */
+
+/* Smallest run worth a task of its own. */
+#define PAR_MIN_RUN (16u * 1024u)
+
+/* Queues the pending run when it renders anything; it takes the run's place
+ * in the main output, so the container counts as having a member from here on. */
+static int par_add(const sax_walk_t* w, par_run_t* run, int* emits, int is_set, const dict_subset_t* sub) {
+    par_plan_t* plan = w->par;
+    bej_decoder_t* dec = (bej_decoder_t*)w->ctx;
+    if (run->count && *emits) {
+        if (plan->count == plan->cap) {
+            size_t ncap = plan->cap ? plan->cap * 2 : 64;
+            par_run_t* nr = (par_run_t*)realloc(plan->runs, ncap * sizeof(par_run_t));
+            if (!nr) return -1;
+            plan->runs = nr; plan->cap = ncap;
+        }
+        par_run_t* r = &plan->runs[plan->count++];
+        *r = *run;
+        r->is_set = is_set;
+        r->has_sub = sub != NULL;
+        if (sub) r->sub = *sub;
+        r->pp_level = dec->pp_level;
+        r->comma = dec->has_member;
+        r->at = dec->out->len;
+#ifdef BEJ_STATS
+        if (w->stats) r->stats.depth = w->stats->depth;
+#endif
+        dec->has_member = 1;
+    }
+    else if (run->count) STAT_ADD(w, annotation_bytes, run->end - run->start);   /* nothing but annotations */
+    run->count = 0;
+    *emits = 0;
+    return 0;
+}
+
+/** Members of a large set or array: consecutive small ones are grouped into
+ *  runs of about plan->run_bytes, found by their SFL lengths alone; members
+ *  that are large containers themselves are walked here and split in turn. */
+static int par_container(const sax_walk_t* w, bej_stream_t* s, int is_set, uint64_t count,
+    const dict_subset_t* sub) {
+    par_run_t run = { 0 };
+    int emits = 0, rc;
+    for (uint64_t i = 0; i < count; ++i) {
+        size_t at = s->pos;
+        uint64_t cseq_sel = 0, clen = 0; uint8_t cfmt = 0, cfl = 0;
+        if (bej_read_sfl(s, &cseq_sel, &cfmt, &clen, &cfl) != 0 || clen > s->size - s->pos) return -1;
+        int shown = !is_set || (cseq_sel & 0x1) == BEJ_SEL_MAJOR;
+        if ((cfmt == BEJ_FMT_SET || cfmt == BEJ_FMT_ARRAY) && clen >= w->par->run_bytes) {
+            if (par_add(w, &run, &emits, is_set, sub) != 0) return -1;
+            if (!shown) {
+                s->pos += (size_t)clen;
+                STAT_ADD(w, annotation_bytes, s->pos - at);
+                continue;
+            }
+            const dict_subset_t* csub = sub;
+            if (is_set) {
+                uint16_t cseq = (uint16_t)((cseq_sel >> 1) & 0xFFFF);
+                const bej_dict_entry_t* def = member_def(w, sub, cseq);
+                if ((rc = emit_name(w, def, cseq)) != 0) return rc;
+                if (!def) csub = NULL;
+            }
+            if ((rc = decode_tuple_value(w, s, cseq_sel, cfmt, clen, csub, NULL)) != 0) return rc;
+            continue;
+        }
+        if (!run.count) run.start = at;
+        run.count++;
+        emits |= shown;
+        s->pos += (size_t)clen;
+        run.end = s->pos;
+        if (run.end - run.start >= w->par->run_bytes && par_add(w, &run, &emits, is_set, sub) != 0) return -1;
+    }
+    return par_add(w, &run, &emits, is_set, sub);
+}
+
+/* Renders one run as the serial decoder would inside its container. */
+static void par_render(void* ctx, size_t idx) {
+    par_plan_t* plan = (par_plan_t*)ctx;
+    par_run_t* r = &plan->runs[idx];
+    if (bej_sink_init_mem(&r->out, (r->end - r->start) * 2 + 256) != 0) { r->rc = -1; return; }
+    bej_decoder_t dec;
+    bej_decoder_init(&dec, plan->dict, &r->out);
+    dec.pp_level = r->pp_level;
+    sax_walk_t w = { plan->dict, NULL, &json_sax, &dec, NULL, plan->stats ? &r->stats : NULL };
+    bej_stream_t s;
+    bej_stream_init(&s, plan->bej, plan->bej_size);
+    s.pos = r->start;
+    const dict_subset_t* sub = r->has_sub ? &r->sub : NULL;
+    int rc = 0;
+    for (uint64_t i = 0; i < r->count && rc == 0; ++i) {
+        if (!r->is_set) { rc = decode_value(&w, &s, sub, NULL); continue; }
+        size_t at = s.pos;
+        uint64_t cseq_sel = 0, clen = 0; uint8_t cfmt = 0, cfl = 0;
+        if (bej_read_sfl(&s, &cseq_sel, &cfmt, &clen, &cfl) != 0) { rc = -1; break; }
+        if ((cseq_sel & 0x1) != BEJ_SEL_MAJOR) {
+            s.pos += (size_t)clen;
+            STAT_ADD(&w, annotation_bytes, s.pos - at);
+            continue;
+        }
+        uint16_t cseq = (uint16_t)((cseq_sel >> 1) & 0xFFFF);
+        const bej_dict_entry_t* def = member_def(&w, sub, cseq);
+        json_key(&dec, def, cseq);
+        rc = decode_tuple_value(&w, &s, cseq_sel, cfmt, clen, def ? sub : NULL, NULL);
+    }
+    if (rc == 0 && (s.pos != r->end || r->out.error)) rc = -1;
+    r->rc = rc;
+}
+
+/* Serial decode into @p out, counted into @p stats. */
+static int decode_serial(bej_sink_t* out, const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major, bej_stats_t* stats) {
+    bej_decoder_t dec;
+    bej_decoder_init(&dec, dict_major, out);
+    dec.stats = stats;
+    return bej_decoder_run(&dec, bej, bej_size);
+}
+
+int bej_decode_parallel(bej_sink_t* out,
+    const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major, int threads, bej_stats_t* stats) {
+    if (threads <= 0) threads = pool_default_threads();
+    /* About four runs per thread when the whole payload is one big array. */
+    size_t run_bytes = bej_size / ((size_t)threads * 4);
+    if (threads == 1 || run_bytes < PAR_MIN_RUN) return decode_serial(out, bej, bej_size, dict_major, stats);
+
+#ifndef BEJ_STATS
+    stats = NULL;
+#endif
+    uint64_t t0 = stats ? bej_stats_clock_ns() : 0;
+    bej_stats_t counted = { 0 };
+    par_plan_t plan = { bej, bej_size, dict_major, run_bytes, NULL, 0, 0, stats ? &counted : NULL };
+    bej_sink_t main_out;
+    if (bej_sink_init_mem(&main_out, 4096) != 0) return -1;
+    bej_decoder_t dec;
+    bej_decoder_init(&dec, dict_major, &main_out);
+    sax_walk_t w = { dict_major, NULL, &json_sax, &dec, &plan, plan.stats };
+    int rc = sax_walk(&w, bej, bej_size);
+    if (rc == 0 && main_out.error) rc = -1;
+    if (rc == 0 && pool_run(threads, plan.count, par_render, &plan) != 0) rc = -1;
+    for (size_t i = 0; i < plan.count && rc == 0; ++i) rc = plan.runs[i].rc;
+
+    if (rc == 0) {
+        size_t prev = 0;
+        for (size_t i = 0; i < plan.count; ++i) {
+            const par_run_t* r = &plan.runs[i];
+            bej_sink_write(out, main_out.buf + prev, r->at - prev);
+            if (r->comma) bej_sink_putc(out, ',');
+            bej_sink_write(out, r->out.buf, r->out.len);
+            prev = r->at;
+        }
+        bej_sink_write(out, main_out.buf + prev, main_out.len - prev);
+        if (out->error) rc = -1;
+    }
+    if (rc == 0 && stats) {
+        for (size_t i = 0; i < plan.count; ++i) bej_stats_merge(&counted, &plan.runs[i].stats);
+        counted.depth = 0;
+        counted.decode_ns = bej_stats_clock_ns() - t0;
+        bej_stats_merge(stats, &counted);
+    }
+    for (size_t i = 0; i < plan.count; ++i) bej_sink_free(&plan.runs[i].out);
+    free(plan.runs);
+    bej_sink_free(&main_out);
+    /* A payload that fails anywhere is decoded again serially, so the error
+     * and the partial output are exactly those of bej_decode_to_sink. */
+    if (rc != 0 && !out->error) rc = decode_serial(out, bej, bej_size, dict_major, stats);
+    return rc;
 }
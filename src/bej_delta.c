@@ -0,0 +1,218 @@
+#include "bej_delta.h"
+#include "bej_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* A major-selector member of a set, located but not decoded. */
+typedef struct {
+    uint64_t seq_sel, len;
+    size_t   ff;        /* the format byte: tuples compare from here to the end of the value */
+    size_t   val;
+    uint16_t seq;
+    uint8_t  fmt;
+    uint8_t  matched;
+} delta_member_t;
+
+typedef struct {
+    bej_decoder_t dec;
+    const bej_dictionary_t* dict;
+    const uint8_t* buf[2];      /* [0] prev, [1] cur */
+    size_t size[2];
+    delta_member_t* members;    /* one stack for all levels being compared */
+    size_t used, cap;
+} delta_t;
+
+/* A set of the patch, opened only once something below it has changed. */
+typedef struct delta_frame_s {
+    const struct delta_frame_s* parent;     /* NULL: the root */
+    const bej_dict_entry_t* def;
+    uint16_t seq;
+    int      opened;
+} delta_frame_t;
+
+static void open_frame(delta_t* d, delta_frame_t* f) {
+    if (f->opened) return;
+    if (f->parent) {
+        open_frame(d, (delta_frame_t*)f->parent);
+        bej_json_member_key(&d->dec, f->def, f->seq);
+    }
+    bej_json_open(&d->dec, '{');
+    f->opened = 1;
+}
+
+/* Length of the common prefix of @p a and @p b, known to be at least @p from. */
+static size_t common_prefix(const uint8_t* a, const uint8_t* b, size_t from, size_t n) {
+    size_t i = from < n ? from : n;
+    while (i + 64 <= n && !memcmp(a + i, b + i, 64)) i += 64;
+    while (i < n && a[i] == b[i]) ++i;
+    return i;
+}
+
+/* Pushes the major members of the set whose value (count first) starts at
+ * @p pos. Members that end by @p same_end are stepped over: both sides have
+ * them, byte for byte, at the same offsets. */
+static int collect(delta_t* d, int side, size_t pos, size_t end, size_t same_end, size_t* n) {
+    bej_stream_t s = { d->buf[side], end, pos };
+    uint64_t count = 0;
+    if (bej_read_nnint(&s, &count) != 0) return -1;
+    *n = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        delta_member_t m;
+        if (bej_read_nnint(&s, &m.seq_sel) != 0) return -1;
+        m.ff = s.pos;
+        if (s.pos >= end) return -1;
+        m.fmt = (uint8_t)(s.p[s.pos++] >> 4);
+        if (bej_read_nnint(&s, &m.len) != 0 || m.len > end - s.pos) return -1;
+        m.val = s.pos;
+        s.pos += (size_t)m.len;
+        if ((m.seq_sel & 1) != BEJ_SEL_MAJOR || s.pos <= same_end) continue;
+        if (d->used == d->cap) {
+            size_t cap = d->cap ? d->cap * 2 : 64;
+            delta_member_t* grown = (delta_member_t*)realloc(d->members, cap * sizeof(*grown));
+            if (!grown) return -1;
+            d->members = grown;
+            d->cap = cap;
+        }
+        m.seq = (uint16_t)((m.seq_sel >> 1) & 0xFFFF);
+        m.matched = 0;
+        d->members[d->used++] = m;
+        ++*n;
+    }
+    return 0;
+}
+
+static int same_tuple(const delta_t* d, const delta_member_t* a, const delta_member_t* b) {
+    return a->fmt == b->fmt && a->val - a->ff == b->val - b->ff && a->len == b->len
+        && !memcmp(d->buf[0] + a->ff, d->buf[1] + b->ff, (size_t)(b->val - b->ff + b->len));
+}
+
+/* Named entry of member @p seq in @p kids (NULL: unknown set), as the decoder resolves it. */
+static const bej_dict_entry_t* member_def(const dict_subset_t* kids, uint16_t seq) {
+    const bej_dict_entry_t* def = kids ? dict_child_by_seq(kids, seq) : NULL;
+    return def && def->name_len ? def : NULL;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Prev member paired with cur member @p i: the one at the same position when
+ * the seqs agree (the usual case), else the first unpaired one with that seq,
+ * found in @p by_seq ((seq << 32 | position), sorted; built on first use). */
+static delta_member_t* pair_of(delta_t* d, size_t pb, size_t np, size_t i, uint16_t seq,
+    uint64_t** by_seq, int* rc) {
+    delta_member_t* p = d->members + pb;
+    if (i < np && p[i].seq == seq && !p[i].matched) return &p[i];
+    if (!*by_seq) {
+        *by_seq = (uint64_t*)malloc((np ? np : 1) * sizeof(uint64_t));
+        if (!*by_seq) { *rc = -1; return NULL; }
+        for (size_t k = 0; k < np; ++k) (*by_seq)[k] = (uint64_t)p[k].seq << 32 | k;
+        qsort(*by_seq, np, sizeof(uint64_t), cmp_u64);
+    }
+    size_t lo = 0, hi = np;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((*by_seq)[mid] >> 32 < seq) lo = mid + 1;
+        else hi = mid;
+    }
+    for (; lo < np && (*by_seq)[lo] >> 32 == seq; ++lo)
+        if (!p[(uint32_t)(*by_seq)[lo]].matched) return &p[(uint32_t)(*by_seq)[lo]];
+    return NULL;
+}
+
+/** Patch for the sets whose values start at @p pos (prev, cur) and end at @p end,
+ *  members resolving in @p kids. When both start at the same offset, the
+ *  payloads are known to agree up to @p differ (an offset). */
+static int diff_set(delta_t* d, delta_frame_t* f, const size_t pos[2], const size_t end[2],
+    size_t differ, const dict_subset_t* kids) {
+    size_t pb = d->used, np = 0, nc = 0;
+    size_t same = common_prefix(d->buf[0] + pos[0], d->buf[1] + pos[1],
+        pos[0] == pos[1] && differ > pos[0] ? differ - pos[0] : 0,
+        end[0] - pos[0] < end[1] - pos[1] ? end[0] - pos[0] : end[1] - pos[1]);
+    int rc = collect(d, 0, pos[0], end[0], pos[0] + same, &np);
+    size_t cb = d->used;
+    if (rc == 0) rc = collect(d, 1, pos[1], end[1], pos[1] + same, &nc);
+    uint64_t* by_seq = NULL;
+
+    for (size_t i = 0; rc == 0 && i < nc; ++i) {
+        delta_member_t c = d->members[cb + i];
+        delta_member_t* p = pair_of(d, pb, np, i, c.seq, &by_seq, &rc);
+        if (rc != 0) break;
+        if (p) p->matched = 1;
+        if (p && same_tuple(d, p, &c)) continue;
+
+        const bej_dict_entry_t* def = member_def(kids, c.seq);
+        if (p && p->fmt == BEJ_FMT_SET && c.fmt == BEJ_FMT_SET) {
+            /* As in the decoder, a set without a named entry resolves in the root's children. */
+            dict_subset_t sub = dict_children(d->dict, def ? (int)(def - d->dict->entries) : -1);
+            delta_frame_t child = { f, def, c.seq, 0 };
+            size_t cpos[2] = { p->val, c.val };
+            size_t cend[2] = { p->val + (size_t)p->len, c.val + (size_t)c.len };
+            rc = diff_set(d, &child, cpos, cend, pos[1] + same, &sub);
+            if (rc == 0 && child.opened) bej_json_close(&d->dec, '}');
+            continue;
+        }
+        open_frame(d, f);
+        bej_json_member_key(&d->dec, def, c.seq);
+        bej_stream_t s = { d->buf[1], d->size[1], c.val };
+        rc = bej_json_tuple(&d->dec, &s, c.seq_sel, c.fmt, c.len, def ? kids : NULL);
+    }
+    for (size_t i = 0; rc == 0 && i < np; ++i) {
+        const delta_member_t* p = &d->members[pb + i];
+        if (p->matched) continue;
+        open_frame(d, f);
+        bej_json_member_key(&d->dec, member_def(kids, p->seq), p->seq);
+        bej_json_null(&d->dec);
+    }
+    free(by_seq);
+    d->used = pb;
+    return rc;
+}
+
+/* Header, then the root tuple's SFL; @p s is left at the root value. */
+static int read_root(bej_stream_t* s, uint64_t* seq_sel, uint8_t* fmt, uint64_t* len) {
+    uint8_t flags;
+    if (s->size < 7) return -1;
+    if (s->p[6] != 0x00 && s->p[6] != 0x01) return -2;
+    s->pos = 7;
+    if (bej_read_sfl(s, seq_sel, fmt, len, &flags) != 0) return -1;
+    return *len > s->size - s->pos ? -1 : 0;
+}
+
+int bej_decode_delta(bej_sink_t* out,
+    const uint8_t* prev, size_t prev_size,
+    const uint8_t* cur, size_t cur_size,
+    const bej_dictionary_t* dict_major) {
+    delta_t d = { .dict = dict_major, .buf = { prev, cur }, .size = { prev_size, cur_size } };
+    bej_decoder_init(&d.dec, dict_major, out);
+
+    bej_stream_t ps, cs;
+    bej_stream_init(&ps, prev, prev_size);
+    bej_stream_init(&cs, cur, cur_size);
+    uint64_t pseq, plen, cseq, clen;
+    uint8_t pfmt, cfmt;
+    int rc = read_root(&cs, &cseq, &cfmt, &clen);
+    if (rc == 0) rc = read_root(&ps, &pseq, &pfmt, &plen);
+    if (rc != 0) return rc;
+
+    if (pfmt != BEJ_FMT_SET || cfmt != BEJ_FMT_SET) {
+        rc = bej_json_tuple(&d.dec, &cs, cseq, cfmt, clen, NULL);
+    }
+    else {
+        delta_frame_t root = { NULL, NULL, 0, 0 };
+        if (plen != clen || memcmp(prev + ps.pos, cur + cs.pos, (size_t)clen)) {
+            dict_subset_t kids = dict_children(dict_major, -1);
+            size_t pos[2] = { ps.pos, cs.pos };
+            size_t end[2] = { ps.pos + (size_t)plen, cs.pos + (size_t)clen };
+            rc = diff_set(&d, &root, pos, end, 0, &kids);
+        }
+        if (rc == 0) {
+            open_frame(&d, &root);
+            bej_json_close(&d.dec, '}');
+        }
+    }
+    free(d.members);
+    if (rc == 0 && out->error) rc = -1;
+    return rc;
+}
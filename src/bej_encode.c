@@ -0,0 +1,612 @@
+#include "bej_encode.h"
+#include "dict.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ENC_MAX_DEPTH 256
+#define ENC_NONE UINT32_MAX
+
+/* BEJ 1.0 header: version 0xF1F0F000, no flags, major schema class. */
+static const uint8_t bej_header[7] = { 0x00, 0xF0, 0xF0, 0xF1, 0x00, 0x00, 0x00 };
+
+enum { J_NULL, J_FALSE, J_TRUE, J_NUM, J_STR, J_ARR, J_OBJ };
+
+/* One parsed JSON value. The sizing pass fills the BEJ half, the write pass
+ * then emits every tuple exactly once into a buffer of the final size. */
+typedef struct {
+    uint8_t  type;
+    uint8_t  fmt;
+    uint16_t seq;
+    uint32_t key, key_len;      /* member name, unescaped in place (objects only) */
+    uint32_t val, val_len;      /* string bytes or number text */
+    uint32_t first, next;      /* first child, next sibling */
+    uint32_t count;
+    uint32_t pos;               /* JSON offset, for errors */
+    uint64_t len;               /* value bytes following the SFL tuple */
+    uint64_t num;               /* integer (two's complement) or enum value */
+} enc_node_t;
+
+typedef struct {
+    uint32_t first;             /* child range the name belongs to */
+    uint32_t entry;             /* entry index + 1; 0 = empty slot */
+} name_slot_t;
+
+struct bej_encoder_s {
+    const bej_dictionary_t* dict;
+    name_slot_t* names;
+    uint32_t mask;
+
+    char*    text;
+    size_t   text_len;
+    size_t   pos;
+    enc_node_t* nodes;
+    uint32_t nnodes, cap;
+    size_t   err_off;
+};
+
+/* ---- name -> entry index ---- */
+
+static uint32_t name_hash(uint32_t first, const char* s, size_t n) {
+    uint32_t h = 2166136261u ^ (first * 2654435761u);
+    for (size_t i = 0; i < n; ++i) h = (h ^ (uint8_t)s[i]) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+static const bej_dict_entry_t* name_lookup(const bej_encoder_t* enc, const dict_subset_t* sub,
+    const char* s, size_t n) {
+    if (!enc->names || !sub->list || !sub->count) return NULL;
+    const bej_dictionary_t* d = enc->dict;
+    uint32_t first = (uint32_t)(sub->list - d->entries);
+    for (uint32_t h = name_hash(first, s, n) & enc->mask; enc->names[h].entry; h = (h + 1) & enc->mask) {
+        const name_slot_t* sl = &enc->names[h];
+        const bej_dict_entry_t* e = &d->entries[sl->entry - 1];
+        if (sl->first == first && e->name_len == n && memcmp(dict_entry_name(d, e), s, n) == 0) return e;
+    }
+    return NULL;
+}
+
+bej_encoder_t* bej_encoder_new(const bej_dictionary_t* dict_major) {
+    bej_encoder_t* enc = (bej_encoder_t*)calloc(1, sizeof(*enc));
+    if (!enc) return NULL;
+    enc->dict = dict_major;
+    const bej_dictionary_t* d = dict_major;
+
+    size_t total = 0;
+    for (uint32_t p = 0; p < d->entry_count; ++p) total += d->entries[p].child_count;
+    if (total == 0) return enc;
+    uint32_t size = 16;
+    while (size < total * 2) size <<= 1;
+    enc->names = (name_slot_t*)calloc(size, sizeof(name_slot_t));
+    if (!enc->names) { free(enc); return NULL; }
+    enc->mask = size - 1;
+
+    for (uint32_t p = 0; p < d->entry_count; ++p) {
+        if (!d->entries[p].child_count || d->entries[p].child_first_idx < 0) continue;
+        dict_subset_t sub = dict_children(d, (int)p);
+        uint32_t first = (uint32_t)(sub.list - d->entries);
+        for (uint16_t k = 0; k < sub.count; ++k) {
+            const bej_dict_entry_t* e = &sub.list[k];
+            const char* nm = dict_entry_name(d, e);
+            if (!nm || name_lookup(enc, &sub, nm, e->name_len)) continue;   /* shared range or duplicate */
+            uint32_t h = name_hash(first, nm, e->name_len) & enc->mask;
+            while (enc->names[h].entry) h = (h + 1) & enc->mask;
+            enc->names[h].first = first;
+            enc->names[h].entry = first + k + 1;
+        }
+    }
+    return enc;
+}
+
+void bej_encoder_free(bej_encoder_t* enc) {
+    if (!enc) return;
+    free(enc->names);
+    free(enc->nodes);
+    free(enc);
+}
+
+size_t bej_encoder_offset(const bej_encoder_t* enc) {
+    return enc->err_off;
+}
+
+/* ---- JSON parser: nodes in pre-order, strings unescaped in place ---- */
+
+static int fail_at(bej_encoder_t* enc, size_t pos, int rc) {
+    enc->err_off = pos;
+    return rc;
+}
+
+static uint32_t new_node(bej_encoder_t* enc, uint8_t type) {
+    if (enc->nnodes == enc->cap) {
+        uint32_t cap = enc->cap ? enc->cap * 2 : 64;
+        enc_node_t* nn = (enc_node_t*)realloc(enc->nodes, cap * sizeof(enc_node_t));
+        if (!nn) return ENC_NONE;
+        enc->nodes = nn;
+        enc->cap = cap;
+    }
+    enc_node_t* n = &enc->nodes[enc->nnodes];
+    memset(n, 0, sizeof(*n));
+    n->type = type;
+    n->first = n->next = ENC_NONE;
+    n->pos = (uint32_t)enc->pos;
+    return enc->nnodes++;
+}
+
+static void skip_ws(bej_encoder_t* enc) {
+    const char* t = enc->text;
+    while (t[enc->pos] == ' ' || t[enc->pos] == '\t' || t[enc->pos] == '\n' || t[enc->pos] == '\r') enc->pos++;
+}
+
+static int hex4(const char* p, uint32_t* out) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f') v |= (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v |= (uint32_t)(c - 'A' + 10);
+        else return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+/* Unescaping never grows a string, so it is written over its own source. */
+static int parse_string(bej_encoder_t* enc, uint32_t* off, uint32_t* len) {
+    char* t = enc->text;
+    size_t r = enc->pos + 1, w = r;
+    for (;;) {
+        if (r >= enc->text_len) return fail_at(enc, r, -1);
+        unsigned char c = (unsigned char)t[r];
+        if (c == '"') break;
+        if (c < 0x20) return fail_at(enc, r, -1);
+        if (c != '\\') { t[w++] = t[r++]; continue; }
+        char e = t[r + 1];
+        r += 2;
+        switch (e) {
+        case '"': t[w++] = '"'; break;
+        case '\\': t[w++] = '\\'; break;
+        case '/': t[w++] = '/'; break;
+        case 'b': t[w++] = '\b'; break;
+        case 'f': t[w++] = '\f'; break;
+        case 'n': t[w++] = '\n'; break;
+        case 'r': t[w++] = '\r'; break;
+        case 't': t[w++] = '\t'; break;
+        case 'u': {
+            uint32_t cp, lo;
+            if (r + 4 > enc->text_len || hex4(t + r, &cp) != 0) return fail_at(enc, r, -1);
+            r += 4;
+            if (cp >= 0xD800 && cp < 0xDC00) {
+                if (r + 6 > enc->text_len || t[r] != '\\' || t[r + 1] != 'u' || hex4(t + r + 2, &lo) != 0
+                    || lo < 0xDC00 || lo >= 0xE000) return fail_at(enc, r, -1);
+                r += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            }
+            else if (cp >= 0xDC00 && cp < 0xE000) return fail_at(enc, r, -1);
+            if (cp < 0x80) t[w++] = (char)cp;
+            else if (cp < 0x800) {
+                t[w++] = (char)(0xC0 | (cp >> 6));
+                t[w++] = (char)(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000) {
+                t[w++] = (char)(0xE0 | (cp >> 12));
+                t[w++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                t[w++] = (char)(0x80 | (cp & 0x3F));
+            }
+            else {
+                t[w++] = (char)(0xF0 | (cp >> 18));
+                t[w++] = (char)(0x80 | ((cp >> 12) & 0x3F));
+                t[w++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                t[w++] = (char)(0x80 | (cp & 0x3F));
+            }
+            break;
+        }
+        default:
+            return fail_at(enc, r - 2, -1);
+        }
+    }
+    *off = (uint32_t)(enc->pos + 1);
+    *len = (uint32_t)(w - enc->pos - 1);
+    enc->pos = r + 1;
+    return 0;
+}
+
+static int is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static int parse_number(bej_encoder_t* enc, uint32_t* off, uint32_t* len) {
+    const char* t = enc->text;
+    size_t p = enc->pos;
+    if (t[p] == '-') p++;
+    if (t[p] == '0') p++;
+    else if (is_digit(t[p])) while (is_digit(t[p])) p++;
+    else return fail_at(enc, p, -1);
+    if (t[p] == '.') {
+        if (!is_digit(t[++p])) return fail_at(enc, p, -1);
+        while (is_digit(t[p])) p++;
+    }
+    if (t[p] == 'e' || t[p] == 'E') {
+        p++;
+        if (t[p] == '+' || t[p] == '-') p++;
+        if (!is_digit(t[p])) return fail_at(enc, p, -1);
+        while (is_digit(t[p])) p++;
+    }
+    *off = (uint32_t)enc->pos;
+    *len = (uint32_t)(p - enc->pos);
+    enc->pos = p;
+    return 0;
+}
+
+static int parse_literal(bej_encoder_t* enc, const char* lit, size_t n) {
+    if (enc->text_len - enc->pos < n || memcmp(enc->text + enc->pos, lit, n) != 0) return fail_at(enc, enc->pos, -1);
+    enc->pos += n;
+    return 0;
+}
+
+static int parse_value(bej_encoder_t* enc, int depth, uint32_t* out);
+
+/* Objects and arrays: members are linked in source order. */
+static int parse_container(bej_encoder_t* enc, int depth, uint32_t self, int is_obj) {
+    char close = is_obj ? '}' : ']';
+    uint32_t last = ENC_NONE;
+    enc->pos++;
+    skip_ws(enc);
+    if (enc->text[enc->pos] == close) { enc->pos++; return 0; }
+    for (;;) {
+        uint32_t key = 0, key_len = 0, child;
+        skip_ws(enc);
+        if (is_obj) {
+            if (enc->text[enc->pos] != '"') return fail_at(enc, enc->pos, -1);
+            if (parse_string(enc, &key, &key_len) != 0) return -1;
+            skip_ws(enc);
+            if (enc->text[enc->pos] != ':') return fail_at(enc, enc->pos, -1);
+            enc->pos++;
+        }
+        if (parse_value(enc, depth + 1, &child) != 0) return -1;
+        enc->nodes[child].key = key;
+        enc->nodes[child].key_len = key_len;
+        if (last == ENC_NONE) enc->nodes[self].first = child;
+        else enc->nodes[last].next = child;
+        last = child;
+        enc->nodes[self].count++;
+        skip_ws(enc);
+        char c = enc->text[enc->pos++];
+        if (c == close) return 0;
+        if (c != ',') return fail_at(enc, enc->pos - 1, -1);
+    }
+}
+
+static int parse_value(bej_encoder_t* enc, int depth, uint32_t* out) {
+    if (depth > ENC_MAX_DEPTH) return fail_at(enc, enc->pos, -1);
+    skip_ws(enc);
+    uint32_t n;
+    switch (enc->text[enc->pos]) {
+    case '{':
+    case '[': {
+        int is_obj = enc->text[enc->pos] == '{';
+        if ((n = new_node(enc, is_obj ? J_OBJ : J_ARR)) == ENC_NONE) return -1;
+        if (parse_container(enc, depth, n, is_obj) != 0) return -1;
+        break;
+    }
+    case '"': {
+        uint32_t off, len;
+        if ((n = new_node(enc, J_STR)) == ENC_NONE) return -1;
+        if (parse_string(enc, &off, &len) != 0) return -1;
+        enc->nodes[n].val = off;
+        enc->nodes[n].val_len = len;
+        break;
+    }
+    case 't':
+        if ((n = new_node(enc, J_TRUE)) == ENC_NONE || parse_literal(enc, "true", 4) != 0) return -1;
+        break;
+    case 'f':
+        if ((n = new_node(enc, J_FALSE)) == ENC_NONE || parse_literal(enc, "false", 5) != 0) return -1;
+        break;
+    case 'n':
+        if ((n = new_node(enc, J_NULL)) == ENC_NONE || parse_literal(enc, "null", 4) != 0) return -1;
+        break;
+    default: {
+        uint32_t off, len;
+        if ((n = new_node(enc, J_NUM)) == ENC_NONE) return -1;
+        if (parse_number(enc, &off, &len) != 0) return -1;
+        enc->nodes[n].val = off;
+        enc->nodes[n].val_len = len;
+    }
+    }
+    *out = n;
+    return 0;
+}
+
+/* ---- BEJ primitives ---- */
+
+static size_t nnint_size(uint64_t v) {
+    size_t n = 1;
+    while (n < 8 && (v >> (n * 8))) n++;
+    return n + 1;
+}
+
+static uint8_t* put_nnint(uint8_t* w, uint64_t v) {
+    size_t n = nnint_size(v) - 1;
+    *w++ = (uint8_t)n;
+    for (size_t i = 0; i < n; ++i) *w++ = (uint8_t)(v >> (i * 8));
+    return w;
+}
+
+/* Shortest two's complement width that sign-extends back to v. */
+static size_t int_size(int64_t v) {
+    size_t n = 1;
+    while (n < 8) {
+        int64_t lo = -((int64_t)1 << (n * 8 - 1)), hi = ((int64_t)1 << (n * 8 - 1)) - 1;
+        if (v >= lo && v <= hi) break;
+        n++;
+    }
+    return n;
+}
+
+static uint8_t* put_int(uint8_t* w, int64_t v, size_t n) {
+    uint64_t u = (uint64_t)v;
+    for (size_t i = 0; i < n; ++i) *w++ = (uint8_t)(u >> (i * 8));
+    return w;
+}
+
+static int parse_int(const char* t, size_t n, int64_t* out) {
+    size_t i = 0;
+    int neg = t[0] == '-';
+    if (neg) i++;
+    uint64_t v = 0, limit = neg ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    for (; i < n; ++i) {
+        if (!is_digit(t[i])) return -1;   /* fraction or exponent */
+        uint64_t d = (uint64_t)(t[i] - '0');
+        if (v > (limit - d) / 10) return -1;
+        v = v * 10 + d;
+    }
+    *out = neg ? (int64_t)(0 - v) : (int64_t)v;
+    return 0;
+}
+
+/* BEJ real: whole '.' <lz zeros> fract [e exp], the shape the decoder prints. */
+typedef struct {
+    int64_t  whole;
+    uint64_t lz, fract;
+    int64_t  exp;
+} enc_real_t;
+
+static int parse_real(const char* t, size_t n, enc_real_t* r) {
+    size_t i = 0;
+    memset(r, 0, sizeof(*r));
+    while (i < n && t[i] != '.' && t[i] != 'e' && t[i] != 'E') i++;
+    if (parse_int(t, i, &r->whole) != 0) return -1;
+    if (i < n && t[i] == '.') {
+        size_t start = ++i;
+        while (i < n && t[i] == '0') i++;
+        if (i < n && is_digit(t[i])) {
+            r->lz = i - start;
+            for (size_t k = 0; i < n && is_digit(t[i]); ++i, ++k) {
+                if (k == 19) return -1;
+                r->fract = r->fract * 10 + (uint64_t)(t[i] - '0');
+            }
+        }
+        else r->lz = i - start - 1;     /* all zeros: the last one is the fraction */
+    }
+    if (i < n) {
+        size_t s = ++i;
+        if (t[s] == '+') s++;
+        if (parse_int(t + s, n - s, &r->exp) != 0) return -1;
+    }
+    /* -0.x: a zero whole has no sign, so the fraction digits move into the
+     * whole and the exponent makes up for them (-0.05 is -5.0e-2). */
+    if (t[0] == '-' && r->whole == 0 && r->fract) {
+        uint64_t shift = r->lz;
+        for (uint64_t f = r->fract; f; f /= 10) shift++;
+        if (r->fract > (uint64_t)INT64_MAX || shift > (uint64_t)INT64_MAX
+            || r->exp < INT64_MIN + (int64_t)shift) return -1;
+        r->whole = -(int64_t)r->fract;
+        r->exp -= (int64_t)shift;
+        r->lz = r->fract = 0;
+    }
+    return 0;
+}
+
+static size_t real_size(const enc_real_t* r) {
+    size_t lw = int_size(r->whole), le = r->exp ? int_size(r->exp) : 0;
+    return nnint_size(lw) + lw + nnint_size(r->lz) + nnint_size(r->fract) + nnint_size(le) + le;
+}
+
+static uint8_t* put_real(uint8_t* w, const enc_real_t* r) {
+    size_t lw = int_size(r->whole), le = r->exp ? int_size(r->exp) : 0;
+    w = put_nnint(w, lw);
+    w = put_int(w, r->whole, lw);
+    w = put_nnint(w, r->lz);
+    w = put_nnint(w, r->fract);
+    w = put_nnint(w, le);
+    return put_int(w, r->exp, le);
+}
+
+static uint64_t tuple_size(const enc_node_t* n) {
+    return nnint_size((uint64_t)n->seq << 1) + 1 + nnint_size(n->len) + n->len;
+}
+
+/* ---- sizing pass ---- */
+
+/* "_<seq>": the decoder's name for properties without a dictionary name. */
+static int seq_key(const char* k, size_t n, uint16_t* seq) {
+    if (n < 2 || n > 6 || k[0] != '_') return -1;
+    uint32_t v = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (!is_digit(k[i])) return -1;
+        v = v * 10 + (uint32_t)(k[i] - '0');
+    }
+    if (v > 0xFFFF) return -1;
+    *seq = (uint16_t)v;
+    return 0;
+}
+
+/* Resolves formats and value lengths bottom-up. @p def is the dictionary
+ * entry describing the value, or NULL when the schema does not cover it. */
+static int size_value(bej_encoder_t* enc, uint32_t ni, const bej_dict_entry_t* def) {
+    const bej_dictionary_t* d = enc->dict;
+    enc_node_t* n = &enc->nodes[ni];
+    dict_subset_t sub = (dict_subset_t){ 0 };
+    if (def && def->child_count) sub = dict_children(d, (int)(def - d->entries));
+
+    switch (n->type) {
+    case J_OBJ:
+    case J_ARR: {
+        int is_obj = n->type == J_OBJ;
+        uint8_t fmt = is_obj ? BEJ_FMT_SET : BEJ_FMT_ARRAY;
+        if (def && def->format != fmt) return fail_at(enc, n->pos, -2);
+        uint64_t total = nnint_size(n->count);
+        uint32_t idx = 0;
+        for (uint32_t c = n->first; c != ENC_NONE; c = enc->nodes[c].next, ++idx) {
+            enc_node_t* ch = &enc->nodes[c];
+            const bej_dict_entry_t* cdef = NULL;
+            if (is_obj) {
+                const char* key = enc->text + ch->key;
+                cdef = name_lookup(enc, &sub, key, ch->key_len);
+                if (cdef) ch->seq = cdef->seq;
+                else if (seq_key(key, ch->key_len, &ch->seq) == 0) {
+                    cdef = dict_child_by_seq(&sub, ch->seq);
+                    if (cdef && cdef->name_len) cdef = NULL;
+                }
+                else return fail_at(enc, ch->key - 1, -2);
+            }
+            else {
+                /* Array elements carry their index as seq; the entry's one child describes them all. */
+                if (idx > 0xFFFF) return fail_at(enc, ch->pos, -2);
+                ch->seq = (uint16_t)idx;
+                cdef = sub.count ? &sub.list[0] : NULL;
+            }
+            int rc = size_value(enc, c, cdef);
+            if (rc != 0) return rc;
+            total += tuple_size(&enc->nodes[c]);
+        }
+        n = &enc->nodes[ni];
+        n->fmt = fmt;
+        n->len = total;
+        return 0;
+    }
+    case J_STR:
+        if (def && def->format == BEJ_FMT_ENUM) {
+            const bej_dict_entry_t* v = name_lookup(enc, &sub, enc->text + n->val, n->val_len);
+            if (!v) return fail_at(enc, n->pos, -2);
+            n->fmt = BEJ_FMT_ENUM;
+            n->num = v->seq;
+            n->len = nnint_size(n->num);
+            return 0;
+        }
+        if (def && def->format != BEJ_FMT_STRING) return fail_at(enc, n->pos, -2);
+        n->fmt = BEJ_FMT_STRING;
+        n->len = (uint64_t)n->val_len + 1;
+        return 0;
+    case J_NUM: {
+        const char* t = enc->text + n->val;
+        int64_t v;
+        int integral = parse_int(t, n->val_len, &v) == 0;
+        if (def ? def->format == BEJ_FMT_INTEGER : integral) {
+            if (!integral) return fail_at(enc, n->pos, -2);
+            n->fmt = BEJ_FMT_INTEGER;
+            n->num = (uint64_t)v;
+            n->len = int_size(v);
+            return 0;
+        }
+        enc_real_t r;
+        if ((def && def->format != BEJ_FMT_REAL) || parse_real(t, n->val_len, &r) != 0) return fail_at(enc, n->pos, -2);
+        n->fmt = BEJ_FMT_REAL;
+        n->len = real_size(&r);
+        return 0;
+    }
+    case J_TRUE:
+    case J_FALSE:
+        if (def && def->format != BEJ_FMT_BOOLEAN) return fail_at(enc, n->pos, -2);
+        n->fmt = BEJ_FMT_BOOLEAN;
+        n->len = 1;
+        return 0;
+    default:
+        n->fmt = BEJ_FMT_NULL;
+        n->len = 0;
+        return 0;
+    }
+}
+
+/* ---- write pass ---- */
+
+static uint8_t* write_tuple(const bej_encoder_t* enc, uint32_t ni, uint8_t* w) {
+    const enc_node_t* n = &enc->nodes[ni];
+    w = put_nnint(w, (uint64_t)n->seq << 1);
+    *w++ = (uint8_t)(n->fmt << 4);
+    w = put_nnint(w, n->len);
+    switch (n->fmt) {
+    case BEJ_FMT_SET:
+    case BEJ_FMT_ARRAY:
+        w = put_nnint(w, n->count);
+        for (uint32_t c = n->first; c != ENC_NONE; c = enc->nodes[c].next) w = write_tuple(enc, c, w);
+        break;
+    case BEJ_FMT_STRING:
+        memcpy(w, enc->text + n->val, n->val_len);
+        w += n->val_len;
+        *w++ = 0;
+        break;
+    case BEJ_FMT_ENUM:
+        w = put_nnint(w, n->num);
+        break;
+    case BEJ_FMT_INTEGER:
+        w = put_int(w, (int64_t)n->num, (size_t)n->len);
+        break;
+    case BEJ_FMT_BOOLEAN:
+        *w++ = n->type == J_TRUE;
+        break;
+    case BEJ_FMT_REAL: {
+        enc_real_t r;
+        parse_real(enc->text + n->val, n->val_len, &r);
+        w = put_real(w, &r);
+        break;
+    }
+    default:
+        break;
+    }
+    return w;
+}
+
+int bej_encode(bej_encoder_t* enc, const char* json, size_t json_len,
+    uint8_t** out_bej, size_t* out_len) {
+    *out_bej = NULL;
+    if (out_len) *out_len = 0;
+    enc->err_off = 0;
+    if (json_len >= UINT32_MAX) return -1;
+
+    enc->text = (char*)malloc(json_len + 1);
+    if (!enc->text) return -1;
+    memcpy(enc->text, json, json_len);
+    enc->text[json_len] = '\0';
+    enc->text_len = json_len;
+    enc->pos = 0;
+    enc->nnodes = 0;
+
+    uint32_t root;
+    int rc = parse_value(enc, 0, &root);
+    if (rc == 0) {
+        skip_ws(enc);
+        if (enc->pos != json_len) rc = fail_at(enc, enc->pos, -1);
+        else if (enc->nodes[root].type != J_OBJ) rc = fail_at(enc, 0, -2);
+    }
+    if (rc == 0) {
+        /* The root set is the schema's top entry (seq 0). */
+        const bej_dictionary_t* d = enc->dict;
+        rc = size_value(enc, root, d->entry_count ? &d->entries[0] : NULL);
+    }
+    if (rc == 0) {
+        size_t total = sizeof(bej_header) + (size_t)tuple_size(&enc->nodes[root]);
+        uint8_t* buf = (uint8_t*)malloc(total);
+        if (!buf) rc = -1;
+        else {
+            memcpy(buf, bej_header, sizeof(bej_header));
+            uint8_t* end = write_tuple(enc, root, buf + sizeof(bej_header));
+            if ((size_t)(end - buf) != total) { free(buf); rc = -1; }
+            else {
+                *out_bej = buf;
+                if (out_len) *out_len = total;
+            }
+        }
+    }
+    free(enc->text);
+    enc->text = NULL;
+    return rc;
+}
@@ -0,0 +1,391 @@
+#include "bej_index.h"
+#include "bej_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_MAX_DEPTH 256
+#define INDEX_MAX_PAYLOAD 0x7FFFFFFFu
+#define INDEX_CONTAINER 0x80000000u     /* child entry names a container, not a tuple offset */
+#define INDEX_MIN_TUPLE 5               /* seq nnint (2) + format (1) + length nnint (2) */
+#define INDEX_VERSION 1
+
+static const uint8_t index_magic[4] = { 'B', 'E', 'J', 'X' };
+
+typedef struct {
+    uint32_t off;       /* payload offset of the container's SFL tuple */
+    uint32_t first;     /* its first entry in kids */
+    uint32_t count;
+} index_container_t;
+
+struct bej_index_s {
+    index_container_t* cont;
+    uint32_t ncont, cap_cont;
+    uint32_t* kids;
+    uint32_t nkids, cap_kids;
+    uint32_t root;
+    uint64_t bej_size;
+    const uint8_t* bej;     /* only while building */
+    uint64_t* scratch;      /* set member sort keys, while building */
+    uint32_t cap_scratch;
+};
+
+static int grow(void** p, uint32_t* cap, uint64_t need, size_t elem) {
+    if (need <= *cap) return 0;
+    if (need > UINT32_MAX) return -1;
+    uint64_t c = *cap ? *cap : 16;
+    while (c < need) c *= 2;
+    if (c > UINT32_MAX) c = UINT32_MAX;
+    void* q = realloc(*p, (size_t)c * elem);
+    if (!q) return -1;
+    *p = q;
+    *cap = (uint32_t)c;
+    return 0;
+}
+
+static uint32_t entry_off(const bej_index_t* idx, uint32_t e) {
+    return e & INDEX_CONTAINER ? idx->cont[e & ~INDEX_CONTAINER].off : e;
+}
+
+/* Seq of the tuple at @p off; the offsets come from the index, so they are in range. */
+static uint16_t seq_at(const uint8_t* bej, size_t size, uint32_t off) {
+    bej_stream_t s = { bej, size, off };
+    uint64_t seq_sel = 0;
+    bej_read_nnint(&s, &seq_sel);
+    return (uint16_t)((seq_sel >> 1) & 0xFFFF);
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Orders a set's entries by seq so lookups can bisect them. */
+static int sort_members(bej_index_t* idx, uint32_t first, uint32_t n) {
+    uint32_t* k = idx->kids + first;
+    uint16_t prev = 0;
+    uint32_t i;
+    for (i = 0; i < n; ++i) {
+        uint16_t seq = seq_at(idx->bej, (size_t)idx->bej_size, entry_off(idx, k[i]));
+        if (i && seq < prev) break;
+        prev = seq;
+    }
+    if (i == n) return 0;   /* usually already in order */
+
+    if (grow((void**)&idx->scratch, &idx->cap_scratch, n, sizeof(uint64_t)) != 0) return -1;
+    for (i = 0; i < n; ++i)
+        idx->scratch[i] = (uint64_t)seq_at(idx->bej, (size_t)idx->bej_size, entry_off(idx, k[i])) << 32 | k[i];
+    qsort(idx->scratch, n, sizeof(uint64_t), cmp_u64);
+    for (i = 0; i < n; ++i) k[i] = (uint32_t)idx->scratch[i];
+    return 0;
+}
+
+/* Indexes the value of the tuple at @p tuple_off; @p s is bounded to the value. */
+static int build_value(bej_index_t* idx, bej_stream_t* s, uint32_t tuple_off,
+    uint8_t fmt, int depth, uint32_t* ref) {
+    if (fmt != BEJ_FMT_SET && fmt != BEJ_FMT_ARRAY) { *ref = tuple_off; return 0; }
+    if (depth >= INDEX_MAX_DEPTH) return -2;
+
+    uint64_t count;
+    if (bej_read_nnint(s, &count) != 0 || count > (s->size - s->pos) / INDEX_MIN_TUPLE) return -1;
+    uint32_t c = idx->ncont;
+    if (c >= INDEX_CONTAINER || grow((void**)&idx->cont, &idx->cap_cont, (uint64_t)c + 1, sizeof(*idx->cont)) != 0)
+        return -1;
+    idx->ncont++;
+    /* The children's entries sit together; nested containers append theirs after. */
+    uint32_t first = idx->nkids;
+    if (grow((void**)&idx->kids, &idx->cap_kids, (uint64_t)first + count, sizeof(*idx->kids)) != 0) return -1;
+    memset(idx->kids + first, 0, (size_t)count * sizeof(*idx->kids));
+    idx->nkids += (uint32_t)count;
+
+    uint32_t n = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        size_t cstart = s->pos;
+        uint64_t cseq_sel, clen; uint8_t cfmt, cfl;
+        if (bej_read_sfl(s, &cseq_sel, &cfmt, &clen, &cfl) != 0 || clen > s->size - s->pos) return -1;
+        bej_stream_t inner = { s->p, s->pos + (size_t)clen, s->pos };
+        s->pos = inner.size;
+        if (fmt == BEJ_FMT_SET && (cseq_sel & 0x1) != BEJ_SEL_MAJOR) continue;   /* annotations are not rendered */
+
+        uint32_t r;
+        int rc = build_value(idx, &inner, (uint32_t)cstart, cfmt, depth + 1, &r);
+        if (rc != 0) return rc;
+        idx->kids[first + n++] = r;
+    }
+    if (s->pos != s->size) return -1;
+
+    idx->cont[c].off = tuple_off;
+    idx->cont[c].first = first;
+    idx->cont[c].count = n;
+    if (fmt == BEJ_FMT_SET && sort_members(idx, first, n) != 0) return -1;
+    *ref = c | INDEX_CONTAINER;
+    return 0;
+}
+
+int bej_index_build(const uint8_t* bej, size_t bej_size, bej_index_t** out) {
+    *out = NULL;
+    if (bej_size < 7) return -1;
+    if (!(bej[6] == 0x00 || bej[6] == 0x01) || bej_size > INDEX_MAX_PAYLOAD) return -2;
+
+    bej_index_t* idx = (bej_index_t*)calloc(1, sizeof(*idx));
+    if (!idx) return -1;
+    idx->bej = bej;
+    idx->bej_size = bej_size;
+
+    bej_stream_t s;
+    bej_stream_init(&s, bej, bej_size);
+    s.pos = 7;
+    uint64_t seq_sel, len; uint8_t fmt, flags;
+    int rc = -1;
+    if (bej_read_sfl(&s, &seq_sel, &fmt, &len, &flags) == 0 && len <= s.size - s.pos) {
+        bej_stream_t inner = { s.p, s.pos + (size_t)len, s.pos };
+        rc = build_value(idx, &inner, 7, fmt, 0, &idx->root);
+    }
+    free(idx->scratch);
+    idx->scratch = NULL;
+    idx->bej = NULL;
+    if (rc != 0) { bej_index_free(idx); return rc; }
+    *out = idx;
+    return 0;
+}
+
+void bej_index_free(bej_index_t* idx) {
+    if (!idx) return;
+    free(idx->cont);
+    free(idx->kids);
+    free(idx->scratch);
+    free(idx);
+}
+
+void bej_index_counts(const bej_index_t* idx, size_t* containers, size_t* children) {
+    if (containers) *containers = idx->ncont;
+    if (children) *children = idx->nkids;
+}
+
+/* ---- serialization: magic, version, 3 reserved, payload size (u64), root,
+ *      container count, entry count, containers (off, first, count), entries ---- */
+
+#define INDEX_HEADER_SIZE 28
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int bej_index_save(const bej_index_t* idx, uint8_t** out, size_t* out_len) {
+    size_t len = INDEX_HEADER_SIZE + (size_t)idx->ncont * 12 + (size_t)idx->nkids * 4;
+    uint8_t* b = (uint8_t*)malloc(len);
+    if (!b) return -1;
+    memcpy(b, index_magic, 4);
+    b[4] = INDEX_VERSION;
+    b[5] = b[6] = b[7] = 0;
+    put_u32(b + 8, (uint32_t)idx->bej_size);
+    put_u32(b + 12, (uint32_t)(idx->bej_size >> 32));
+    put_u32(b + 16, idx->root);
+    put_u32(b + 20, idx->ncont);
+    put_u32(b + 24, idx->nkids);
+    uint8_t* p = b + INDEX_HEADER_SIZE;
+    for (uint32_t i = 0; i < idx->ncont; ++i, p += 12) {
+        put_u32(p, idx->cont[i].off);
+        put_u32(p + 4, idx->cont[i].first);
+        put_u32(p + 8, idx->cont[i].count);
+    }
+    for (uint32_t i = 0; i < idx->nkids; ++i, p += 4) put_u32(p, idx->kids[i]);
+    *out = b;
+    *out_len = len;
+    return 0;
+}
+
+/* Every entry in range, and child containers numbered after their parent
+ * (pre-order), so walking a loaded index always terminates. */
+static int index_check(const bej_index_t* idx) {
+    if (idx->root & INDEX_CONTAINER ? (idx->root & ~INDEX_CONTAINER) >= idx->ncont : idx->root >= idx->bej_size)
+        return -1;
+    for (uint32_t i = 0; i < idx->ncont; ++i) {
+        const index_container_t* c = &idx->cont[i];
+        if (c->off >= idx->bej_size || c->first > idx->nkids || c->count > idx->nkids - c->first) return -1;
+        for (uint32_t k = 0; k < c->count; ++k) {
+            uint32_t e = idx->kids[c->first + k];
+            if (e & INDEX_CONTAINER) {
+                e &= ~INDEX_CONTAINER;
+                if (e <= i || e >= idx->ncont) return -1;
+            }
+            else if (e >= idx->bej_size) return -1;
+        }
+    }
+    return 0;
+}
+
+int bej_index_load(const uint8_t* data, size_t size, size_t bej_size, bej_index_t** out) {
+    *out = NULL;
+    if (size < INDEX_HEADER_SIZE || memcmp(data, index_magic, 4) != 0 || data[4] != INDEX_VERSION) return -1;
+    uint64_t saved_size = (uint64_t)get_u32(data + 12) << 32 | get_u32(data + 8);
+    uint32_t ncont = get_u32(data + 20), nkids = get_u32(data + 24);
+    if (saved_size != bej_size || (uint64_t)ncont * 12 + (uint64_t)nkids * 4 != size - INDEX_HEADER_SIZE) return -1;
+
+    bej_index_t* idx = (bej_index_t*)calloc(1, sizeof(*idx));
+    if (!idx) return -1;
+    idx->bej_size = saved_size;
+    idx->root = get_u32(data + 16);
+    if (grow((void**)&idx->cont, &idx->cap_cont, ncont ? ncont : 1, sizeof(*idx->cont)) != 0
+        || grow((void**)&idx->kids, &idx->cap_kids, nkids ? nkids : 1, sizeof(*idx->kids)) != 0) {
+        bej_index_free(idx);
+        return -1;
+    }
+    idx->ncont = ncont;
+    idx->nkids = nkids;
+    const uint8_t* p = data + INDEX_HEADER_SIZE;
+    for (uint32_t i = 0; i < ncont; ++i, p += 12) {
+        idx->cont[i].off = get_u32(p);
+        idx->cont[i].first = get_u32(p + 4);
+        idx->cont[i].count = get_u32(p + 8);
+    }
+    for (uint32_t i = 0; i < nkids; ++i, p += 4) idx->kids[i] = get_u32(p);
+    if (index_check(idx) != 0) { bej_index_free(idx); return -1; }
+    *out = idx;
+    return 0;
+}
+
+/* ---- lazy DOM ---- */
+
+int bej_dom_init(bej_dom_t* dom, const bej_index_t* idx,
+    const uint8_t* bej, size_t bej_size, const bej_dictionary_t* dict_major) {
+    if (idx->bej_size != bej_size) return -1;
+    dom->idx = idx;
+    dom->bej = bej;
+    dom->bej_size = bej_size;
+    dom->dict = dict_major;
+    return 0;
+}
+
+void bej_dom_root(const bej_dom_t* dom, bej_dom_node_t* out) {
+    memset(out, 0, sizeof(*out));
+    out->ref = dom->idx->root;
+}
+
+static int dom_tuple(const bej_dom_t* dom, uint32_t ref, uint16_t* seq, uint8_t* fmt) {
+    bej_stream_t s = { dom->bej, dom->bej_size, entry_off(dom->idx, ref) };
+    uint64_t seq_sel, len; uint8_t flags;
+    if (bej_read_sfl(&s, &seq_sel, fmt, &len, &flags) != 0) return -1;
+    *seq = (uint16_t)((seq_sel >> 1) & 0xFFFF);
+    return 0;
+}
+
+uint8_t bej_dom_format(const bej_dom_t* dom, const bej_dom_node_t* node) {
+    uint16_t seq; uint8_t fmt = BEJ_FMT_NULL;
+    dom_tuple(dom, node->ref, &seq, &fmt);
+    return fmt;
+}
+
+size_t bej_dom_count(const bej_dom_t* dom, const bej_dom_node_t* node) {
+    return node->ref & INDEX_CONTAINER ? dom->idx->cont[node->ref & ~INDEX_CONTAINER].count : 0;
+}
+
+/* The dictionary children the decoder renders this container's members
+ * with: the same choices decode_tuple_value makes. */
+static int dom_schema(const bej_dom_t* dom, const bej_dom_node_t* node, uint16_t seq, uint8_t fmt,
+    dict_subset_t* kids) {
+    const bej_dictionary_t* d = dom->dict;
+    if (fmt == BEJ_FMT_SET && !node->has_ctx) { *kids = dict_children(d, -1); return 1; }
+    const bej_dict_entry_t* def = node->has_ctx ? dict_child_by_seq(&node->ctx, seq) : NULL;
+    if (!def) return 0;
+    *kids = dict_children(d, (int)(def - d->entries));
+    return 1;
+}
+
+static void dom_member(const bej_dom_t* dom, uint32_t ref, int have, const dict_subset_t* kids,
+    bej_dom_node_t* out) {
+    memset(out, 0, sizeof(*out));
+    out->ref = ref;
+    if (!have) return;
+    uint16_t seq; uint8_t fmt;
+    if (dom_tuple(dom, ref, &seq, &fmt) != 0) return;
+    const bej_dict_entry_t* def = dict_child_by_seq(kids, seq);
+    if (def && def->name_len) { out->has_ctx = 1; out->ctx = *kids; }
+}
+
+int bej_dom_child(const bej_dom_t* dom, const bej_dom_node_t* node, size_t i, bej_dom_node_t* out) {
+    if (i >= bej_dom_count(dom, node)) return BEJ_DOM_ABSENT;
+    const index_container_t* c = &dom->idx->cont[node->ref & ~INDEX_CONTAINER];
+    uint32_t ref = dom->idx->kids[c->first + i];
+    uint16_t seq; uint8_t fmt;
+    if (dom_tuple(dom, node->ref, &seq, &fmt) != 0) return -1;
+    dict_subset_t kids = (dict_subset_t){ 0 };
+    int have = dom_schema(dom, node, seq, fmt, &kids);
+    if (fmt == BEJ_FMT_SET) dom_member(dom, ref, have, &kids, out);
+    else {
+        memset(out, 0, sizeof(*out));
+        out->ref = ref;
+        out->has_ctx = have;
+        out->ctx = kids;
+    }
+    return 0;
+}
+
+/* One pointer step from a container. */
+static int dom_step(const bej_dom_t* dom, bej_dom_node_t* node, const char* seg, size_t n) {
+    if (!(node->ref & INDEX_CONTAINER)) return -2;      /* nothing below a leaf */
+    const bej_index_t* idx = dom->idx;
+    const index_container_t* c = &idx->cont[node->ref & ~INDEX_CONTAINER];
+    uint16_t seq; uint8_t fmt;
+    if (dom_tuple(dom, node->ref, &seq, &fmt) != 0) return -1;
+    dict_subset_t kids = (dict_subset_t){ 0 };
+    int have = dom_schema(dom, node, seq, fmt, &kids);
+    uint32_t key;
+
+    if (fmt == BEJ_FMT_ARRAY) {
+        if (bej_parse_index(seg, n, UINT32_MAX, &key) != 0) return -2;
+        if (key >= c->count) return BEJ_DOM_ABSENT;
+        node->ref = idx->kids[c->first + key];
+        node->has_ctx = have;
+        node->ctx = kids;
+        return 0;
+    }
+    int by_seq = n > 1 && seg[0] == '_' && bej_parse_index(seg + 1, n - 1, 0xFFFF, &key) == 0;
+    if (!by_seq) {
+        uint16_t i = 0;
+        for (; have && i < kids.count; ++i) {
+            const bej_dict_entry_t* e = &kids.list[i];
+            if (e->name_len == n && !memcmp(dict_entry_name(dom->dict, e), seg, n)) break;
+        }
+        if (!have || i == kids.count) return -2;
+        key = kids.list[i].seq;
+    }
+    /* Members are sorted by seq. */
+    uint32_t lo = 0, hi = c->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (seq_at(dom->bej, dom->bej_size, entry_off(idx, idx->kids[c->first + mid])) < key) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == c->count) return BEJ_DOM_ABSENT;
+    uint32_t ref = idx->kids[c->first + lo];
+    if (seq_at(dom->bej, dom->bej_size, entry_off(idx, ref)) != key) return BEJ_DOM_ABSENT;
+    dom_member(dom, ref, have, &kids, node);
+    return 0;
+}
+
+int bej_dom_lookup(const bej_dom_t* dom, const char* pointer, bej_dom_node_t* out) {
+    bej_dom_node_t node;
+    bej_dom_root(dom, &node);
+    while (*pointer) {
+        char seg[BEJ_POINTER_MAX_SEGMENT];
+        size_t n = 0;
+        if (bej_pointer_segment(&pointer, seg, sizeof(seg), &n) != 0) return -2;
+        int rc = dom_step(dom, &node, seg, n);
+        if (rc != 0) return rc;
+    }
+    *out = node;
+    return 0;
+}
+
+int bej_dom_render(const bej_dom_t* dom, const bej_dom_node_t* node, bej_sink_t* out) {
+    bej_decoder_t dec;
+    bej_decoder_init(&dec, dom->dict, out);
+    bej_stream_t s = { dom->bej, dom->bej_size, entry_off(dom->idx, node->ref) };
+    int rc = bej_json_value(&dec, &s, node->has_ctx ? &node->ctx : NULL);
+    if (rc == 0 && out->error) rc = -1;
+    return rc;
+}
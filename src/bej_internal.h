@@ -0,0 +1,74 @@
+#ifndef BEJ_INTERNAL_H
+#define BEJ_INTERNAL_H
+
+/* Pieces of the JSON writer in bej_decode.c shared with the other decoder
+ * front ends. Not installed; not part of the public API. */
+
+#include "bej.h"
+#include "dict.h"
+#include "sink.h"
+
+/** Newline plus indentation for dec->pp_level. */
+void bej_pp_nl(bej_decoder_t* dec);
+
+/** Writes "name": (quoted, escaped, followed by a space). */
+int  bej_json_name(bej_sink_t* out, const char* name, size_t n);
+/** Writes the "_<seq>": key used for properties missing from the dictionary. */
+void bej_json_seq_name(bej_sink_t* out, uint16_t seq);
+/** Writes the key of a member whose named entry is @p def (NULL: "_<seq>"), copied from the dictionary's keys. */
+void bej_json_key(bej_sink_t* out, const bej_dictionary_t* dict, const bej_dict_entry_t* def, uint16_t seq);
+
+/** Renders the value whose SFL tuple starts at @p s, resolving its seq in @p current_children. */
+int bej_json_value(bej_decoder_t* dec, bej_stream_t* s, const dict_subset_t* current_children);
+
+/** Renders the value of a tuple whose SFL header has been read, laid out as
+ *  the full decode would at dec's current position; @p s is at the value. */
+int bej_json_tuple(bej_decoder_t* dec, bej_stream_t* s,
+    uint64_t seq_sel, uint8_t fmt, uint64_t len,
+    const dict_subset_t* current_children);
+
+/* The JSON writer's layout steps, for front ends that pick what to render. */
+/** Separator, indentation and key of the next set member; its value follows. */
+void bej_json_member_key(bej_decoder_t* dec, const bej_dict_entry_t* def, uint16_t seq);
+/** Opens ('{' or '[') or closes a container. */
+void bej_json_open(bej_decoder_t* dec, char c);
+void bej_json_close(bej_decoder_t* dec, char c);
+void bej_json_null(bej_decoder_t* dec);
+
+/** Renders a non-container value whose SFL tuple has been read; @p s is at the value. */
+int bej_json_leaf(bej_decoder_t* dec,
+    bej_stream_t* s,
+    uint8_t fmt, uint64_t seq_sel, uint64_t len,
+    const dict_subset_t* current_children);
+
+/** Projection tree node (bej_project.c). Children are node indices + 1, 0 = none. */
+typedef struct {
+    uint32_t key;           /* property seq, or array index */
+    uint32_t first_child;
+    uint32_t next_sibling;
+    uint32_t child_count;
+    uint8_t  all;           /* the whole subtree is selected */
+} bej_proj_node_t;
+
+struct bej_projection_s {
+    bej_proj_node_t* nodes;     /* nodes[0] is the root set */
+    uint32_t count, cap;
+};
+
+/** Child of @p node with @p key, or NULL when that subtree is not selected. */
+static inline const bej_proj_node_t* bej_proj_child(const bej_projection_t* proj,
+    const bej_proj_node_t* node, uint32_t key) {
+    for (uint32_t i = node->first_child; i; i = proj->nodes[i - 1].next_sibling)
+        if (proj->nodes[i - 1].key == key) return &proj->nodes[i - 1];
+    return NULL;
+}
+
+/* JSON-pointer helpers shared by bej_project.c and bej_index.c. */
+#define BEJ_POINTER_MAX_SEGMENT 256
+
+/** Moves @p path past its next "/segment", unescaping ~0 and ~1 into @p seg. Returns 0 or -2. */
+int bej_pointer_segment(const char** path, char* seg, size_t cap, size_t* n);
+/** Parses a canonical decimal (no sign, no leading zeros) no larger than @p max. */
+int bej_parse_index(const char* s, size_t n, uint32_t max, uint32_t* out);
+
+#endif /* BEJ_INTERNAL_H */
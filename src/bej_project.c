@@ -0,0 +1,146 @@
+#include "bej_project.h"
+#include "bej_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Returns the index of @p parent's child with @p key, adding it if needed; -1 on OOM. */
+static long proj_child(bej_projection_t* proj, uint32_t parent, uint32_t key) {
+    const bej_proj_node_t* hit = bej_proj_child(proj, &proj->nodes[parent], key);
+    if (hit) return (long)(hit - proj->nodes);
+    if (proj->count == proj->cap) {
+        uint32_t cap = proj->cap ? proj->cap * 2 : 16;
+        bej_proj_node_t* nodes = (bej_proj_node_t*)realloc(proj->nodes, cap * sizeof(*nodes));
+        if (!nodes) return -1;
+        proj->nodes = nodes;
+        proj->cap = cap;
+    }
+    uint32_t idx = proj->count++;
+    bej_proj_node_t* n = &proj->nodes[idx];
+    memset(n, 0, sizeof(*n));
+    n->key = key;
+    n->next_sibling = proj->nodes[parent].first_child;
+    proj->nodes[parent].first_child = idx + 1;
+    proj->nodes[parent].child_count++;
+    return (long)idx;
+}
+
+int bej_parse_index(const char* s, size_t n, uint32_t max, uint32_t* out) {
+    if (n == 0 || n > 10 || (n > 1 && s[0] == '0')) return -1;
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (s[i] < '0' || s[i] > '9') return -1;
+        v = v * 10 + (uint64_t)(s[i] - '0');
+    }
+    if (v > max) return -1;
+    *out = (uint32_t)v;
+    return 0;
+}
+
+/* Resolves one unescaped segment below @p *def (NULL: not in the dictionary)
+ * into a key, and moves @p *def to the entry describing it. */
+static int resolve_segment(const bej_dictionary_t* d, const bej_dict_entry_t** def,
+    const char* seg, size_t n, uint32_t* key) {
+    const bej_dict_entry_t* e = *def;
+    dict_subset_t kids = (dict_subset_t){ 0 };
+    if (e && e->child_count) kids = dict_children(d, (int)(e - d->entries));
+
+    if (e && e->format == BEJ_FMT_ARRAY) {
+        if (bej_parse_index(seg, n, UINT32_MAX, key) != 0) return -2;
+        *def = kids.count ? &kids.list[0] : NULL;    /* the element template */
+        return 0;
+    }
+    if (e && e->format != BEJ_FMT_SET) return -2;   /* nothing below a leaf */
+
+    if (n > 1 && seg[0] == '_' && bej_parse_index(seg + 1, n - 1, 0xFFFF, key) == 0) {
+        *def = kids.count ? dict_child_by_seq(&kids, (uint16_t)*key) : NULL;
+        return 0;
+    }
+    if (!e) return bej_parse_index(seg, n, UINT32_MAX, key) == 0 ? 0 : -2;
+    for (uint16_t i = 0; i < kids.count; ++i) {
+        const bej_dict_entry_t* c = &kids.list[i];
+        if (c->name_len == n && !memcmp(dict_entry_name(d, c), seg, n)) {
+            *key = c->seq;
+            *def = c;
+            return 0;
+        }
+    }
+    return -2;
+}
+
+int bej_pointer_segment(const char** path, char* seg, size_t cap, size_t* n) {
+    const char* p = *path;
+    if (*p != '/') return -2;
+    *n = 0;
+    for (++p; *p && *p != '/'; ++p) {
+        char c = *p;
+        if (c == '~') {
+            if (p[1] == '0') c = '~';
+            else if (p[1] == '1') c = '/';
+            else return -2;
+            ++p;
+        }
+        if (*n == cap) return -2;
+        seg[(*n)++] = c;
+    }
+    *path = p;
+    return 0;
+}
+
+static int add_path(bej_projection_t* proj, const bej_dictionary_t* d, const char* path) {
+    uint32_t node = 0;
+    const bej_dict_entry_t* def = d->entry_count ? &d->entries[0] : NULL;
+
+    while (*path) {
+        char seg[BEJ_POINTER_MAX_SEGMENT];
+        size_t n = 0;
+        uint32_t key;
+        if (bej_pointer_segment(&path, seg, sizeof(seg), &n) != 0) return -2;
+        int rc = resolve_segment(d, &def, seg, n, &key);
+        if (rc != 0) return rc;
+        if (proj->nodes[node].all) continue;     /* already wanted whole; just check the rest */
+        long child = proj_child(proj, node, key);
+        if (child < 0) return -1;
+        node = (uint32_t)child;
+    }
+    proj->nodes[node].all = 1;
+    return 0;
+}
+
+int bej_projection_new(const bej_dictionary_t* dict_major,
+    const char* const* paths, size_t count,
+    bej_projection_t** out, size_t* bad_path) {
+    *out = NULL;
+    bej_projection_t* proj = (bej_projection_t*)malloc(sizeof(*proj));
+    if (!proj) return -1;
+    proj->nodes = (bej_proj_node_t*)calloc(16, sizeof(*proj->nodes));
+    if (!proj->nodes) { free(proj); return -1; }
+    proj->cap = 16;
+    proj->count = 1;
+
+    for (size_t i = 0; i < count; ++i) {
+        int rc = add_path(proj, dict_major, paths[i]);
+        if (rc != 0) {
+            if (bad_path) *bad_path = i;
+            bej_projection_free(proj);
+            return rc;
+        }
+    }
+    *out = proj;
+    return 0;
+}
+
+void bej_projection_free(bej_projection_t* proj) {
+    if (!proj) return;
+    free(proj->nodes);
+    free(proj);
+}
+
+int bej_decode_projected(bej_sink_t* out,
+    const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major,
+    const bej_projection_t* proj) {
+    bej_decoder_t dec;
+    bej_decoder_init(&dec, dict_major, out);
+    dec.proj = proj;
+    return bej_decoder_run(&dec, bej, bej_size);
+}
@@ -0,0 +1,348 @@
+#include "bej_push.h"
+#include "bej_internal.h"
+#include "dict.h"
+#include "json_escape.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PUSH_DEFAULT_DEPTH 256
+#define PUSH_CARRY 64           /* > the longest buffered token (SFL tuple: 19 bytes, real: 52) */
+
+enum {
+    ST_HEADER,
+    ST_TUPLE,
+    ST_COUNT,
+    ST_FIXED,
+    ST_STRING,
+    ST_SKIP,
+    ST_DONE,
+    ST_ERROR
+};
+
+typedef struct {
+    uint8_t  is_set;
+    uint8_t  have_schema;
+    uint64_t remaining;
+    uint64_t seen;
+    uint64_t emitted;
+    dict_subset_t kids;
+} push_frame_t;
+
+struct bej_push_s {
+    bej_decoder_t dec;
+    int      state;
+    int      error;
+    size_t   offset;
+
+    push_frame_t* stack;
+    size_t   depth, max_depth;
+
+    /* The value being read: its tuple and the dictionary subset it resolves in. */
+    const dict_subset_t* cur_children;
+    uint64_t seq_sel, len, left;
+    uint8_t  fmt;
+    uint8_t  skip_is_null;
+
+    uint8_t  carry[PUSH_CARRY];
+    size_t   carry_len;
+};
+
+/* Token parsers: 0 = parsed (*used set), 1 = need more bytes, -1 = malformed. */
+
+static int parse_nnint(const uint8_t* b, size_t n, size_t* used, uint64_t* out) {
+    if (n < 1) return 1;
+    uint8_t count = b[0];
+    if (count > 8) return -1;
+    if (n < (size_t)1 + count) return 1;
+    uint64_t v = 0;
+    for (int i = count; i >= 1; --i) v = (v << 8) | b[i];
+    *out = v;
+    *used = (size_t)1 + count;
+    return 0;
+}
+
+static int parse_token(bej_push_t* p, const uint8_t* b, size_t n, size_t* used) {
+    switch (p->state) {
+    case ST_HEADER:
+        if (n < 7) return 1;
+        *used = 7;
+        return 0;
+    case ST_TUPLE: {
+        size_t u1, u2;
+        int rc = parse_nnint(b, n, &u1, &p->seq_sel);
+        if (rc) return rc;
+        if (n < u1 + 1) return 1;
+        rc = parse_nnint(b + u1 + 1, n - u1 - 1, &u2, &p->len);
+        if (rc) return rc;
+        p->fmt = (uint8_t)((b[u1] >> 4) & 0x0F);
+        *used = u1 + 1 + u2;
+        return 0;
+    }
+    case ST_COUNT: {
+        uint64_t count;
+        int rc = parse_nnint(b, n, used, &count);
+        if (rc == 0) p->left = count;
+        return rc;
+    }
+    case ST_FIXED:
+        if (n < p->len) return 1;
+        *used = (size_t)p->len;
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/* Locates the next token, in the input or, when it straddles chunks, in the
+ * carry buffer. Returns 0 with *tok and *tok_len set and the input advanced past
+ * it, 1 when the input ran out (bytes are kept in the carry), -1 on error. */
+static int take_token(bej_push_t* p, const uint8_t** data, size_t* n, const uint8_t** tok, size_t* tok_len) {
+    size_t used = 0;
+    if (p->carry_len == 0) {
+        int rc = parse_token(p, *data, *n, &used);
+        if (rc == 0) {
+            *tok = *data; *tok_len = used;
+            *data += used; *n -= used;
+            p->offset += used;
+            return 0;
+        }
+        if (rc < 0) return -1;
+        if (*n > PUSH_CARRY) return -1;
+        memcpy(p->carry, *data, *n);
+        p->carry_len = *n;
+        *data += *n; *n = 0;
+        return 1;
+    }
+    size_t add = PUSH_CARRY - p->carry_len;
+    if (add > *n) add = *n;
+    memcpy(p->carry + p->carry_len, *data, add);
+    int rc = parse_token(p, p->carry, p->carry_len + add, &used);
+    if (rc == 0) {
+        size_t fresh = used - p->carry_len;
+        *data += fresh; *n -= fresh;
+        *tok = p->carry; *tok_len = used;
+        p->carry_len = 0;
+        p->offset += used;
+        return 0;
+    }
+    if (rc < 0 || p->carry_len + add == PUSH_CARRY) return -1;
+    p->carry_len += add;
+    *data += add; *n -= add;
+    return 1;
+}
+
+bej_push_t* bej_push_new(const bej_dictionary_t* dict_major, bej_sink_t* out, size_t max_depth) {
+    bej_push_t* p = (bej_push_t*)calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->max_depth = max_depth ? max_depth : PUSH_DEFAULT_DEPTH;
+    p->stack = (push_frame_t*)calloc(p->max_depth, sizeof(push_frame_t));
+    if (!p->stack) { free(p); return NULL; }
+    bej_decoder_init(&p->dec, dict_major, out);
+    p->state = ST_HEADER;
+    return p;
+}
+
+void bej_push_free(bej_push_t* p) {
+    if (!p) return;
+    free(p->stack);
+    free(p);
+}
+
+size_t bej_push_offset(const bej_push_t* p) {
+    return p->offset;
+}
+
+/* A value finished: close every container it completes. */
+static void value_done(bej_push_t* p) {
+    bej_sink_t* out = p->dec.out;
+    while (p->depth) {
+        push_frame_t* top = &p->stack[p->depth - 1];
+        if (--top->remaining) { p->state = ST_TUPLE; return; }
+        p->dec.pp_level--;
+        if (top->is_set ? top->emitted : top->seen) bej_pp_nl(&p->dec);
+        bej_sink_putc(out, top->is_set ? '}' : ']');
+        p->depth--;
+    }
+    p->state = ST_DONE;
+}
+
+/* The tuple of a set member or array element has been read: emit the
+ * separator and key exactly as decode_value does, then pick its state. */
+static int on_tuple(bej_push_t* p) {
+    bej_sink_t* out = p->dec.out;
+    const bej_dictionary_t* dict = p->dec.dict;
+    if (p->depth) {
+        push_frame_t* top = &p->stack[p->depth - 1];
+        if (top->is_set) {
+            if ((p->seq_sel & 0x1) != BEJ_SEL_MAJOR) {
+                p->left = p->len;
+                p->skip_is_null = 0;
+                p->state = ST_SKIP;
+                return 0;
+            }
+            uint16_t cseq = (uint16_t)((p->seq_sel >> 1) & 0xFFFF);
+            const bej_dict_entry_t* child_def = top->have_schema ? dict_child_by_seq(&top->kids, cseq) : NULL;
+            if (top->emitted++) bej_sink_putc(out, ',');
+            bej_pp_nl(&p->dec);
+            if (child_def && !child_def->name_len) child_def = NULL;
+            bej_json_key(out, dict, child_def, cseq);
+            p->cur_children = child_def ? &top->kids : NULL;
+        }
+        else {
+            if (top->seen) bej_sink_putc(out, ',');
+            bej_pp_nl(&p->dec);
+            p->cur_children = top->have_schema ? &top->kids : NULL;
+        }
+        top->seen++;
+    }
+
+    switch (p->fmt) {
+    case BEJ_FMT_SET:
+    case BEJ_FMT_ARRAY:
+        p->state = ST_COUNT;
+        return 0;
+    case BEJ_FMT_STRING:
+        if (p->len == 0) return -1;
+        bej_sink_putc(out, '"');
+        p->left = p->len;
+        p->state = ST_STRING;
+        return 0;
+    case BEJ_FMT_NULL:
+        p->left = p->len;
+        p->skip_is_null = 1;
+        p->state = ST_SKIP;
+        return 0;
+    case BEJ_FMT_INTEGER:
+    case BEJ_FMT_BOOLEAN:
+    case BEJ_FMT_REAL:
+    case BEJ_FMT_ENUM:
+        if (p->len > PUSH_CARRY) return -1;
+        p->state = ST_FIXED;
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+static int on_count(bej_push_t* p) {
+    bej_sink_t* out = p->dec.out;
+    const bej_dictionary_t* dict = p->dec.dict;
+    uint64_t count = p->left;
+    uint16_t seq = (uint16_t)((p->seq_sel >> 1) & 0xFFFF);
+    int is_set = p->fmt == BEJ_FMT_SET;
+
+    dict_subset_t kids = (dict_subset_t){ 0 };
+    int have_schema = 0;
+    if (is_set && !p->cur_children) {
+        kids = dict_children(dict, -1);
+        have_schema = 1;
+    }
+    else if (p->cur_children) {
+        const bej_dict_entry_t* def = dict_child_by_seq(p->cur_children, seq);
+        if (def) {
+            kids = dict_children(dict, (int)(def - dict->entries));
+            have_schema = 1;
+        }
+    }
+
+    bej_sink_putc(out, is_set ? '{' : '[');
+    if (count == 0) {
+        bej_sink_putc(out, is_set ? '}' : ']');
+        value_done(p);
+        return 0;
+    }
+    if (p->depth == p->max_depth) return -3;
+    push_frame_t* f = &p->stack[p->depth++];
+    memset(f, 0, sizeof(*f));
+    f->is_set = (uint8_t)is_set;
+    f->have_schema = (uint8_t)have_schema;
+    f->remaining = count;
+    f->kids = kids;
+    p->dec.pp_level++;
+    p->state = ST_TUPLE;
+    return 0;
+}
+
+static int fail(bej_push_t* p, int rc) {
+    p->state = ST_ERROR;
+    p->error = rc;
+    return rc;
+}
+
+int bej_push_feed(bej_push_t* p, const uint8_t* data, size_t n) {
+    bej_sink_t* out = p->dec.out;
+    for (;;) {
+        if (p->state == ST_ERROR) return p->error;
+        if (p->state == ST_DONE) return out->error ? -1 : BEJ_PUSH_DONE;
+
+        const uint8_t* tok; size_t tok_len;
+        int rc;
+        switch (p->state) {
+        case ST_HEADER:
+        case ST_TUPLE:
+        case ST_COUNT:
+        case ST_FIXED:
+            if (n == 0 && p->carry_len == 0 && !(p->state == ST_FIXED && p->len == 0)) return BEJ_PUSH_NEED_MORE;
+            rc = take_token(p, &data, &n, &tok, &tok_len);
+            if (rc == 1) return BEJ_PUSH_NEED_MORE;
+            if (rc < 0) return fail(p, -1);
+
+            if (p->state == ST_HEADER) {
+                if (!(tok[6] == 0x00 || tok[6] == 0x01)) return fail(p, -2);
+                p->cur_children = NULL;
+                p->state = ST_TUPLE;
+            }
+            else if (p->state == ST_TUPLE) {
+                if ((rc = on_tuple(p)) != 0) return fail(p, rc);
+            }
+            else if (p->state == ST_COUNT) {
+                if ((rc = on_count(p)) != 0) return fail(p, rc);
+            }
+            else {
+                bej_stream_t vs;
+                bej_stream_init(&vs, tok, tok_len);
+                if (bej_json_leaf(&p->dec, &vs, p->fmt, p->seq_sel, p->len, p->cur_children) != 0) return fail(p, -1);
+                value_done(p);
+            }
+            break;
+
+        case ST_STRING:
+            if (n == 0) return BEJ_PUSH_NEED_MORE;
+            if (p->left > 1) {
+                size_t k = p->left - 1 < n ? (size_t)(p->left - 1) : n;
+                json_escape_run(out, (const char*)data, k);
+                data += k; n -= k;
+                p->left -= k;
+                p->offset += k;
+            }
+            else {
+                /* The terminating NUL is not part of the JSON string. */
+                if (data[0] != '\0') json_escape_run(out, (const char*)data, 1);
+                data++; n--;
+                p->offset++;
+                bej_sink_putc(out, '"');
+                value_done(p);
+            }
+            break;
+
+        case ST_SKIP: {
+            size_t k = p->left < n ? (size_t)p->left : n;
+            data += k; n -= k;
+            p->left -= k;
+            p->offset += k;
+            if (p->left) return BEJ_PUSH_NEED_MORE;
+            if (p->skip_is_null) bej_sink_write(out, "null", 4);
+            value_done(p);
+            break;
+        }
+        default:
+            return fail(p, -1);
+        }
+    }
+}
+
+int bej_push_finish(bej_push_t* p) {
+    if (p->state == ST_ERROR) return p->error;
+    if (p->state != ST_DONE) return -1;
+    return p->dec.out->error ? -1 : 0;
+}
@@ -0,0 +1,70 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "bej_stats.h"
+#include <inttypes.h>
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+int bej_stats_enabled(void) {
+#ifdef BEJ_STATS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+uint64_t bej_stats_clock_ns(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000000u
+        + (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000000u / (uint64_t)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void bej_stats_merge(bej_stats_t* into, const bej_stats_t* from) {
+    into->bytes += from->bytes;
+    for (int i = 0; i < 16; ++i) into->tuples[i] += from->tuples[i];
+    into->dict_lookups += from->dict_lookups;
+    into->dict_misses += from->dict_misses;
+    into->annotation_bytes += from->annotation_bytes;
+    if (from->max_depth > into->max_depth) into->max_depth = from->max_depth;
+    into->dict_load_ns += from->dict_load_ns;
+    into->read_ns += from->read_ns;
+    into->decode_ns += from->decode_ns;
+}
+
+static const char* const format_names[16] = {
+    "set", "array", NULL, "integer", "enum", "string", "real", "boolean",
+    "bytes", "choice", "null", NULL, NULL, NULL, "resource_link", "annotation"
+};
+
+int bej_stats_write_json(FILE* f, const bej_stats_t* st) {
+    fprintf(f, "{\"enabled\": %s, \"bytes\": %" PRIu64 ", \"tuples\": {",
+        bej_stats_enabled() ? "true" : "false", st->bytes);
+    const char* sep = "";
+    for (int i = 0; i < 16; ++i) {
+        if (!st->tuples[i]) continue;
+        if (format_names[i]) fprintf(f, "%s\"%s\": %" PRIu64, sep, format_names[i], st->tuples[i]);
+        else fprintf(f, "%s\"0x%x\": %" PRIu64, sep, (unsigned)i, st->tuples[i]);
+        sep = ", ";
+    }
+    fprintf(f, "}, \"dict_lookups\": %" PRIu64 ", \"dict_misses\": %" PRIu64
+        ", \"annotation_bytes\": %" PRIu64 ", \"max_depth\": %u"
+        ", \"time_ns\": {\"dict_load\": %" PRIu64 ", \"read\": %" PRIu64 ", \"decode\": %" PRIu64 "}}\n",
+        st->dict_lookups, st->dict_misses, st->annotation_bytes, (unsigned)st->max_depth,
+        st->dict_load_ns, st->read_ns, st->decode_ns);
+    return ferror(f) ? -1 : 0;
+}
@@ -0,0 +1,115 @@
+#ifndef BEJ_THREAD_H
+#define BEJ_THREAD_H
+
+/* The few thread primitives the library uses: pthreads, or their Win32
+ * counterparts. Not installed; not part of the public API. Every function
+ * returns 0 on success like its pthread original. */
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <stdlib.h>
+
+typedef SRWLOCK bej_mutex_t;
+typedef CONDITION_VARIABLE bej_cond_t;
+typedef HANDLE bej_thread_t;
+typedef INIT_ONCE bej_once_t;
+#define BEJ_ONCE_INIT INIT_ONCE_STATIC_INIT
+
+static inline int bej_mutex_init(bej_mutex_t* m) { InitializeSRWLock(m); return 0; }
+static inline void bej_mutex_destroy(bej_mutex_t* m) { (void)m; }
+static inline void bej_mutex_lock(bej_mutex_t* m) { AcquireSRWLockExclusive(m); }
+static inline void bej_mutex_unlock(bej_mutex_t* m) { ReleaseSRWLockExclusive(m); }
+
+static inline int bej_cond_init(bej_cond_t* c) { InitializeConditionVariable(c); return 0; }
+static inline void bej_cond_destroy(bej_cond_t* c) { (void)c; }
+static inline void bej_cond_wait(bej_cond_t* c, bej_mutex_t* m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+static inline void bej_cond_signal(bej_cond_t* c) { WakeConditionVariable(c); }
+static inline void bej_cond_broadcast(bej_cond_t* c) { WakeAllConditionVariable(c); }
+
+typedef struct {
+    void* (*fn)(void*);
+    void* arg;
+} bej_thread_start_t;
+
+static inline DWORD WINAPI bej_thread_main(LPVOID p) {
+    bej_thread_start_t start = *(bej_thread_start_t*)p;
+    free(p);
+    start.fn(start.arg);
+    return 0;
+}
+
+static inline int bej_thread_create(bej_thread_t* t, void* (*fn)(void*), void* arg) {
+    bej_thread_start_t* start = (bej_thread_start_t*)malloc(sizeof(*start));
+    if (!start) return -1;
+    start->fn = fn;
+    start->arg = arg;
+    *t = CreateThread(NULL, 0, bej_thread_main, start, 0, NULL);
+    if (!*t) { free(start); return -1; }
+    return 0;
+}
+
+static inline void bej_thread_join(bej_thread_t t) {
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+
+typedef struct {
+    void (*fn)(void);
+} bej_once_fn_t;
+
+static inline BOOL CALLBACK bej_once_main(PINIT_ONCE once, PVOID p, PVOID* ctx) {
+    (void)once; (void)ctx;
+    ((const bej_once_fn_t*)p)->fn();
+    return TRUE;
+}
+
+static inline void bej_once(bej_once_t* once, void (*fn)(void)) {
+    bej_once_fn_t f = { fn };
+    InitOnceExecuteOnce(once, bej_once_main, &f, NULL);
+}
+
+static inline int bej_cpu_count(void) {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors > 0 ? (int)si.dwNumberOfProcessors : 1;
+}
+
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t bej_mutex_t;
+typedef pthread_cond_t bej_cond_t;
+typedef pthread_t bej_thread_t;
+typedef pthread_once_t bej_once_t;
+#define BEJ_ONCE_INIT PTHREAD_ONCE_INIT
+
+static inline int bej_mutex_init(bej_mutex_t* m) { return pthread_mutex_init(m, NULL); }
+static inline void bej_mutex_destroy(bej_mutex_t* m) { pthread_mutex_destroy(m); }
+static inline void bej_mutex_lock(bej_mutex_t* m) { pthread_mutex_lock(m); }
+static inline void bej_mutex_unlock(bej_mutex_t* m) { pthread_mutex_unlock(m); }
+
+static inline int bej_cond_init(bej_cond_t* c) { return pthread_cond_init(c, NULL); }
+static inline void bej_cond_destroy(bej_cond_t* c) { pthread_cond_destroy(c); }
+static inline void bej_cond_wait(bej_cond_t* c, bej_mutex_t* m) { pthread_cond_wait(c, m); }
+static inline void bej_cond_signal(bej_cond_t* c) { pthread_cond_signal(c); }
+static inline void bej_cond_broadcast(bej_cond_t* c) { pthread_cond_broadcast(c); }
+
+static inline int bej_thread_create(bej_thread_t* t, void* (*fn)(void*), void* arg) {
+    return pthread_create(t, NULL, fn, arg);
+}
+
+static inline void bej_thread_join(bej_thread_t t) { pthread_join(t, NULL); }
+
+static inline void bej_once(bej_once_t* once, void (*fn)(void)) { pthread_once(once, fn); }
+
+static inline int bej_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+#endif
+
+#endif /* BEJ_THREAD_H */
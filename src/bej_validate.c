@@ -0,0 +1,119 @@
+#include "bej.h"
+#include "dict.h"
+
+#define VALIDATE_MAX_DEPTH 256
+
+typedef struct {
+    const bej_dictionary_t* dict;
+    size_t err_off;
+} validator_t;
+
+static int vfail(validator_t* v, size_t at, int rc) {
+    v->err_off = at;
+    return rc;
+}
+
+static int validate_real(bej_stream_t* s) {
+    uint64_t n, skip;
+    if (bej_read_nnint(s, &n) != 0 || n > 8 || n > s->size - s->pos) return -1;
+    s->pos += (size_t)n;
+    if (bej_read_nnint(s, &skip) != 0 || bej_read_nnint(s, &skip) != 0) return -1;   /* leading zeros, fraction */
+    if (bej_read_nnint(s, &n) != 0 || n > 8 || n > s->size - s->pos) return -1;
+    s->pos += (size_t)n;
+    return 0;
+}
+
+/* Validates the value of a tuple whose SFL header (at @p start) has been read.
+ * @p s is bounded to the value, so nothing inside can run past its length. */
+static int validate_value(validator_t* v, bej_stream_t* s, size_t start,
+    uint8_t fmt, const bej_dict_entry_t* def, int depth) {
+    const bej_dictionary_t* dict = v->dict;
+    if (def && def->format != fmt && fmt != BEJ_FMT_NULL) return vfail(v, start, -3);
+
+    switch (fmt) {
+    case BEJ_FMT_SET:
+    case BEJ_FMT_ARRAY: {
+        if (depth >= VALIDATE_MAX_DEPTH) return vfail(v, start, -2);
+        uint64_t count;
+        if (bej_read_nnint(s, &count) != 0) return vfail(v, start, -1);
+        dict_subset_t kids = (dict_subset_t){ 0 };
+        if (def && def->child_count) kids = dict_children(dict, (int)(def - dict->entries));
+        /* Array elements are all described by the array entry's single child. */
+        const bej_dict_entry_t* elem_def = fmt == BEJ_FMT_ARRAY && kids.count ? &kids.list[0] : NULL;
+
+        for (uint64_t i = 0; i < count; ++i) {
+            size_t cstart = s->pos;
+            uint64_t cseq_sel, clen; uint8_t cfmt, cfl;
+            if (bej_read_sfl(s, &cseq_sel, &cfmt, &clen, &cfl) != 0 || clen > s->size - s->pos)
+                return vfail(v, cstart, -1);
+            bej_stream_t inner = { s->p, s->pos + (size_t)clen, s->pos };
+            s->pos = inner.size;
+
+            const bej_dict_entry_t* cdef = elem_def;
+            if (fmt == BEJ_FMT_SET) {
+                if ((cseq_sel & 0x1) != BEJ_SEL_MAJOR) continue;    /* annotations: skipped, as the decoder does */
+                cdef = dict_child_by_seq(&kids, (uint16_t)((cseq_sel >> 1) & 0xFFFF));
+                /* Sets the schema leaves open (no children, e.g. Oem) accept any member. */
+                if (!cdef && kids.count) return vfail(v, cstart, -3);
+            }
+            int rc = validate_value(v, &inner, cstart, cfmt, cdef, depth + 1);
+            if (rc != 0) return rc;
+        }
+        break;
+    }
+    case BEJ_FMT_STRING:
+        if (s->size == s->pos) return vfail(v, start, -1);
+        s->pos = s->size;
+        break;
+    case BEJ_FMT_INTEGER:
+        if (s->size - s->pos < 1 || s->size - s->pos > 8) return vfail(v, start, -1);
+        s->pos = s->size;
+        break;
+    case BEJ_FMT_BOOLEAN:
+        if (s->size - s->pos != 1) return vfail(v, start, -1);
+        s->pos = s->size;
+        break;
+    case BEJ_FMT_ENUM: {
+        uint64_t val;
+        if (bej_read_nnint(s, &val) != 0) return vfail(v, start, -1);
+        if (def && def->child_count) {
+            dict_subset_t variants = dict_children(dict, (int)(def - dict->entries));
+            if (val > 0xFFFF || !dict_child_by_seq(&variants, (uint16_t)val)) return vfail(v, start, -3);
+        }
+        break;
+    }
+    case BEJ_FMT_REAL:
+        if (validate_real(s) != 0) return vfail(v, start, -1);
+        break;
+    case BEJ_FMT_NULL:
+        s->pos = s->size;
+        break;
+    default:
+        return vfail(v, start, -2);
+    }
+    /* The length field has to cover the value exactly. */
+    if (s->pos != s->size) return vfail(v, start, -1);
+    return 0;
+}
+
+int bej_validate(const uint8_t* bej, size_t bej_size,
+    const bej_dictionary_t* dict_major, size_t* err_off) {
+    validator_t v = { dict_major, 0 };
+    int rc;
+    if (bej_size < 7) rc = vfail(&v, bej_size, -1);
+    else if (!(bej[6] == 0x00 || bej[6] == 0x01)) rc = vfail(&v, 6, -2);
+    else {
+        bej_stream_t s;
+        bej_stream_init(&s, bej, bej_size);
+        s.pos = 7;
+        uint64_t seq_sel, len; uint8_t fmt, flags;
+        if (bej_read_sfl(&s, &seq_sel, &fmt, &len, &flags) != 0 || len > s.size - s.pos) rc = vfail(&v, 7, -1);
+        else {
+            /* The root set is the schema's top entry; bytes after it are ignored, as in the decoder. */
+            bej_stream_t inner = { s.p, s.pos + (size_t)len, s.pos };
+            rc = validate_value(&v, &inner, 7, fmt, dict_major->entry_count ? &dict_major->entries[0] : NULL, 0);
+        }
+    }
+    if (err_off) *err_off = v.err_off;
+    return rc;
+}
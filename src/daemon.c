@@ -0,0 +1,335 @@
+#define _POSIX_C_SOURCE 200809L
+#include "daemon.h"
+#include "pool.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BEJD_MAX_SCHEMA 255u
+#define BEJD_POLL_MS 100
+
+struct bejd_server_s {
+    const bejd_opts_t* opts;
+    int fd;
+    int stop;               /* set by bejd_server_stop from any thread or a signal handler */
+    char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+};
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/** Reads exactly @p n bytes. Returns 0, 1 on EOF before the first byte, -1 otherwise. */
+static int read_full(int fd, void* buf, size_t n) {
+    uint8_t* p = (uint8_t*)buf;
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = read(fd, p + got, n - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return r == 0 && got == 0 ? 1 : -1;
+        got += (size_t)r;
+    }
+    return 0;
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int send_full(int fd, const void* buf, size_t n) {
+    const uint8_t* p = (const uint8_t*)buf;
+    while (n) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        p += w; n -= (size_t)w;
+    }
+    return 0;
+}
+
+static int set_nonblock(int fd, int on) {
+    int fl = fcntl(fd, F_GETFL);
+    if (fl < 0) return -1;
+    return fcntl(fd, F_SETFL, on ? fl | O_NONBLOCK : fl & ~O_NONBLOCK);
+}
+
+static int fill_addr(struct sockaddr_un* addr, const char* path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return -1;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+/* ---- server ---- */
+
+typedef struct {
+    uint8_t* in;            /* schema key, NUL, payload */
+    size_t   in_cap;
+    bej_sink_t out;         /* reply header and body */
+} bejd_worker_t;
+
+static const char* status_text(int status) {
+    switch (status) {
+    case -1: return "malformed payload";
+    case -2: return "unsupported content";
+    case -3: return "payload does not match the dictionary";
+    case BEJD_NO_SCHEMA: return "no dictionary for schema";
+    case BEJD_TOO_LARGE: return "payload too large";
+    case BEJD_BAD_FRAME: return "bad request header";
+    default: return "out of memory";
+    }
+}
+
+/** Replaces whatever the reply holds with an error. */
+static void reply_error(bejd_worker_t* w, int status, const char* detail) {
+    w->out.len = BEJD_HEADER_SIZE;
+    w->out.error = 0;
+    bej_sink_puts(&w->out, status_text(status));
+    if (detail && *detail) {
+        bej_sink_puts(&w->out, ": ");
+        bej_sink_puts(&w->out, detail);
+    }
+    put_u32((uint8_t*)w->out.buf + 4, (uint32_t)status);
+}
+
+static int reply_send(int fd, bejd_worker_t* w) {
+    uint8_t* h = (uint8_t*)w->out.buf;
+    memcpy(h, "BEJR", 4);
+    put_u32(h + 12, (uint32_t)(w->out.len - BEJD_HEADER_SIZE));
+    return send_full(fd, w->out.buf, w->out.len);
+}
+
+/** Decodes one request into the worker's reply. */
+static void handle(bejd_server_t* srv, bejd_worker_t* w, const char* key, const uint8_t* bej, size_t bej_size) {
+    const bejd_opts_t* o = srv->opts;
+    w->out.len = 0;
+    w->out.error = 0;
+    char* h = bej_sink_reserve(&w->out, BEJD_HEADER_SIZE);
+    if (!h) return;
+    memset(h, 0, BEJD_HEADER_SIZE);
+    w->out.len = BEJD_HEADER_SIZE;
+
+    const bej_dictionary_t* dict = o->dict;
+    if (o->registry) {
+        if (!*key) key = o->schema ? o->schema : "";
+        dict = *key ? dict_registry_acquire_key(o->registry, key) : NULL;
+        if (!dict) { reply_error(w, BEJD_NO_SCHEMA, *key ? key : "(none)"); return; }
+    }
+    int rc = o->cache ? bej_cache_decode(o->cache, &w->out, bej, bej_size, dict)
+        : bej_decode_to_sink(&w->out, bej, bej_size, dict);
+    if (rc == 0 && w->out.error) rc = BEJD_NO_MEMORY;
+    if (rc != 0) {
+        size_t off = 0;
+        if (rc != BEJD_NO_MEMORY) bej_validate(bej, bej_size, dict, &off);
+        reply_error(w, rc, NULL);
+        put_u32((uint8_t*)w->out.buf + 8, (uint32_t)off);
+    }
+    if (o->registry) dict_registry_release(o->registry, dict);
+}
+
+/* Lock-free atomics, so the flag is also safe to set from a signal handler. */
+static int stopping(bejd_server_t* srv) {
+    return __atomic_load_n(&srv->stop, __ATOMIC_RELAXED);
+}
+
+/** Waits until @p fd has data. Returns 1, or 0 when the server is stopping,
+ *  the poll fails or @p deadline (now_ms) passes. */
+static int wait_readable(bejd_server_t* srv, int fd, int64_t deadline) {
+    while (!stopping(srv)) {
+        int64_t left = deadline - now_ms();
+        if (left <= 0) return 0;
+        struct pollfd p = { fd, POLLIN, 0 };
+        int r = poll(&p, 1, left < BEJD_POLL_MS ? (int)left : BEJD_POLL_MS);
+        if (r < 0 && errno != EINTR) return 0;
+        if (r > 0) return 1;
+    }
+    return 0;
+}
+
+/** read_full for the server: each read waits in wait_readable, so a peer
+ *  that stalls is dropped at @p deadline or when the server stops. */
+static int recv_full(bejd_server_t* srv, int fd, void* buf, size_t n, int64_t deadline) {
+    uint8_t* p = (uint8_t*)buf;
+    size_t got = 0;
+    while (got < n) {
+        if (!wait_readable(srv, fd, deadline)) return -1;
+        ssize_t r = read(fd, p + got, n - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        got += (size_t)r;
+    }
+    return 0;
+}
+
+static void serve_conn(bejd_server_t* srv, bejd_worker_t* w, int fd) {
+    const bejd_opts_t* o = srv->opts;
+    size_t max_payload = o->max_payload ? o->max_payload : BEJD_DEFAULT_MAX_PAYLOAD;
+    int idle_ms = o->idle_timeout_ms > 0 ? o->idle_timeout_ms : BEJD_DEFAULT_IDLE_MS;
+    int request_ms = o->request_timeout_ms > 0 ? o->request_timeout_ms : BEJD_DEFAULT_REQUEST_MS;
+    /* Replies to a peer that stops reading fail instead of blocking. */
+    struct timeval tv = { request_ms / 1000, (request_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    uint8_t hdr[BEJD_HEADER_SIZE];
+    for (;;) {
+        if (!wait_readable(srv, fd, now_ms() + idle_ms)) return;
+        /* The whole request is due within request_ms of its first byte. */
+        int64_t deadline = now_ms() + request_ms;
+        if (recv_full(srv, fd, hdr, sizeof(hdr), deadline) != 0) return;
+        uint32_t key_len = get_u32(hdr + 4), bej_len = get_u32(hdr + 8);
+        int status = memcmp(hdr, "BEJQ", 4) != 0 || key_len > BEJD_MAX_SCHEMA ? BEJD_BAD_FRAME
+            : bej_len > max_payload ? BEJD_TOO_LARGE : 0;
+        size_t need = (size_t)key_len + 1 + bej_len;
+        if (status == 0 && need > w->in_cap) {
+            uint8_t* n = (uint8_t*)realloc(w->in, need);
+            if (n) { w->in = n; w->in_cap = need; }
+            else status = BEJD_NO_MEMORY;
+        }
+        if (status != 0) {
+            /* The rest of the stream cannot be trusted: answer and hang up. */
+            w->out.len = 0;
+            if (bej_sink_reserve(&w->out, BEJD_HEADER_SIZE)) {
+                memset(w->out.buf, 0, BEJD_HEADER_SIZE);
+                reply_error(w, status, NULL);
+                reply_send(fd, w);
+            }
+            return;
+        }
+        if (recv_full(srv, fd, w->in, key_len, deadline) != 0
+            || recv_full(srv, fd, w->in + key_len + 1, bej_len, deadline) != 0) return;
+        w->in[key_len] = '\0';
+        handle(srv, w, (const char*)w->in, w->in + key_len + 1, bej_len);
+        if (w->out.len < BEJD_HEADER_SIZE) return;   /* not even room for a header */
+        if (reply_send(fd, w) != 0) return;
+    }
+}
+
+static void worker(void* ctx, size_t idx) {
+    (void)idx;
+    bejd_server_t* srv = (bejd_server_t*)ctx;
+    bejd_worker_t w = { 0 };
+    if (bej_sink_init_mem(&w.out, 64 * 1024) != 0) return;
+    while (!stopping(srv)) {
+        struct pollfd p = { srv->fd, POLLIN, 0 };
+        if (poll(&p, 1, BEJD_POLL_MS) <= 0) continue;
+        int fd = accept(srv->fd, NULL, NULL);
+        if (fd < 0) continue;           /* another worker took it */
+        if (set_nonblock(fd, 0) == 0) serve_conn(srv, &w, fd);
+        close(fd);
+    }
+    free(w.in);
+    bej_sink_free(&w.out);
+}
+
+int bejd_server_open(const bejd_opts_t* opts, bejd_server_t** out) {
+    *out = NULL;
+    struct sockaddr_un addr;
+    if (!opts->socket_path || fill_addr(&addr, opts->socket_path) != 0) return -1;
+    if (!opts->dict && !opts->registry) return -1;
+
+    /* A socket file nobody answers on is left over from a daemon that died. */
+    struct stat st;
+    if (stat(opts->socket_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        int probe = bejd_connect(opts->socket_path);
+        if (probe >= 0) { close(probe); return -1; }
+        unlink(opts->socket_path);
+    }
+
+    bejd_server_t* srv = (bejd_server_t*)calloc(1, sizeof(*srv));
+    if (!srv) return -1;
+    srv->opts = opts;
+    strcpy(srv->path, addr.sun_path);
+    srv->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (srv->fd < 0) { free(srv); return -1; }
+    if (bind(srv->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(srv->fd); free(srv);
+        return -1;
+    }
+    /* Workers poll, then race to accept: the losers must not block. */
+    if (listen(srv->fd, 128) != 0 || set_nonblock(srv->fd, 1) != 0) {
+        bejd_server_close(srv);
+        return -1;
+    }
+    *out = srv;
+    return 0;
+}
+
+int bejd_server_run(bejd_server_t* srv) {
+    int threads = srv->opts->threads > 0 ? srv->opts->threads : pool_default_threads();
+    return pool_run(threads, (size_t)threads, worker, srv);
+}
+
+void bejd_server_stop(bejd_server_t* srv) {
+    __atomic_store_n(&srv->stop, 1, __ATOMIC_RELAXED);
+}
+
+void bejd_server_close(bejd_server_t* srv) {
+    if (!srv) return;
+    close(srv->fd);
+    unlink(srv->path);
+    free(srv);
+}
+
+/* ---- client ---- */
+
+int bejd_connect(const char* socket_path) {
+    struct sockaddr_un addr;
+    if (fill_addr(&addr, socket_path) != 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int bejd_request(int fd, const char* schema, const uint8_t* bej, size_t bej_size, bejd_reply_t* reply) {
+    size_t key_len = schema ? strlen(schema) : 0;
+    if (key_len > BEJD_MAX_SCHEMA || bej_size > UINT32_MAX) return -1;
+    uint8_t hdr[BEJD_HEADER_SIZE + BEJD_MAX_SCHEMA];
+    memcpy(hdr, "BEJQ", 4);
+    put_u32(hdr + 4, (uint32_t)key_len);
+    put_u32(hdr + 8, (uint32_t)bej_size);
+    put_u32(hdr + 12, 0);
+    if (key_len) memcpy(hdr + BEJD_HEADER_SIZE, schema, key_len);
+    if (send_full(fd, hdr, BEJD_HEADER_SIZE + key_len) != 0) return -1;
+    /* A refused payload is not read to the end; the reply saying why may still be waiting. */
+    send_full(fd, bej, bej_size);
+
+    if (read_full(fd, hdr, BEJD_HEADER_SIZE) != 0 || memcmp(hdr, "BEJR", 4) != 0) return -1;
+    size_t len = get_u32(hdr + 12);
+    if (len + 1 > reply->cap) {
+        char* body = (char*)realloc(reply->body, len + 1);
+        if (!body) return -1;
+        reply->body = body;
+        reply->cap = len + 1;
+    }
+    if (read_full(fd, reply->body, len) != 0) return -1;
+    reply->body[len] = '\0';
+    reply->len = len;
+    reply->status = (int32_t)get_u32(hdr + 4);
+    reply->offset = get_u32(hdr + 8);
+    return 0;
+}
+
+void bejd_reply_free(bejd_reply_t* reply) {
+    free(reply->body);
+    reply->body = NULL;
+    reply->len = reply->cap = 0;
+}
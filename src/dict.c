@@ -1,14 +1,43 @@
 #include "dict.h"
 #include "io.h"
+#include "json_escape.h"
 #include <stdlib.h>
 #include <string.h>
 
 static uint16_t rd16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
 static uint32_t rd32(const uint8_t* p) { return (uint32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24)); }
 
+#define DICT_INDEX_MIN_CHILDREN 8
+
+static int dict_parse(bej_dictionary_t* out, const dict_load_opts_t* opts);
+
 int dict_load(const char* path, bej_dictionary_t* out) {
+    return dict_load_ex(path, out, NULL);
+}
+
+int dict_load_ex(const char* path, bej_dictionary_t* out, const dict_load_opts_t* opts) {
+    memset(out, 0, sizeof(*out));
+    if (!opts || !opts->no_mmap) {
+        if (map_file_all(path, &out->bytes, &out->size, &out->bytes_mapped) != 0) return -1;
+    }
+    else {
+        uint8_t* buf = NULL;
+        if (read_file_all(path, &buf, &out->size) != 0) return -1;
+        out->bytes = buf;
+    }
+    return dict_parse(out, opts);
+}
+
+int dict_load_mem(const uint8_t* data, size_t size, bej_dictionary_t* out, const dict_load_opts_t* opts) {
     memset(out, 0, sizeof(*out));
-    if (read_file_all(path, &out->bytes, &out->size) != 0) return -1;
+    out->bytes = data;
+    out->size = size;
+    out->bytes_borrowed = 1;
+    return dict_parse(out, opts);
+}
+
+static int dict_parse(bej_dictionary_t* out, const dict_load_opts_t* opts) {
+    if (dict_image_is(out->bytes, out->size)) return dict_image_attach(out);
     if (out->size < 12) return -1;
 
     const uint8_t* p = out->bytes;
@@ -17,6 +46,7 @@ int dict_load(const char* path, bej_dictionary_t* out) {
     out->entry_count = rd16(p + 2);
     out->schema_version = rd32(p + 4);
     out->dict_size = rd32(p + 8);
+    out->identity = dict_content_hash(out->bytes, out->size);
 
     out->header_size = 1 + 1 + 2 + 4 + 4; 
     out->entry_size = 1 + 2 + 2 + 2 + 1 + 2;
@@ -24,68 +54,247 @@ int dict_load(const char* path, bej_dictionary_t* out) {
     size_t need = out->header_size + (size_t)out->entry_count * out->entry_size;
     if (out->size < need) return -1;
 
-    out->entries = (bej_dict_entry_t*)calloc(out->entry_count, sizeof(bej_dict_entry_t));
-    if (!out->entries) return -1;
+    bej_dict_entry_t* entries = (bej_dict_entry_t*)calloc(out->entry_count ? out->entry_count : 1, sizeof(bej_dict_entry_t));
+    if (!entries) return -1;
+    out->entries = entries;
+    out->names = (const char*)out->bytes;
 
-    const uint8_t* pool = out->bytes;
     for (uint16_t i = 0; i < out->entry_count; ++i) {
         const uint8_t* e = p + out->header_size + (size_t)i * out->entry_size;
         uint8_t fmtf = e[0];
-        out->entries[i].format = (fmtf >> 4) & 0x0F;
-        out->entries[i].flags = fmtf & 0x0F;
-        out->entries[i].seq = rd16(e + 1);
+        entries[i].format = (fmtf >> 4) & 0x0F;
+        entries[i].flags = fmtf & 0x0F;
+        entries[i].seq = rd16(e + 1);
 
         uint16_t child_ptr_bin = rd16(e + 3);
         uint16_t child_count = rd16(e + 5);
-        uint8_t  name_len = e[7];
         uint16_t name_off = rd16(e + 8);
 
 
         if (child_ptr_bin != 0) {
             int32_t idx = (int32_t)((child_ptr_bin - out->header_size) / out->entry_size);
-            out->entries[i].child_first_idx = idx;
-            out->entries[i].child_count = child_count;
+            entries[i].child_first_idx = idx;
+            entries[i].child_count = child_count;
         }
         else {
-            out->entries[i].child_first_idx = -1;
-            out->entries[i].child_count = 0;
+            entries[i].child_first_idx = -1;
+            entries[i].child_count = 0;
         }
 
+        /* The size byte at e[7] counts the NUL; measure instead so a bad one cannot overrun. */
         if (name_off) {
-            out->entries[i].name = (const char*)(pool + name_off);
+            if (name_off >= out->size) return -1;
+            const uint8_t* nul = memchr(p + name_off, '\0', out->size - name_off);
+            if (!nul || nul - (p + name_off) > 0xFFFF) return -1;
+            entries[i].name_off = name_off;
+            entries[i].name_len = (uint16_t)(nul - (p + name_off));
         }
-        else {
-            out->entries[i].name = NULL;
+    }
+    for (uint16_t i = 0; i < out->entry_count; ++i) {
+        const bej_dict_entry_t* e = &out->entries[i];
+        if (e->child_first_idx >= 0 && (uint32_t)e->child_first_idx + e->child_count > out->entry_count) return -1;
+    }
+    size_t budget = opts && opts->seq_index_budget ? opts->seq_index_budget : DICT_SEQ_INDEX_BUDGET_DEFAULT;
+    if (opts && opts->no_seq_tables) budget = 0;
+    if (dict_build_seq_index(out, budget) != 0) return -1;
+    return dict_build_keys(out);
+}
+
+static uint32_t seq_hash(uint16_t seq, uint32_t span) {
+    return (((uint32_t)seq * 2654435761u) >> 15) & (span - 1);
+}
+
+static uint32_t hash_span_for(uint16_t count) {
+    uint32_t span = 16;
+    while (span < (uint32_t)count * 2) span <<= 1;
+    return span;
+}
+
+typedef struct {
+    uint16_t parent;
+    uint16_t count;
+} index_candidate_t;
+
+static int cmp_candidates(const void* a, const void* b) {
+    const index_candidate_t* x = (const index_candidate_t*)a;
+    const index_candidate_t* y = (const index_candidate_t*)b;
+    if (x->count != y->count) return x->count > y->count ? -1 : 1;
+    return x->parent < y->parent ? -1 : x->parent > y->parent;
+}
+
+/* Picks, per parent, the cheapest O(1) form of seq lookup:
+ *  RANGE  when children are numbered base, base+1, ... (no memory),
+ *  DIRECT when the seq span is at most the size of a hash table,
+ *  HASH   otherwise.
+ * Table space is granted to the widest sets first until the budget runs out;
+ * the rest keep the linear scan. */
+int dict_build_seq_index(bej_dictionary_t* d, size_t budget) {
+    if (d->tables_borrowed) return -1;
+    free((void*)d->seq_index); free((void*)d->seq_pool);
+    d->seq_index = NULL; d->seq_pool = NULL; d->seq_pool_len = 0;
+    if (d->entry_count == 0) return 0;
+
+    bej_seq_index_t* index = (bej_seq_index_t*)calloc(d->entry_count, sizeof(bej_seq_index_t));
+    index_candidate_t* cand = (index_candidate_t*)malloc(d->entry_count * sizeof(index_candidate_t));
+    d->seq_index = index;
+    if (!index || !cand) { free(cand); return -1; }
+
+    size_t ncand = 0;
+    for (uint16_t i = 0; i < d->entry_count; ++i) {
+        const bej_dict_entry_t* e = &d->entries[i];
+        if (e->child_first_idx < 0 || e->child_count == 0) continue;
+        const bej_dict_entry_t* kids = &d->entries[e->child_first_idx];
+        uint16_t base = kids[0].seq;
+        int ranged = 1;
+        for (uint16_t k = 1; k < e->child_count && ranged; ++k) {
+            ranged = kids[k].seq == (uint16_t)(base + k);
+        }
+        if (ranged) {
+            index[i].kind = BEJ_SEQ_IDX_RANGE;
+            index[i].off = base;
+            index[i].span = e->child_count;
+        }
+        else if (e->child_count >= DICT_INDEX_MIN_CHILDREN) {
+            cand[ncand].parent = i;
+            cand[ncand].count = e->child_count;
+            ncand++;
+        }
+    }
+    qsort(cand, ncand, sizeof(*cand), cmp_candidates);
+
+    size_t pool_len = 0;
+    for (size_t c = 0; c < ncand; ++c) {
+        const bej_dict_entry_t* e = &d->entries[cand[c].parent];
+        const bej_dict_entry_t* kids = &d->entries[e->child_first_idx];
+        uint32_t max_seq = 0;
+        for (uint16_t k = 0; k < e->child_count; ++k) if (kids[k].seq > max_seq) max_seq = kids[k].seq;
+        uint32_t hspan = hash_span_for(e->child_count);
+        bej_seq_index_t* ix = &index[cand[c].parent];
+        if (max_seq + 1 <= hspan) { ix->kind = BEJ_SEQ_IDX_DIRECT; ix->span = max_seq + 1; }
+        else { ix->kind = BEJ_SEQ_IDX_HASH; ix->span = hspan; }
+        if ((pool_len + ix->span) * sizeof(uint16_t) > budget) { ix->kind = BEJ_SEQ_IDX_NONE; ix->span = 0; continue; }
+        ix->off = (uint32_t)pool_len;
+        pool_len += ix->span;
+    }
+
+    uint16_t* pool = NULL;
+    if (pool_len) {
+        pool = (uint16_t*)calloc(pool_len, sizeof(uint16_t));
+        if (!pool) { free(cand); return -1; }
+        d->seq_pool = pool;
+        d->seq_pool_len = pool_len;
+    }
+    for (size_t c = 0; c < ncand; ++c) {
+        const bej_seq_index_t* ix = &d->seq_index[cand[c].parent];
+        if (ix->kind == BEJ_SEQ_IDX_NONE) continue;
+        const bej_dict_entry_t* e = &d->entries[cand[c].parent];
+        const bej_dict_entry_t* kids = &d->entries[e->child_first_idx];
+        uint16_t* tab = pool + ix->off;
+        for (uint16_t k = 0; k < e->child_count; ++k) {
+            uint16_t seq = kids[k].seq;
+            if (ix->kind == BEJ_SEQ_IDX_DIRECT) {
+                if (!tab[seq]) tab[seq] = (uint16_t)(k + 1);
+            }
+            else {
+                uint32_t h = seq_hash(seq, ix->span);
+                while (tab[h] && kids[tab[h] - 1].seq != seq) h = (h + 1) & (ix->span - 1);
+                if (!tab[h]) tab[h] = (uint16_t)(k + 1);
+            }
         }
     }
+    free(cand);
     return 0;
 }
 
+/* Each named entry's JSON key, "name": with the name escaped, back to back in
+ * entry order, so a set's keys sit together; one block holds the offsets and
+ * then the text. */
+int dict_build_keys(bej_dictionary_t* d) {
+    if (d->tables_borrowed) return -1;
+    free((void*)d->key_off);
+    d->key_off = NULL; d->keys = NULL;
+    bej_sink_t text;
+    if (bej_sink_init_mem(&text, 4096) != 0) return -1;
+    size_t offs_size = ((size_t)d->entry_count + 1) * sizeof(uint32_t);
+    uint32_t* offs = (uint32_t*)malloc(offs_size);
+    for (uint16_t i = 0; offs && i < d->entry_count; ++i) {
+        const bej_dict_entry_t* e = &d->entries[i];
+        offs[i] = (uint32_t)text.len;
+        if (!e->name_off) continue;
+        bej_sink_putc(&text, '"');
+        json_escape_run(&text, dict_entry_name(d, e), e->name_len);
+        bej_sink_write(&text, "\": ", 3);
+        if (text.len > UINT32_MAX) text.error = 1;
+    }
+    uint8_t* block = offs && !text.error ? (uint8_t*)malloc(offs_size + text.len) : NULL;
+    if (block) {
+        offs[d->entry_count] = (uint32_t)text.len;
+        memcpy(block, offs, offs_size);
+        memcpy(block + offs_size, text.buf, text.len);
+        d->key_off = (const uint32_t*)block;
+        d->keys = (const char*)block + offs_size;
+    }
+    free(offs);
+    bej_sink_free(&text);
+    return block ? 0 : -1;
+}
+
 void dict_free(bej_dictionary_t* d) {
     if (!d) return;
-    free(d->entries);
-    free(d->bytes);
+    if (!d->tables_borrowed) {
+        free((void*)d->key_off);
+        free((void*)d->seq_index);
+        free((void*)d->seq_pool);
+        free((void*)d->entries);
+    }
+    if (!d->bytes_borrowed) unmap_file_all(d->bytes, d->size, d->bytes_mapped);
     memset(d, 0, sizeof(*d));
 }
 
+static dict_subset_t subset_of(const bej_dictionary_t* d, int idx) {
+    const bej_dict_entry_t* e = &d->entries[idx];
+    if (e->child_first_idx >= 0 && e->child_count) {
+        return (dict_subset_t) {
+            .list = &d->entries[e->child_first_idx], .count = e->child_count,
+            .idx = d->seq_index ? &d->seq_index[idx] : NULL, .pool = d->seq_pool
+        };
+    }
+    return (dict_subset_t) { .list = NULL, .count = 0 };
+}
+
 dict_subset_t dict_children(const bej_dictionary_t* d, int parent_idx) {
     if (parent_idx < 0) {
         if (d->entry_count == 0) return (dict_subset_t) { 0 };
-        const bej_dict_entry_t* root = &d->entries[0];
-        if (root->child_first_idx >= 0 && root->child_count) {
-            return (dict_subset_t) { .list = &d->entries[root->child_first_idx], .count = root->child_count };
-        }
-        return (dict_subset_t) { .list = NULL, .count = 0 };
-    }
-    const bej_dict_entry_t* e = &d->entries[parent_idx];
-    if (e->child_first_idx >= 0 && e->child_count) {
-        return (dict_subset_t) { .list = &d->entries[e->child_first_idx], .count = e->child_count };
+        return subset_of(d, 0);
     }
-    return (dict_subset_t) { .list = NULL, .count = 0 };
+    return subset_of(d, parent_idx);
 }
 
 const bej_dict_entry_t* dict_child_by_seq(const dict_subset_t* sub, uint16_t seq) {
     if (!sub || !sub->list) return NULL;
+    const bej_seq_index_t* ix = sub->idx;
+    if (ix) {
+        switch (ix->kind) {
+        case BEJ_SEQ_IDX_RANGE: {
+            uint32_t k = (uint16_t)(seq - ix->off);
+            return k < sub->count ? &sub->list[k] : NULL;
+        }
+        case BEJ_SEQ_IDX_DIRECT: {
+            if (seq >= ix->span) return NULL;
+            uint16_t k = sub->pool[ix->off + seq];
+            return k ? &sub->list[k - 1] : NULL;
+        }
+        case BEJ_SEQ_IDX_HASH: {
+            const uint16_t* tab = sub->pool + ix->off;
+            for (uint32_t h = seq_hash(seq, ix->span); tab[h]; h = (h + 1) & (ix->span - 1)) {
+                if (sub->list[tab[h] - 1].seq == seq) return &sub->list[tab[h] - 1];
+            }
+            return NULL;
+        }
+        default:
+            break;
+        }
+    }
     for (uint16_t i = 0; i < sub->count; ++i) {
         if (sub->list[i].seq == seq) return &sub->list[i];
     }
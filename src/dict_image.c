@@ -0,0 +1,219 @@
+#include "dict.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Compiled dictionary image. Every section is stored in the exact in-memory
+ * layout the decoder uses, so loading is a validation pass plus pointer
+ * assignment:
+ *
+ *   header | entries[entry_count] | seq_index[entry_count] | seq_pool[pool_len] | names
+ *          | key_off[entry_count + 1] keys
+ *
+ * The keys section is the block dict_build_keys() makes for raw dictionaries;
+ * it is absent (keys_off 0) when the source dictionary had no keys.
+ * All offsets are relative to the start of the image and 8-byte aligned.
+ * Images are host-endian; a mismatching endian marker is rejected. */
+
+#define DICT_IMAGE_MAGIC   "BEJDICTC"
+#define DICT_IMAGE_VERSION 2u
+#define DICT_IMAGE_ENDIAN  0x01020304u
+
+typedef struct {
+    char     magic[8];
+    uint64_t checksum;          /* image_checksum() of everything after the header */
+    uint32_t version;
+    uint32_t endian;
+    uint32_t header_size;
+    uint32_t total_size;
+    uint16_t entry_count;
+    uint8_t  version_tag;
+    uint8_t  dict_flags;
+    uint32_t schema_version;
+    uint32_t dict_size;
+    uint32_t entries_off;
+    uint32_t index_off;
+    uint32_t pool_off;
+    uint32_t pool_len;
+    uint32_t names_off;
+    uint32_t names_size;
+    uint32_t keys_off;          /* key_off table, then keys_size bytes of key text */
+    uint32_t keys_size;
+    uint32_t entry_struct_size;
+    uint32_t index_struct_size;
+} dict_image_header_t;
+
+/* Word-at-a-time multiply/xorshift hash. Each step is a bijection of the
+ * state, so any single changed word changes the result; cheap enough to
+ * verify on every load. */
+static uint64_t image_checksum(const uint8_t* p, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ (uint64_t)n;
+    uint64_t w;
+    for (; n >= 8; p += 8, n -= 8) {
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0x100000001B3ull;
+        h ^= h >> 29;
+    }
+    w = 0;
+    memcpy(&w, p, n);
+    h = (h ^ w) * 0x100000001B3ull;
+    return h ^ (h >> 29);
+}
+
+uint64_t dict_content_hash(const uint8_t* data, size_t size) {
+    uint64_t h = image_checksum(data, size);
+    return h ? h : 1;
+}
+
+static size_t align8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+int dict_image_is(const uint8_t* data, size_t size) {
+    return size >= 8 && memcmp(data, DICT_IMAGE_MAGIC, 8) == 0;
+}
+
+static int section_ok(const dict_image_header_t* h, uint32_t off, size_t len) {
+    return off >= h->header_size && (off & 7) == 0 && off <= h->total_size && len <= h->total_size - off;
+}
+
+int dict_image_attach(bej_dictionary_t* d) {
+    if (d->size < sizeof(dict_image_header_t)) return -1;
+    dict_image_header_t h;
+    memcpy(&h, d->bytes, sizeof(h));
+    if (!dict_image_is(d->bytes, d->size)) return -1;
+    if (h.version != DICT_IMAGE_VERSION || h.endian != DICT_IMAGE_ENDIAN) return -1;
+    if (h.header_size != sizeof(dict_image_header_t) || h.total_size != d->size) return -1;
+    if (h.entry_struct_size != sizeof(bej_dict_entry_t) || h.index_struct_size != sizeof(bej_seq_index_t)) return -1;
+    if (image_checksum(d->bytes + h.header_size, d->size - h.header_size) != h.checksum) return -1;
+
+    if (!section_ok(&h, h.entries_off, (size_t)h.entry_count * sizeof(bej_dict_entry_t))) return -1;
+    if (!section_ok(&h, h.index_off, (size_t)h.entry_count * sizeof(bej_seq_index_t))) return -1;
+    if (!section_ok(&h, h.pool_off, (size_t)h.pool_len * sizeof(uint16_t))) return -1;
+    if (!section_ok(&h, h.names_off, h.names_size) || h.names_size == 0) return -1;
+
+    const bej_dict_entry_t* entries = (const bej_dict_entry_t*)(const void*)(d->bytes + h.entries_off);
+    const bej_seq_index_t* index = (const bej_seq_index_t*)(const void*)(d->bytes + h.index_off);
+    const char* names = (const char*)d->bytes + h.names_off;
+    if (names[h.names_size - 1] != '\0') return -1;
+
+    const uint32_t* key_off = NULL;
+    if (h.keys_off) {
+        size_t offs_size = ((size_t)h.entry_count + 1) * sizeof(uint32_t);
+        if (!section_ok(&h, h.keys_off, offs_size + h.keys_size)) return -1;
+        key_off = (const uint32_t*)(const void*)(d->bytes + h.keys_off);
+        if (key_off[0] != 0 || key_off[h.entry_count] != h.keys_size) return -1;
+        for (uint32_t i = 0; i < h.entry_count; ++i) {
+            if (key_off[i] > key_off[i + 1]) return -1;
+        }
+    }
+
+    /* Read-only sanity pass so a well-checksummed but hostile image cannot
+     * send the decoder out of bounds. */
+    for (uint32_t i = 0; i < h.entry_count; ++i) {
+        const bej_dict_entry_t* e = &entries[i];
+        if (e->child_first_idx >= 0 && (uint32_t)e->child_first_idx + e->child_count > h.entry_count) return -1;
+        if (e->name_off && ((uint64_t)e->name_off + e->name_len >= h.names_size || names[e->name_off + e->name_len] != '\0')) return -1;
+        const bej_seq_index_t* ix = &index[i];
+        if (ix->kind == BEJ_SEQ_IDX_DIRECT || ix->kind == BEJ_SEQ_IDX_HASH) {
+            if ((uint64_t)ix->off + ix->span > h.pool_len) return -1;
+            if (ix->kind == BEJ_SEQ_IDX_HASH && (ix->span == 0 || (ix->span & (ix->span - 1)))) return -1;
+        }
+        else if (ix->kind > BEJ_SEQ_IDX_HASH) {
+            return -1;
+        }
+    }
+    const uint16_t* pool = (const uint16_t*)(const void*)(d->bytes + h.pool_off);
+    for (uint32_t i = 0; i < h.entry_count; ++i) {
+        const bej_seq_index_t* ix = &index[i];
+        if (ix->kind != BEJ_SEQ_IDX_DIRECT && ix->kind != BEJ_SEQ_IDX_HASH) continue;
+        uint32_t empty = 0;
+        for (uint32_t k = 0; k < ix->span; ++k) {
+            if (pool[ix->off + k] > entries[i].child_count) return -1;
+            empty += pool[ix->off + k] == 0;
+        }
+        /* A miss probes until it meets an empty slot; a full table has none. */
+        if (ix->kind == BEJ_SEQ_IDX_HASH && empty == 0) return -1;
+    }
+
+    d->version_tag = h.version_tag;
+    d->dict_flags = h.dict_flags;
+    d->entry_count = h.entry_count;
+    d->schema_version = h.schema_version;
+    d->dict_size = h.dict_size;
+    d->identity = h.checksum ? h.checksum : 1;
+    d->header_size = h.header_size;
+    d->entry_size = sizeof(bej_dict_entry_t);
+    d->entries = entries;
+    d->names = names;
+    d->seq_index = index;
+    d->seq_pool = h.pool_len ? pool : NULL;
+    d->seq_pool_len = h.pool_len;
+    d->key_off = key_off;
+    d->keys = key_off ? (const char*)(key_off + h.entry_count + 1) : NULL;
+    d->tables_borrowed = 1;
+    return 0;
+}
+
+int dict_image_build(const bej_dictionary_t* d, uint8_t** out_image, size_t* out_size) {
+    *out_image = NULL; *out_size = 0;
+
+    size_t names_size = 1;
+    for (uint16_t i = 0; i < d->entry_count; ++i) {
+        if (d->entries[i].name_off) names_size += (size_t)d->entries[i].name_len + 1;
+    }
+
+    dict_image_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DICT_IMAGE_MAGIC, 8);
+    h.version = DICT_IMAGE_VERSION;
+    h.endian = DICT_IMAGE_ENDIAN;
+    h.header_size = sizeof(h);
+    h.entry_count = d->entry_count;
+    h.version_tag = d->version_tag;
+    h.dict_flags = d->dict_flags;
+    h.schema_version = d->schema_version;
+    h.dict_size = d->dict_size;
+    h.entry_struct_size = sizeof(bej_dict_entry_t);
+    h.index_struct_size = sizeof(bej_seq_index_t);
+    h.pool_len = (uint32_t)d->seq_pool_len;
+    h.names_size = (uint32_t)names_size;
+    size_t offs_size = ((size_t)d->entry_count + 1) * sizeof(uint32_t);
+    h.keys_size = d->key_off ? d->key_off[d->entry_count] : 0;
+
+    size_t off = align8(sizeof(h));
+    h.entries_off = (uint32_t)off; off = align8(off + (size_t)d->entry_count * sizeof(bej_dict_entry_t));
+    h.index_off = (uint32_t)off;   off = align8(off + (size_t)d->entry_count * sizeof(bej_seq_index_t));
+    h.pool_off = (uint32_t)off;    off = align8(off + d->seq_pool_len * sizeof(uint16_t));
+    h.names_off = (uint32_t)off;   off = align8(off + names_size);
+    if (d->key_off) { h.keys_off = (uint32_t)off; off += offs_size + h.keys_size; }
+    if (off > UINT32_MAX) return -1;
+    h.total_size = (uint32_t)off;
+
+    uint8_t* img = (uint8_t*)calloc(1, off);
+    if (!img) return -1;
+
+    bej_dict_entry_t* entries = (bej_dict_entry_t*)(void*)(img + h.entries_off);
+    bej_seq_index_t* index = (bej_seq_index_t*)(void*)(img + h.index_off);
+    char* names = (char*)img + h.names_off;
+    uint32_t name_pos = 1;
+    for (uint16_t i = 0; i < d->entry_count; ++i) {
+        bej_dict_entry_t e = d->entries[i];
+        if (e.name_off) {
+            memcpy(names + name_pos, dict_entry_name(d, &d->entries[i]), e.name_len);
+            e.name_off = name_pos;
+            name_pos += (uint32_t)e.name_len + 1;
+        }
+        entries[i] = e;
+        if (d->seq_index) index[i] = d->seq_index[i];
+    }
+    if (d->seq_pool_len) memcpy(img + h.pool_off, d->seq_pool, d->seq_pool_len * sizeof(uint16_t));
+    if (d->key_off) {
+        memcpy(img + h.keys_off, d->key_off, offs_size);
+        memcpy(img + h.keys_off + offs_size, d->keys, h.keys_size);
+    }
+
+    h.checksum = image_checksum(img + h.header_size, off - h.header_size);
+    memcpy(img, &h, sizeof(h));
+    *out_image = img;
+    *out_size = off;
+    return 0;
+}
@@ -1,12 +1,48 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include "io.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Reads until EOF; for pipes and other streams whose size is unknown. */
+static int read_stream_all(FILE* f, uint8_t** out_data, size_t* out_size) {
+    size_t cap = 64 * 1024, len = 0;
+    uint8_t* buf = (uint8_t*)malloc(cap);
+    if (!buf) return -1;
+    for (;;) {
+        if (len == cap) {
+            uint8_t* nb = (uint8_t*)realloc(buf, cap * 2);
+            if (!nb) { free(buf); return -1; }
+            buf = nb; cap *= 2;
+        }
+        size_t n = fread(buf + len, 1, cap - len, f);
+        len += n;
+        if (n == 0) break;
+    }
+    if (ferror(f)) { free(buf); return -1; }
+    *out_data = buf;
+    *out_size = len;
+    return 0;
+}
 
 int read_file_all(const char* path, uint8_t** out_data, size_t* out_size) {
     *out_data = NULL; *out_size = 0;
+    if (!strcmp(path, "-")) return read_stream_all(stdin, out_data, out_size);
     FILE* f = fopen(path, "rb");
     if (!f) return -1;
-    if (fseek(f, 0, SEEK_END) != 0) { fclose(f); return -1; }
+    if (fseek(f, 0, SEEK_END) != 0) {
+        int rc = read_stream_all(f, out_data, out_size);
+        fclose(f);
+        return rc;
+    }
     long sz = ftell(f);
     if (sz < 0) { fclose(f); return -1; }
     rewind(f);
@@ -20,6 +56,43 @@ int read_file_all(const char* path, uint8_t** out_data, size_t* out_size) {
     return 0;
 }
 
+int map_file_all(const char* path, const uint8_t** out_data, size_t* out_size, int* out_mapped) {
+    *out_data = NULL; *out_size = 0; *out_mapped = 0;
+#if !defined(_WIN32)
+    if (strcmp(path, "-") != 0) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return -1;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (p != MAP_FAILED) {
+                *out_data = (const uint8_t*)p;
+                *out_size = (size_t)st.st_size;
+                *out_mapped = 1;
+                return 0;
+            }
+        }
+        else {
+            close(fd);
+        }
+    }
+#endif
+    uint8_t* buf = NULL;
+    if (read_file_all(path, &buf, out_size) != 0) return -1;
+    *out_data = buf;
+    return 0;
+}
+
+void unmap_file_all(const uint8_t* data, size_t size, int mapped) {
+    if (!data) return;
+#if !defined(_WIN32)
+    if (mapped) { munmap((void*)data, size); return; }
+#endif
+    (void)size; (void)mapped;
+    free((void*)data);
+}
+
 int write_file_all(const char* path, const char* data, size_t size) {
     FILE* f = fopen(path, "wb");
     if (!f) return -1;
@@ -0,0 +1,140 @@
+#include "json_escape.h"
+#include "bej_thread.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define JSON_ESCAPE_X86 1
+#include <immintrin.h>
+#endif
+
+typedef size_t (*scan_fn)(const char* s, size_t n);
+
+static inline int needs_escape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+static size_t scan_bytes(const char* s, size_t i, size_t n) {
+    while (i < n && !needs_escape((unsigned char)s[i])) ++i;
+    return i;
+}
+
+#define ONES  UINT64_C(0x0101010101010101)
+#define HIGHS UINT64_C(0x8080808080808080)
+
+/* SWAR: a word is clean when no byte is < 0x20, '"' or '\\'. Only the
+ * yes/no answer is used, so the test does not depend on byte order. */
+static size_t scan_scalar(const char* s, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, s + i, sizeof(w));
+        uint64_t q = w ^ (ONES * '"'), b = w ^ (ONES * '\\');
+        if (((w - ONES * 0x20) & ~w & HIGHS) | ((q - ONES) & ~q & HIGHS) | ((b - ONES) & ~b & HIGHS))
+            break;
+    }
+    return scan_bytes(s, i, n);
+}
+
+#ifdef JSON_ESCAPE_X86
+static size_t scan_sse2(const char* s, size_t n) {
+    const __m128i quote = _mm_set1_epi8('"'), bslash = _mm_set1_epi8('\\'), ctl = _mm_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(const void*)(s + i));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v));   /* v <= 0x1F */
+        int mask = _mm_movemask_epi8(m);
+        if (mask) return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+    return i + scan_scalar(s + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_avx2(const char* s, size_t n) {
+    const __m256i quote = _mm256_set1_epi8('"'), bslash = _mm256_set1_epi8('\\'), ctl = _mm256_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(const void*)(s + i));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, bslash));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(m);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + scan_sse2(s + i, n - i);
+}
+#endif
+
+/* Picked once, on first use, unless json_escape_select pinned one before. */
+static scan_fn scan_impl = scan_scalar;
+static int scan_kind = JSON_ESCAPE_AUTO;
+static bej_once_t scan_once = BEJ_ONCE_INIT;
+
+int json_escape_select(int impl) {
+    if (impl == JSON_ESCAPE_AUTO) {
+#ifdef JSON_ESCAPE_X86
+        __builtin_cpu_init();
+        impl = __builtin_cpu_supports("avx2") ? JSON_ESCAPE_AVX2 : JSON_ESCAPE_SSE2;
+#else
+        impl = JSON_ESCAPE_SCALAR;
+#endif
+    }
+    switch (impl) {
+    case JSON_ESCAPE_SCALAR: scan_impl = scan_scalar; break;
+#ifdef JSON_ESCAPE_X86
+    case JSON_ESCAPE_SSE2: scan_impl = scan_sse2; break;
+    case JSON_ESCAPE_AVX2:
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("avx2")) return -1;
+        scan_impl = scan_avx2;
+        break;
+#endif
+    default: return -1;
+    }
+    scan_kind = impl;
+    return 0;
+}
+
+static void scan_pick(void) {
+    if (scan_kind == JSON_ESCAPE_AUTO) json_escape_select(JSON_ESCAPE_AUTO);
+}
+
+const char* json_escape_impl(void) {
+    bej_once(&scan_once, scan_pick);
+    switch (scan_kind) {
+    case JSON_ESCAPE_SSE2: return "sse2";
+    case JSON_ESCAPE_AVX2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+size_t json_escape_scan(const char* s, size_t n) {
+    bej_once(&scan_once, scan_pick);
+    return scan_impl(s, n);
+}
+
+void json_escape_run(bej_sink_t* out, const char* s, size_t n) {
+    static const char hex[] = "0123456789abcdef";
+    size_t i = 0;
+    bej_once(&scan_once, scan_pick);
+    for (;;) {
+        size_t k = scan_impl(s + i, n - i);
+        if (k) bej_sink_write(out, s + i, k);
+        i += k;
+        if (i >= n) return;
+        unsigned char c = (unsigned char)s[i++];
+        switch (c) {
+        case '\"': bej_sink_write(out, "\\\"", 2); break;
+        case '\\': bej_sink_write(out, "\\\\", 2); break;
+        case '\b': bej_sink_write(out, "\\b", 2); break;
+        case '\f': bej_sink_write(out, "\\f", 2); break;
+        case '\n': bej_sink_write(out, "\\n", 2); break;
+        case '\r': bej_sink_write(out, "\\r", 2); break;
+        case '\t': bej_sink_write(out, "\\t", 2); break;
+        default: {
+            char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F] };
+            bej_sink_write(out, u, sizeof(u));
+        }
+        }
+    }
+}
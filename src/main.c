@@ -1,62 +1,408 @@
 /** @file main.c
  *  @brief CLI: bej2json -s <schema.bin> -b <payload.bej> -o <out.json>
+ *         or  bej2json -s <schema.bin> -B <list.txt|dir> -o <out_dir> [-j N] [-Q N]
+ *         or  bej2json -S <bundle.bejb> -d <schema> ...
+ *         or  bej2json -s <schema.bin> -b <payload.bej> -V
+ *         or  bej2json (-s <schema.bin> | -S <bundle.bejb>) -L <socket> [-j N]
+ *  -p <json-pointer> (repeatable) limits the output to the given properties.
+ *  -f cbor|msgpack writes a single payload as CBOR or MessagePack instead of JSON.
+ *  -D <prev.bej> writes the JSON merge patch from <prev.bej> to the -b payload.
+ *  -C <MiB> caches the JSON of repeated payloads in batch and daemon mode.
+ *  -Q <N> runs batch mode as a read/decode/write pipeline with N payloads in flight.
+ *  --stats prints decode counters and timings as JSON on stdout.
  */
 
+#ifdef BEJ_BATCH
+#include "batch.h"
+#endif
+#include "bej_binary.h"
+#include "bej_cache.h"
+#include "bej_delta.h"
+#include "bej_project.h"
+#include "bej_push.h"
+#include "bej_stats.h"
+#ifdef BEJ_DAEMON
+#include "daemon.h"
+#endif
 #include "dict.h"
 #include "io.h"
+#include "registry.h"
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/** Feeds stdin to the push decoder chunk by chunk, so memory stays bounded
+ *  however large the piped payload is. */
+static int decode_stdin(FILE* out, const bej_dictionary_t* major) {
+    static uint8_t chunk[64 * 1024];
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    if (bej_sink_init_file(&sink, out, buf, sizeof(buf)) != 0) return -1;
+    bej_push_t* p = bej_push_new(major, &sink, 0);
+    if (!p) { bej_sink_free(&sink); return -1; }
+
+    int rc = BEJ_PUSH_NEED_MORE;
+    size_t n;
+    while (rc == BEJ_PUSH_NEED_MORE && (n = fread(chunk, 1, sizeof(chunk), stdin)) > 0)
+        rc = bej_push_feed(p, chunk, n);
+    if (rc >= 0) rc = ferror(stdin) ? -1 : bej_push_finish(p);
+    if (rc != 0) fprintf(stderr, "Payload error at offset %zu\n", bej_push_offset(p));
+
+    bej_push_free(p);
+    if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+    bej_sink_free(&sink);
+    return rc;
+}
+
+/** Decodes a whole payload into @p out, limited to @p proj when it is not NULL;
+ *  otherwise large arrays and sets are split across @p threads when it is above 1.
+ *  Counts into @p stats unless it is NULL. */
+static int decode_file(FILE* out, const uint8_t* bej, size_t bej_sz,
+    const bej_dictionary_t* major, const bej_projection_t* proj, int threads, bej_stats_t* stats) {
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    if (bej_sink_init_file(&sink, out, buf, sizeof(buf)) != 0) return -1;
+    int rc;
+    if (!proj && threads > 1) rc = bej_decode_parallel(&sink, bej, bej_sz, major, threads, stats);
+    else {
+        bej_decoder_t dec;
+        bej_decoder_init(&dec, major, &sink);
+        dec.proj = proj;
+        dec.stats = stats;
+        rc = bej_decoder_run(&dec, bej, bej_sz);
+    }
+    if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+    bej_sink_free(&sink);
+    return rc;
+}
+
+enum { OUT_JSON, OUT_CBOR, OUT_MSGPACK };
+
+/** Writes a whole payload into @p out as CBOR or MessagePack, limited to @p proj when it is not NULL. */
+static int decode_binary(FILE* out, int format, const uint8_t* bej, size_t bej_sz,
+    const bej_dictionary_t* major, const bej_projection_t* proj) {
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    if (bej_sink_init_file(&sink, out, buf, sizeof(buf)) != 0) return -1;
+    int rc = format == OUT_CBOR ? bej_decode_to_cbor(&sink, bej, bej_sz, major, proj)
+        : bej_decode_to_msgpack(&sink, bej, bej_sz, major, proj);
+    if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+    bej_sink_free(&sink);
+    return rc;
+}
+
+/** Writes the merge patch from @p prev to @p bej into @p out. */
+static int decode_delta(FILE* out, const uint8_t* prev, size_t prev_sz, const uint8_t* bej, size_t bej_sz,
+    const bej_dictionary_t* major) {
+    char buf[16 * 1024];
+    bej_sink_t sink;
+    if (bej_sink_init_file(&sink, out, buf, sizeof(buf)) != 0) return -1;
+    int rc = bej_decode_delta(&sink, prev, prev_sz, bej, bej_sz, major);
+    if (bej_sink_finish(&sink) != 0 && rc == 0) rc = -1;
+    bej_sink_free(&sink);
+    return rc;
+}
+
+/** Resolves the -p pointers; prints the one that fails. */
+static bej_projection_t* load_projection(const bej_dictionary_t* major, const char* const* paths, size_t n) {
+    bej_projection_t* proj = NULL;
+    size_t bad = 0;
+    int rc = bej_projection_new(major, paths, n, &proj, &bad);
+    if (rc == -2) fprintf(stderr, "Path not in dictionary: %s\n", paths[bad]);
+    else if (rc != 0) fprintf(stderr, "Out of memory\n");
+    return proj;
+}
+
+/** Prints the -C cache counters on stderr. */
+static void print_cache_stats(bej_cache_t* cache) {
+    bej_cache_stats_t st;
+    bej_cache_stats(cache, &st);
+    fprintf(stderr, "Cache: %zu hits, %zu misses, %zu entries (%zu KiB), %zu evictions\n",
+        st.hits, st.misses, st.entries, st.bytes / 1024, st.evictions);
+}
+
+#ifdef BEJ_DAEMON
+static bejd_server_t* running;
+
+static void on_signal(int sig) {
+    (void)sig;
+    if (running) bejd_server_stop(running);
+}
+
+/** Daemon mode: serves decode requests on @p socket_path until SIGINT/SIGTERM. */
+static int serve(const char* socket_path, const bej_dictionary_t* dict, dict_registry_t* registry,
+    const char* schema, int threads, bej_cache_t* cache) {
+    bejd_opts_t opts = { .socket_path = socket_path, .dict = registry ? NULL : dict,
+        .registry = registry, .schema = schema, .threads = threads, .cache = cache };
+    if (bejd_server_open(&opts, &running) != 0) {
+        fprintf(stderr, "Cannot listen on %s\n", socket_path);
+        return -1;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    int rc = bejd_server_run(running);
+    bejd_server_close(running);
+    running = NULL;
+    return rc;
+}
+#endif
+
 static void usage(const char* prog) {
     fprintf(stderr,
         "Usage:\n"
-        "  %s -s <schema_dict.bin> -b <payload.bej> -o <out.json>\n"
+        "  %s -s <schema_dict.bin> -b <payload.bej> -o <out.json> [-p <pointer>]...\n"
+        "  %s -s <schema_dict.bin> -B <list.txt|dir> -o <out_dir> [-j N] [-Q N] [-p <pointer>]...\n"
+        "  %s -S <bundle.bejb> -d <schema[:version]> (-b <payload.bej> | -B <list.txt|dir>) -o <out>\n"
+        "  %s (-s <schema_dict.bin> | -S <bundle.bejb> -d <schema>) -b <payload.bej> -V\n"
+        "  %s (-s <schema_dict.bin> | -S <bundle.bejb> [-d <schema>]) -L <socket> [-j N]\n"
         "Options:\n"
-        "  -s   Path to major schema binary dictionary (.bin)\n"
-        "  -b   Path to BEJ-encoded payload\n"
-        "  -o   Output JSON file (UTF-8)\n"
+        "  -s   Path to major schema binary dictionary (.bin or compiled .bejdc)\n"
+        "  -S   Dictionary bundle built by bej_bundle; pick the schema with -d\n"
+        "  -d   Schema name, optionally with a hex schema version (Processor:f120f100)\n"
+        "  -M   Bundle memory cap in KiB for loaded dictionaries (default: unlimited)\n"
+        "  -b   Path to BEJ-encoded payload (\"-\" reads stdin)\n"
+        "  -B   Batch mode: directory of *.bej files or a file with one payload path per line;\n"
+        "       with -S a line may be \"path<TAB>schema\" to override -d\n"
+        "  -o   Output JSON file (UTF-8); output directory in batch mode\n"
+        "  -f   Output format with -b <file>: json (default), cbor or msgpack\n"
+        "  -C   Cache the JSON of byte-identical payloads, up to N MiB, in batch and\n"
+        "       daemon mode (not with -p); counters go to stderr at the end\n"
+        "  -D   Previous payload of the same resource: with -b <file>, write only what\n"
+        "       changed since it, as a JSON merge patch (RFC 7396)\n"
+        "  -Q   Batch mode as a pipeline: read ahead, decode on -j workers and write in\n"
+        "       list order, with at most N payloads in flight (0: four per worker)\n"
+        "  -j   Batch or daemon worker threads (default: one per core); with -b <file>,\n"
+        "       split large arrays and sets of the payload across N threads (default: 1)\n"
+        "  -V   Validate only: check the payload against the dictionary, write nothing\n"
+        "  -p   Output only this property, as a JSON pointer (/MemoryLocation/Channel);\n"
+        "       repeat for more. Not with -b - or with -S in batch mode\n"
+        "  -L   Daemon mode: decode requests from bej_client on this Unix socket;\n"
+        "       with -S each request names its schema, -d is the default\n"
+        "  --stats  Print decode counters and dict_load/read/decode times as JSON\n"
+        "       on stdout (-b <file> only)\n"
         "Notes:\n"
-        "  * Annotation dictionary is ignored in this simplified build.\n", prog);
+        "  * Annotation dictionary is ignored in this simplified build.\n", prog, prog, prog, prog, prog);
 }
 
 int main(int argc, char** argv) {
     const char* dict_path = NULL;
+    const char* bundle_path = NULL;
+    const char* schema = NULL;
     const char* bej_path = NULL;
+    const char* batch_path = NULL;
     const char* out_path = NULL;
+    const char* listen_path = NULL;
+    const char* prev_path = NULL;
+    size_t bundle_budget = 0;
+    size_t cache_budget = 0;
+    int pipeline = 0;
+    size_t pipe_depth = 0;
+    int threads = 0;
+    int validate = 0;
+    int want_stats = 0;
+    int format = OUT_JSON;
+    const char** paths = (const char**)calloc((size_t)argc, sizeof(*paths));
+    size_t npaths = 0;
+    if (!paths) return 1;
 
     for (int i = 1; i < argc; i++) {
         if (!strcmp(argv[i], "-s") && i + 1 < argc) dict_path = argv[++i];
+        else if (!strcmp(argv[i], "-S") && i + 1 < argc) bundle_path = argv[++i];
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc) schema = argv[++i];
+        else if (!strcmp(argv[i], "-M") && i + 1 < argc) bundle_budget = (size_t)strtoull(argv[++i], NULL, 10) * 1024;
         else if (!strcmp(argv[i], "-b") && i + 1 < argc) bej_path = argv[++i];
+        else if (!strcmp(argv[i], "-B") && i + 1 < argc) batch_path = argv[++i];
         else if (!strcmp(argv[i], "-o") && i + 1 < argc) out_path = argv[++i];
-        else { usage(argv[0]); return 2; }
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-L") && i + 1 < argc) listen_path = argv[++i];
+        else if (!strcmp(argv[i], "-D") && i + 1 < argc) prev_path = argv[++i];
+        else if (!strcmp(argv[i], "-C") && i + 1 < argc) cache_budget = (size_t)strtoull(argv[++i], NULL, 10) * 1024 * 1024;
+        else if (!strcmp(argv[i], "-Q") && i + 1 < argc) {
+            pipeline = 1;
+            pipe_depth = (size_t)strtoull(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "-V")) validate = 1;
+        else if (!strcmp(argv[i], "--stats")) want_stats = 1;
+        else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            const char* f = argv[++i];
+            format = !strcmp(f, "cbor") ? OUT_CBOR : !strcmp(f, "msgpack") ? OUT_MSGPACK : !strcmp(f, "json") ? OUT_JSON : -1;
+        }
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc) paths[npaths++] = argv[++i];
+        else { usage(argv[0]); free(paths); return 2; }
     }
-    if (!dict_path || !bej_path || !out_path) { usage(argv[0]); return 2; }
+    int bad_args = !dict_path == !bundle_path;
+    if (listen_path) bad_args = bad_args || bej_path || batch_path || out_path || validate || npaths;
+    else bad_args = bad_args || !bej_path == !batch_path
+        || (validate ? (batch_path || out_path) : !out_path)
+        || (bundle_path && !schema && !batch_path)
+        /* the push decoder and per-item dictionaries take no projection */
+        || (npaths && (validate || (bej_path && !strcmp(bej_path, "-")) || (bundle_path && batch_path)));
+    /* the validator, the push decoder and batch workers keep no counters */
+    bad_args = bad_args || (want_stats && (listen_path || batch_path || validate || !strcmp(bej_path, "-")));
+    /* binary output is written by the serial decoder, for one payload */
+    bad_args = bad_args || format < 0 || (format != OUT_JSON
+        && (listen_path || batch_path || validate || !strcmp(bej_path, "-") || want_stats || threads > 1));
+    /* the cache serves whole documents to the long-running paths */
+    bad_args = bad_args || (cache_budget && (!(listen_path || batch_path) || npaths));
+    /* the pipeline is a way of running batch mode */
+    bad_args = bad_args || (pipeline && !batch_path);
+    /* a patch covers the whole document, from two payloads in memory */
+    bad_args = bad_args || (prev_path && (listen_path || batch_path || validate || !strcmp(bej_path, "-")
+        || npaths || format != OUT_JSON || want_stats || threads > 1));
+    if (bad_args) { usage(argv[0]); free(paths); return 2; }
+
+    bej_stats_t stats = { 0 };
+    uint64_t t0 = bej_stats_clock_ns();
 
     bej_dictionary_t dict = { 0 };
-    if (dict_load(dict_path, &dict) != 0) {
+    dict_registry_t* registry = NULL;
+    if (bundle_path) {
+        if (dict_registry_open(bundle_path, bundle_budget, &registry) != 0) {
+            fprintf(stderr, "Failed to open dictionary bundle: %s\n", bundle_path);
+            free(paths);
+            return 1;
+        }
+    }
+    else if (dict_load(dict_path, &dict) != 0) {
         fprintf(stderr, "Failed to load dictionary: %s\n", dict_path);
+        free(paths);
         return 1;
     }
 
-    uint8_t* bej = NULL; size_t bej_sz = 0;
-    if (read_file_all(bej_path, &bej, &bej_sz) != 0) {
-        fprintf(stderr, "Failed to read BEJ payload: %s\n", bej_path);
+    bej_cache_t* cache = NULL;
+    if (cache_budget && bej_cache_open(cache_budget, &cache) != 0) {
+        fprintf(stderr, "Out of memory\n");
+        dict_free(&dict); dict_registry_close(registry); free(paths);
+        return 1;
+    }
+
+    if (listen_path) {
+        free(paths);
+#ifdef BEJ_DAEMON
+        int rc = serve(listen_path, &dict, registry, schema, threads, cache);
+#else
+        fprintf(stderr, "Daemon mode needs Unix sockets and is not part of this build\n");
+        int rc = -1;
+#endif
+        if (cache) print_cache_stats(cache);
+        bej_cache_close(cache);
         dict_free(&dict);
+        dict_registry_close(registry);
+        return rc == 0 ? 0 : 1;
+    }
+
+    const bej_dictionary_t* major = &dict;
+    if (registry && !batch_path && !(major = dict_registry_acquire_key(registry, schema))) {
+        fprintf(stderr, "No dictionary for schema %s in %s\n", schema, bundle_path);
+        dict_registry_close(registry);
+        free(paths);
+        return 1;
+    }
+    stats.dict_load_ns = bej_stats_clock_ns() - t0;
+    bej_projection_t* proj = npaths ? load_projection(major, paths, npaths) : NULL;
+    free(paths);
+    if (npaths && !proj) {
+        dict_free(&dict); dict_registry_close(registry);
+        return 1;
+    }
+
+    if (batch_path) {
+#ifdef BEJ_BATCH
+        batch_item_t* items = NULL; size_t count = 0;
+        int crc = batch_collect(batch_path, &items, &count);
+        if (crc != 0) {
+            if (crc == -2) fprintf(stderr, "Payloads in %s share a file name, so their outputs would collide\n", batch_path);
+            else fprintf(stderr, "Failed to list payloads: %s\n", batch_path);
+            bej_cache_close(cache); bej_projection_free(proj); dict_free(&dict); dict_registry_close(registry);
+            return 1;
+        }
+        batch_opts_t opts = { .dict = &dict, .registry = registry, .schema = schema,
+            .out_dir = out_path, .threads = threads, .proj = proj, .cache = cache, .depth = pipe_depth };
+        int failed = pipeline ? batch_pipeline(items, count, &opts) : batch_decode(items, count, &opts);
+        if (cache) print_cache_stats(cache);
+        bej_cache_close(cache);
+        batch_free_items(items, count);
+        bej_projection_free(proj); dict_free(&dict); dict_registry_close(registry);
+        if (failed != 0) {
+            if (failed > 0) fprintf(stderr, "%d of %zu payloads failed\n", failed, count);
+            return 1;
+        }
+        return 0;
+#else
+        (void)pipe_depth;
+        fprintf(stderr, "Batch mode needs POSIX directories and file descriptors and is not part of this build\n");
+        bej_cache_close(cache); bej_projection_free(proj); dict_free(&dict); dict_registry_close(registry);
         return 1;
+#endif
     }
 
+    if (validate) {
+        const uint8_t* bej = NULL; size_t bej_sz = 0; int bej_mapped = 0;
+        int rc = -1;
+        size_t off = 0;
+        if (map_file_all(bej_path, &bej, &bej_sz, &bej_mapped) != 0)
+            fprintf(stderr, "Failed to read BEJ payload: %s\n", bej_path);
+        else {
+            rc = bej_validate(bej, bej_sz, major, &off);
+            if (rc != 0) fprintf(stderr, "Invalid payload (code %d) at offset %zu\n", rc, off);
+            unmap_file_all(bej, bej_sz, bej_mapped);
+        }
+        dict_free(&dict);
+        dict_registry_close(registry);
+        return rc == 0 ? 0 : 1;
+    }
+
+    if (!strcmp(bej_path, "-")) {
+        FILE* out = fopen(out_path, "wb");
+        int rc = out ? decode_stdin(out, major) : -1;
+        if (out) fclose(out);
+        else fprintf(stderr, "Cannot open output: %s\n", out_path);
+        dict_free(&dict);
+        dict_registry_close(registry);
+        if (rc != 0) {
+            if (out) fprintf(stderr, "Decode failed (code %d)\n", rc);
+            return 1;
+        }
+        return 0;
+    }
+
+    const uint8_t* bej = NULL; size_t bej_sz = 0; int bej_mapped = 0;
+    t0 = bej_stats_clock_ns();
+    if (map_file_all(bej_path, &bej, &bej_sz, &bej_mapped) != 0) {
+        fprintf(stderr, "Failed to read BEJ payload: %s\n", bej_path);
+        bej_projection_free(proj); dict_free(&dict); dict_registry_close(registry);
+        return 1;
+    }
+    stats.read_ns = bej_stats_clock_ns() - t0;
+
     FILE* out = fopen(out_path, "wb");
     if (!out) {
         fprintf(stderr, "Cannot open output: %s\n", out_path);
-        free(bej); dict_free(&dict);
+        unmap_file_all(bej, bej_sz, bej_mapped); bej_projection_free(proj); dict_free(&dict); dict_registry_close(registry);
         return 1;
     }
 
-    int rc = bej_decode_to_json(out, bej, bej_sz, &dict);
+    const uint8_t* prev = NULL; size_t prev_sz = 0; int prev_mapped = 0;
+    int rc;
+    if (prev_path) {
+        if (map_file_all(prev_path, &prev, &prev_sz, &prev_mapped) != 0) {
+            fprintf(stderr, "Failed to read BEJ payload: %s\n", prev_path);
+            rc = -1;
+        }
+        else {
+            rc = decode_delta(out, prev, prev_sz, bej, bej_sz, major);
+            unmap_file_all(prev, prev_sz, prev_mapped);
+        }
+    }
+    else if (format != OUT_JSON) rc = decode_binary(out, format, bej, bej_sz, major, proj);
+    else rc = decode_file(out, bej, bej_sz, major, proj, threads, want_stats ? &stats : NULL);
     fclose(out);
-    free(bej);
+    if (want_stats) bej_stats_write_json(stdout, &stats);
+    unmap_file_all(bej, bej_sz, bej_mapped);
+    bej_projection_free(proj);
     dict_free(&dict);
+    dict_registry_close(registry);
 
     if (rc != 0) {
         fprintf(stderr, "Decode failed (code %d)\n", rc);
@@ -0,0 +1,60 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "pool.h"
+#include "bej_thread.h"
+#include <stdlib.h>
+
+typedef struct {
+    bej_mutex_t lock;
+    size_t next;
+    size_t njobs;
+    pool_job_fn fn;
+    void* ctx;
+} pool_state_t;
+
+static void* pool_worker(void* arg) {
+    pool_state_t* st = (pool_state_t*)arg;
+    for (;;) {
+        bej_mutex_lock(&st->lock);
+        size_t idx = st->next++;
+        bej_mutex_unlock(&st->lock);
+        if (idx >= st->njobs) break;
+        st->fn(st->ctx, idx);
+    }
+    return NULL;
+}
+
+int pool_default_threads(void) {
+    return bej_cpu_count();
+}
+
+int pool_run(int threads, size_t njobs, pool_job_fn fn, void* ctx) {
+    if (njobs == 0) return 0;
+    if (threads <= 0) threads = pool_default_threads();
+    if ((size_t)threads > njobs) threads = (int)njobs;
+
+    pool_state_t st = { .next = 0, .njobs = njobs, .fn = fn, .ctx = ctx };
+    if (bej_mutex_init(&st.lock) != 0) return -1;
+
+    if (threads == 1) {
+        pool_worker(&st);
+        bej_mutex_destroy(&st.lock);
+        return 0;
+    }
+
+    bej_thread_t* tids = (bej_thread_t*)calloc((size_t)threads, sizeof(bej_thread_t));
+    if (!tids) { bej_mutex_destroy(&st.lock); return -1; }
+
+    int started = 0;
+    for (; started < threads; ++started) {
+        if (bej_thread_create(&tids[started], pool_worker, &st) != 0) break;
+    }
+    /* If no worker could be spawned, drain the jobs on the calling thread. */
+    if (started == 0) pool_worker(&st);
+    for (int i = 0; i < started; ++i) bej_thread_join(tids[i]);
+
+    free(tids);
+    bej_mutex_destroy(&st.lock);
+    return 0;
+}
@@ -0,0 +1,395 @@
+#if !defined(_WIN32)
+#define _DEFAULT_SOURCE
+#endif
+#include "registry.h"
+#include "bej_thread.h"
+#include "io.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define BUNDLE_MAGIC   "BEJDBNDL"
+#define BUNDLE_VERSION 1u
+#define BUNDLE_ALIGN   4096u
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t index_off;
+    uint32_t strings_off;
+    uint32_t strings_size;
+    uint32_t reserved;
+} bundle_header_t;
+
+typedef struct {
+    uint32_t name_off;          /* into the string section */
+    uint32_t name_len;
+    uint32_t schema_version;
+    uint32_t reserved;
+    uint64_t data_off;          /* from the start of the bundle */
+    uint64_t data_size;
+} bundle_index_t;
+
+typedef struct {
+    const char* name;
+    uint32_t name_len;
+    uint32_t version;
+    const uint8_t* data;
+    size_t   size;
+
+    bej_dictionary_t dict;
+    int      loaded;
+    int      refs;
+    size_t   cost;
+    int32_t  lru_prev, lru_next;
+} reg_member_t;
+
+struct dict_registry_s {
+    bej_mutex_t lock;
+    const uint8_t* bytes;
+    size_t   size;
+    int      mapped;
+
+    reg_member_t* members;
+    uint32_t count;
+
+    uint32_t* by_key;           /* (name, version) -> member + 1 */
+    uint32_t* by_name;          /* name -> newest member + 1 */
+    uint32_t  table_mask;
+
+    int32_t  lru_head, lru_tail; /* most / least recently used loaded member */
+    size_t   budget;
+    size_t   resident, resident_bytes, loads, evictions;
+};
+
+static uint32_t name_hash(const char* s, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) { h ^= (uint8_t)s[i]; h *= 16777619u; }
+    return h;
+}
+
+static uint32_t key_hash(const char* s, size_t n, uint32_t version) {
+    uint32_t h = name_hash(s, n) ^ (version * 2654435761u);
+    return h ^ (h >> 16);
+}
+
+static int name_eq(const reg_member_t* m, const char* s, size_t n) {
+    return m->name_len == n && memcmp(m->name, s, n) == 0;
+}
+
+/* ---- bundle writer ---- */
+
+typedef struct {
+    uint8_t* image;
+    size_t   image_size;
+    char     name[256];
+    uint32_t name_len;
+    uint32_t version;
+} bundle_src_t;
+
+static int write_zeros(FILE* f, size_t n) {
+    static const uint8_t zeros[256];
+    while (n) {
+        size_t k = n < sizeof(zeros) ? n : sizeof(zeros);
+        if (fwrite(zeros, 1, k, f) != k) return -1;
+        n -= k;
+    }
+    return 0;
+}
+
+int dict_bundle_write(const char* out_path, const char* const* dict_paths, size_t count) {
+    if (count == 0 || count > UINT32_MAX) return -1;
+    bundle_src_t* src = (bundle_src_t*)calloc(count, sizeof(bundle_src_t));
+    if (!src) return -1;
+    int rc = -1;
+    FILE* f = NULL;
+
+    size_t strings_size = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bej_dictionary_t d;
+        if (dict_load(dict_paths[i], &d) != 0) {
+            fprintf(stderr, "Failed to load dictionary: %s\n", dict_paths[i]);
+            dict_free(&d);
+            goto done;
+        }
+        const char* root = d.entry_count ? dict_entry_name(&d, &d.entries[0]) : NULL;
+        if (!root || d.entries[0].name_len >= sizeof(src[i].name)) {
+            fprintf(stderr, "Dictionary has no usable root name: %s\n", dict_paths[i]);
+            dict_free(&d);
+            goto done;
+        }
+        memcpy(src[i].name, root, d.entries[0].name_len);
+        src[i].name_len = d.entries[0].name_len;
+        src[i].version = d.schema_version;
+        int brc = dict_image_build(&d, &src[i].image, &src[i].image_size);
+        dict_free(&d);
+        if (brc != 0) goto done;
+        for (size_t j = 0; j < i; ++j) {
+            if (src[j].version == src[i].version && src[j].name_len == src[i].name_len &&
+                !memcmp(src[j].name, src[i].name, src[i].name_len)) {
+                fprintf(stderr, "Duplicate schema %s in bundle: %s\n", src[i].name, dict_paths[i]);
+                goto done;
+            }
+        }
+        strings_size += src[i].name_len + 1;
+    }
+
+    bundle_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BUNDLE_MAGIC, 8);
+    h.version = BUNDLE_VERSION;
+    h.count = (uint32_t)count;
+    h.index_off = sizeof(h);
+    h.strings_off = (uint32_t)(h.index_off + count * sizeof(bundle_index_t));
+    h.strings_size = (uint32_t)strings_size;
+
+    bundle_index_t* index = (bundle_index_t*)calloc(count, sizeof(bundle_index_t));
+    if (!index) goto done;
+    uint64_t data_off = ((uint64_t)h.strings_off + strings_size + BUNDLE_ALIGN - 1) / BUNDLE_ALIGN * BUNDLE_ALIGN;
+    uint32_t name_off = 0;
+    for (size_t i = 0; i < count; ++i) {
+        index[i].name_off = name_off;
+        index[i].name_len = src[i].name_len;
+        index[i].schema_version = src[i].version;
+        index[i].data_off = data_off;
+        index[i].data_size = src[i].image_size;
+        name_off += src[i].name_len + 1;
+        data_off = (data_off + src[i].image_size + BUNDLE_ALIGN - 1) / BUNDLE_ALIGN * BUNDLE_ALIGN;
+    }
+
+    f = fopen(out_path, "wb");
+    if (!f) { free(index); goto done; }
+    uint64_t pos = 0;
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(index, sizeof(*index), count, f) == count;
+    pos = h.strings_off;
+    for (size_t i = 0; ok && i < count; ++i) {
+        ok = fwrite(src[i].name, 1, src[i].name_len + 1, f) == src[i].name_len + 1;
+        pos += src[i].name_len + 1;
+    }
+    for (size_t i = 0; ok && i < count; ++i) {
+        ok = write_zeros(f, (size_t)(index[i].data_off - pos)) == 0 &&
+            fwrite(src[i].image, 1, src[i].image_size, f) == src[i].image_size;
+        pos = index[i].data_off + src[i].image_size;
+    }
+    free(index);
+    if (fclose(f) != 0) ok = 0;
+    f = NULL;
+    rc = ok ? 0 : -1;
+
+done:
+    for (size_t i = 0; i < count; ++i) free(src[i].image);
+    free(src);
+    return rc;
+}
+
+/* ---- registry ---- */
+
+static void table_insert(uint32_t* table, uint32_t mask, uint32_t h, uint32_t member) {
+    while (table[h & mask]) h++;
+    table[h & mask] = member + 1;
+}
+
+int dict_registry_open(const char* bundle_path, size_t mem_budget, dict_registry_t** out) {
+    *out = NULL;
+    dict_registry_t* r = (dict_registry_t*)calloc(1, sizeof(*r));
+    if (!r) return -1;
+    r->budget = mem_budget;
+    r->lru_head = r->lru_tail = -1;
+    if (bej_mutex_init(&r->lock) != 0) { free(r); return -1; }
+    if (map_file_all(bundle_path, &r->bytes, &r->size, &r->mapped) != 0) goto fail;
+
+    bundle_header_t h;
+    if (r->size < sizeof(h)) goto fail;
+    memcpy(&h, r->bytes, sizeof(h));
+    if (memcmp(h.magic, BUNDLE_MAGIC, 8) != 0 || h.version != BUNDLE_VERSION || h.count == 0) goto fail;
+    if (h.index_off > r->size || (uint64_t)h.count * sizeof(bundle_index_t) > r->size - h.index_off) goto fail;
+    if (h.strings_off > r->size || h.strings_size > r->size - h.strings_off) goto fail;
+
+    r->count = h.count;
+    r->members = (reg_member_t*)calloc(h.count, sizeof(reg_member_t));
+    uint32_t slots = 16;
+    while (slots < h.count * 2) slots <<= 1;
+    r->table_mask = slots - 1;
+    r->by_key = (uint32_t*)calloc(slots, sizeof(uint32_t));
+    r->by_name = (uint32_t*)calloc(slots, sizeof(uint32_t));
+    if (!r->members || !r->by_key || !r->by_name) goto fail;
+
+    const char* strings = (const char*)r->bytes + h.strings_off;
+    for (uint32_t i = 0; i < h.count; ++i) {
+        bundle_index_t ix;
+        memcpy(&ix, r->bytes + h.index_off + (size_t)i * sizeof(ix), sizeof(ix));
+        if ((uint64_t)ix.name_off + ix.name_len >= h.strings_size) goto fail;
+        if (ix.data_off > r->size || ix.data_size > r->size - ix.data_off || (ix.data_off & 7)) goto fail;
+        reg_member_t* m = &r->members[i];
+        m->name = strings + ix.name_off;
+        m->name_len = ix.name_len;
+        m->version = ix.schema_version;
+        m->data = r->bytes + ix.data_off;
+        m->size = (size_t)ix.data_size;
+        m->lru_prev = m->lru_next = -1;
+
+        table_insert(r->by_key, r->table_mask, key_hash(m->name, m->name_len, m->version), i);
+        uint32_t hn = name_hash(m->name, m->name_len);
+        uint32_t* slot = NULL;
+        for (uint32_t k = hn;; ++k) {
+            uint32_t v = r->by_name[k & r->table_mask];
+            if (!v) break;
+            if (name_eq(&r->members[v - 1], m->name, m->name_len)) { slot = &r->by_name[k & r->table_mask]; break; }
+        }
+        if (!slot) table_insert(r->by_name, r->table_mask, hn, i);
+        else if (r->members[*slot - 1].version < m->version) *slot = i + 1;
+    }
+    *out = r;
+    return 0;
+
+fail:
+    dict_registry_close(r);
+    return -1;
+}
+
+static void lru_unlink(dict_registry_t* r, int32_t i) {
+    reg_member_t* m = &r->members[i];
+    if (m->lru_prev >= 0) r->members[m->lru_prev].lru_next = m->lru_next; else r->lru_head = m->lru_next;
+    if (m->lru_next >= 0) r->members[m->lru_next].lru_prev = m->lru_prev; else r->lru_tail = m->lru_prev;
+    m->lru_prev = m->lru_next = -1;
+}
+
+static void lru_push_front(dict_registry_t* r, int32_t i) {
+    reg_member_t* m = &r->members[i];
+    m->lru_prev = -1;
+    m->lru_next = r->lru_head;
+    if (r->lru_head >= 0) r->members[r->lru_head].lru_prev = i; else r->lru_tail = i;
+    r->lru_head = i;
+}
+
+static void member_unload(dict_registry_t* r, int32_t i) {
+    reg_member_t* m = &r->members[i];
+    lru_unlink(r, i);
+    dict_free(&m->dict);
+    m->loaded = 0;
+    r->resident--;
+    r->resident_bytes -= m->cost;
+    r->evictions++;
+#if !defined(_WIN32) && defined(MADV_DONTNEED)
+    /* Members are page aligned in the bundle; hand the pages back too. */
+    long page = sysconf(_SC_PAGESIZE);
+    if (r->mapped && page > 0 && ((uintptr_t)m->data % (uintptr_t)page) == 0) {
+        madvise((void*)m->data, m->size, MADV_DONTNEED);
+    }
+#endif
+}
+
+static void evict_over_budget(dict_registry_t* r) {
+    if (!r->budget) return;
+    int32_t i = r->lru_tail;
+    while (i >= 0 && r->resident_bytes > r->budget) {
+        int32_t prev = r->members[i].lru_prev;
+        if (r->members[i].refs == 0) member_unload(r, i);
+        i = prev;
+    }
+}
+
+static const bej_dictionary_t* acquire_member(dict_registry_t* r, uint32_t idx) {
+    reg_member_t* m = &r->members[idx];
+    if (!m->loaded) {
+        if (dict_load_mem(m->data, m->size, &m->dict, NULL) != 0) {
+            dict_free(&m->dict);
+            return NULL;
+        }
+        m->loaded = 1;
+        m->cost = m->size;
+        /* Images carry their tables and keys; anything else built them on the heap. */
+        if (!m->dict.tables_borrowed) {
+            m->cost += (size_t)m->dict.entry_count * (sizeof(bej_dict_entry_t) + sizeof(bej_seq_index_t)) +
+                m->dict.seq_pool_len * sizeof(uint16_t);
+            if (m->dict.key_off)
+                m->cost += ((size_t)m->dict.entry_count + 1) * sizeof(uint32_t) + m->dict.key_off[m->dict.entry_count];
+        }
+        r->resident++;
+        r->resident_bytes += m->cost;
+        r->loads++;
+        lru_push_front(r, (int32_t)idx);
+    }
+    else {
+        lru_unlink(r, (int32_t)idx);
+        lru_push_front(r, (int32_t)idx);
+    }
+    m->refs++;
+    evict_over_budget(r);
+    return &m->dict;
+}
+
+const bej_dictionary_t* dict_registry_acquire(dict_registry_t* r, const char* schema, uint32_t schema_version) {
+    size_t n = strlen(schema);
+    const bej_dictionary_t* d = NULL;
+    bej_mutex_lock(&r->lock);
+    if (schema_version == 0) {
+        for (uint32_t k = name_hash(schema, n);; ++k) {
+            uint32_t v = r->by_name[k & r->table_mask];
+            if (!v) break;
+            if (name_eq(&r->members[v - 1], schema, n)) { d = acquire_member(r, v - 1); break; }
+        }
+    }
+    else {
+        for (uint32_t k = key_hash(schema, n, schema_version);; ++k) {
+            uint32_t v = r->by_key[k & r->table_mask];
+            if (!v) break;
+            const reg_member_t* m = &r->members[v - 1];
+            if (m->version == schema_version && name_eq(m, schema, n)) { d = acquire_member(r, v - 1); break; }
+        }
+    }
+    bej_mutex_unlock(&r->lock);
+    return d;
+}
+
+const bej_dictionary_t* dict_registry_acquire_key(dict_registry_t* r, const char* key) {
+    const char* colon = strchr(key, ':');
+    if (!colon) return dict_registry_acquire(r, key, 0);
+    char name[256];
+    size_t n = (size_t)(colon - key);
+    if (n >= sizeof(name)) return NULL;
+    memcpy(name, key, n);
+    name[n] = '\0';
+    char* end = NULL;
+    unsigned long version = strtoul(colon + 1, &end, 16);
+    if (!*(colon + 1) || *end || version == 0 || version > UINT32_MAX) return NULL;
+    return dict_registry_acquire(r, name, (uint32_t)version);
+}
+
+void dict_registry_release(dict_registry_t* r, const bej_dictionary_t* d) {
+    if (!d) return;
+    reg_member_t* m = (reg_member_t*)(void*)((char*)(void*)d - offsetof(reg_member_t, dict));
+    bej_mutex_lock(&r->lock);
+    if (m->refs > 0) m->refs--;
+    evict_over_budget(r);
+    bej_mutex_unlock(&r->lock);
+}
+
+void dict_registry_stats(dict_registry_t* r, dict_registry_stats_t* out) {
+    bej_mutex_lock(&r->lock);
+    out->members = r->count;
+    out->resident = r->resident;
+    out->resident_bytes = r->resident_bytes;
+    out->loads = r->loads;
+    out->evictions = r->evictions;
+    bej_mutex_unlock(&r->lock);
+}
+
+void dict_registry_close(dict_registry_t* r) {
+    if (!r) return;
+    for (uint32_t i = 0; r->members && i < r->count; ++i) {
+        if (r->members[i].loaded) dict_free(&r->members[i].dict);
+    }
+    free(r->members);
+    free(r->by_key);
+    free(r->by_name);
+    unmap_file_all(r->bytes, r->size, r->mapped);
+    bej_mutex_destroy(&r->lock);
+    free(r);
+}
@@ -0,0 +1,170 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "sink.h"
+#include <errno.h>
+#include <stdlib.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static int flush_file(bej_sink_t* sink, const char* data, size_t n) {
+    return fwrite(data, 1, n, sink->file) == n ? 0 : -1;
+}
+
+static int flush_fd(bej_sink_t* sink, const char* data, size_t n) {
+    while (n) {
+#if defined(_WIN32)
+        int w = _write(sink->fd, data, (unsigned)(n < 0x40000000u ? n : 0x40000000u));
+#else
+        ssize_t w = write(sink->fd, data, n);
+#endif
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += w; n -= (size_t)w;
+    }
+    return 0;
+}
+
+static int sink_init(bej_sink_t* sink, char* buf, size_t cap) {
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = -1;
+    if (!buf || !cap) {
+        cap = BEJ_SINK_BUFSZ;
+        buf = (char*)malloc(cap);
+        if (!buf) return -1;
+        sink->owns_buf = 1;
+    }
+    sink->buf = buf;
+    sink->cap = cap;
+    return 0;
+}
+
+int bej_sink_init_file(bej_sink_t* sink, FILE* f, char* buf, size_t cap) {
+    if (sink_init(sink, buf, cap) != 0) return -1;
+    sink->flush = flush_file;
+    sink->file = f;
+    return 0;
+}
+
+int bej_sink_init_fd(bej_sink_t* sink, int fd, char* buf, size_t cap) {
+    if (sink_init(sink, buf, cap) != 0) return -1;
+    sink->flush = flush_fd;
+    sink->fd = fd;
+    return 0;
+}
+
+int bej_sink_init_mem(bej_sink_t* sink, size_t initial_cap) {
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = -1;
+    sink->cap = initial_cap ? initial_cap : 4096;
+    sink->buf = (char*)malloc(sink->cap);
+    if (!sink->buf) return -1;
+    sink->owns_buf = 1;
+    return 0;
+}
+
+int bej_sink_init_fixed(bej_sink_t* sink, char* buf, size_t cap) {
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = -1;
+    sink->buf = buf;
+    sink->cap = cap;
+    sink->fixed = 1;
+    return 0;
+}
+
+static int sink_grow(bej_sink_t* sink, size_t need) {
+    if (sink->fixed) return -1;
+    size_t ncap = sink->cap ? sink->cap : 4096;
+    while (ncap < need) {
+        if (ncap > SIZE_MAX / 2) return -1;
+        ncap *= 2;
+    }
+    char* nb;
+    if (sink->owns_buf) {
+        nb = (char*)realloc(sink->buf, ncap);
+        if (!nb) return -1;
+    }
+    else {
+        nb = (char*)malloc(ncap);
+        if (!nb) return -1;
+        memcpy(nb, sink->buf, sink->len);
+        sink->owns_buf = 1;
+    }
+    sink->buf = nb;
+    sink->cap = ncap;
+    return 0;
+}
+
+char* bej_sink_reserve(bej_sink_t* sink, size_t n) {
+    if (sink->error) return NULL;
+    if (sink->cap - sink->len >= n) return sink->buf + sink->len;
+    if (sink->flush && bej_sink_flush(sink) != 0) return NULL;
+    if (sink->cap - sink->len >= n) return sink->buf + sink->len;
+    if (n > SIZE_MAX - sink->len || sink_grow(sink, sink->len + n) != 0) {
+        sink->error = -1;
+        return NULL;
+    }
+    return sink->buf + sink->len;
+}
+
+int bej_sink_flush(bej_sink_t* sink) {
+    if (sink->error) return sink->error;
+    if (!sink->flush || !sink->len) return 0;
+    if (sink->flush(sink, sink->buf, sink->len) != 0) {
+        sink->error = -1;
+        return -1;
+    }
+    sink->len = 0;
+    return 0;
+}
+
+int bej_sink_finish(bej_sink_t* sink) {
+    bej_sink_flush(sink);
+    if (!sink->error && sink->file && fflush(sink->file) != 0) sink->error = -1;
+    return sink->error;
+}
+
+char* bej_sink_take(bej_sink_t* sink, size_t* out_len) {
+    if (sink->flush || sink->error || !sink->owns_buf) return NULL;
+    if (!bej_sink_reserve(sink, 1)) return NULL;
+    sink->buf[sink->len] = '\0';
+    char* data = sink->buf;
+    if (out_len) *out_len = sink->len;
+    sink->buf = NULL;
+    sink->len = sink->cap = 0;
+    sink->owns_buf = 0;
+    return data;
+}
+
+void bej_sink_free(bej_sink_t* sink) {
+    if (!sink) return;
+    if (sink->owns_buf) free(sink->buf);
+    sink->buf = NULL;
+    sink->len = sink->cap = 0;
+    sink->owns_buf = 0;
+}
+
+void bej_sink_put_u64(bej_sink_t* sink, uint64_t v) {
+    char tmp[20];
+    size_t i = sizeof(tmp);
+    do {
+        tmp[--i] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    bej_sink_write(sink, tmp + i, sizeof(tmp) - i);
+}
+
+void bej_sink_put_i64(bej_sink_t* sink, int64_t v) {
+    if (v < 0) {
+        bej_sink_putc(sink, '-');
+        bej_sink_put_u64(sink, (uint64_t)0 - (uint64_t)v);
+    }
+    else {
+        bej_sink_put_u64(sink, (uint64_t)v);
+    }
+}
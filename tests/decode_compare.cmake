@@ -0,0 +1,71 @@
+# Decodes PAYLOAD with DICT through bej2json (from a file, from stdin, with
+# the dictionary compiled by bej_dictc and in batch mode) and checks every
+# output against EXPECTED byte for byte. EXPECTED is then encoded back with
+# json2bej and must reproduce PAYLOAD.
+
+file(REMOVE_RECURSE ${WORKDIR})
+file(MAKE_DIRECTORY ${WORKDIR}/in ${WORKDIR}/out)
+
+execute_process(COMMAND ${BEJ2JSON} -s ${DICT} -b ${PAYLOAD} -o ${WORKDIR}/single.json
+  RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "bej2json failed: ${rc}")
+endif()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORKDIR}/single.json ${EXPECTED}
+  RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "single-payload output differs from ${EXPECTED}")
+endif()
+
+execute_process(COMMAND ${BEJ2JSON} -s ${DICT} -b - -o ${WORKDIR}/stdin.json
+  INPUT_FILE ${PAYLOAD} RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "bej2json failed reading stdin: ${rc}")
+endif()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORKDIR}/stdin.json ${EXPECTED}
+  RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "stdin output differs from ${EXPECTED}")
+endif()
+
+execute_process(COMMAND ${BEJ_DICTC} ${DICT} ${WORKDIR}/dict.bejdc RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "bej_dictc failed: ${rc}")
+endif()
+execute_process(COMMAND ${BEJ2JSON} -s ${WORKDIR}/dict.bejdc -b ${PAYLOAD} -o ${WORKDIR}/compiled.json
+  RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "bej2json failed with compiled dictionary: ${rc}")
+endif()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORKDIR}/compiled.json ${EXPECTED}
+  RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "compiled-dictionary output differs from ${EXPECTED}")
+endif()
+
+foreach(i RANGE 1 8)
+  configure_file(${PAYLOAD} ${WORKDIR}/in/p${i}.bej COPYONLY)
+endforeach()
+execute_process(COMMAND ${BEJ2JSON} -s ${DICT} -B ${WORKDIR}/in -o ${WORKDIR}/out -j 4
+  RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "bej2json batch mode failed: ${rc}")
+endif()
+foreach(i RANGE 1 8)
+  execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORKDIR}/out/p${i}.json ${EXPECTED}
+    RESULT_VARIABLE rc)
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "batch output p${i}.json differs from ${EXPECTED}")
+  endif()
+endforeach()
+
+execute_process(COMMAND ${JSON2BEJ} -s ${DICT} -j ${EXPECTED} -o ${WORKDIR}/encoded.bej
+  RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "json2bej failed: ${rc}")
+endif()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORKDIR}/encoded.bej ${PAYLOAD}
+  RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "json2bej output differs from ${PAYLOAD}")
+endif()
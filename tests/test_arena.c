@@ -0,0 +1,70 @@
+#include "bej.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+int main(void) {
+    int rc;
+    /* Allocation: aligned, bounded, reusable after a reset. */
+    static uint8_t mem[256];
+    bej_arena_t a;
+    bej_arena_init(&a, mem + 1, sizeof(mem) - 1);
+    uint8_t* p = (uint8_t*)bej_arena_alloc(&a, 10);
+    uint8_t* q = (uint8_t*)bej_arena_alloc(&a, 10);
+    assert(p && q && (uintptr_t)p % 16 == 0 && (uintptr_t)q % 16 == 0 && q >= p + 10);
+    void* big = bej_arena_alloc(&a, sizeof(mem));
+    assert(!big);
+    size_t peak = a.peak;
+    bej_arena_reset(&a);
+    void* again = bej_arena_alloc(&a, 10);
+    assert(again == p && a.peak == peak);
+
+    const char* dicts[] = { EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/Memory_v1.bin" };
+    const char* payloads[] = { EXAMPLES_DIR "/processor.bej", EXAMPLES_DIR "/example.bej" };
+    for (size_t i = 0; i < 2; ++i) {
+        bej_dictionary_t d;
+        rc = dict_load(dicts[i], &d);
+        assert(rc == 0);
+        uint8_t* bej = NULL; size_t sz = 0;
+        rc = read_file_all(payloads[i], &bej, &sz);
+        assert(rc == 0);
+        char* want = NULL; size_t want_len = 0;
+        rc = bej_decode_to_buffer(bej, sz, &d, &want, &want_len);
+        assert(rc == 0);
+
+        /* Output lands in the arena, byte-identical to the heap buffer. */
+        uint8_t* buf = (uint8_t*)malloc(want_len + 16);
+        bej_arena_init(&a, buf, want_len + 16);
+        char* json = NULL; size_t len = 0;
+        for (int round = 0; round < 2; ++round) {
+            bej_arena_reset(&a);
+            rc = bej_decode_to_arena(bej, sz, &d, &a, &json, &len);
+            assert(rc == 0);
+            assert(len == want_len && !memcmp(json, want, len + 1));
+            assert(a.used >= len + 1 && (uint8_t*)json >= buf);
+        }
+        /* A second decode without a reset has no room left. */
+        rc = bej_decode_to_arena(bej, sz, &d, &a, &json, &len);
+        assert(rc == -1 && !json);
+
+        /* Too small: an error, and nothing taken from the arena. */
+        for (size_t cap = 0; cap <= want_len; cap += 7) {
+            bej_arena_init(&a, buf, cap);
+            rc = bej_decode_to_arena(bej, sz, &d, &a, &json, &len);
+            assert(rc == -1);
+            assert(a.used == 0);
+        }
+        free(buf);
+        free(want);
+        free(bej);
+        dict_free(&d);
+    }
+    return 0;
+}
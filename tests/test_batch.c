@@ -0,0 +1,187 @@
+#define _POSIX_C_SOURCE 200809L
+#include "batch.h"
+#include "bej_encode.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+#define NPAYLOADS 120
+
+static const char* in_dir = "test_batch_in";
+
+/* Output of item @p name in @p dir, or NULL if it was not written. */
+static char* output(const char* dir, const char* name) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.json", dir, name);
+    uint8_t* data = NULL; size_t size = 0;
+    if (read_file_all(path, &data, &size) != 0) return NULL;
+    char* s = (char*)realloc(data, size + 1);
+    assert(s);
+    s[size] = '\0';
+    return s;
+}
+
+static void clear_outputs(const char* dir, size_t n) {
+    char path[256];
+    mkdir(dir, 0755);
+    for (size_t i = 0; i < n; ++i) {
+        snprintf(path, sizeof(path), "%s/p%03zu.json", dir, i);
+        unlink(path);
+    }
+    snprintf(path, sizeof(path), "%s/processor.json", dir);
+    unlink(path);
+}
+
+/* Every output under @p dir is byte for byte the one under @p ref (or missing in both). */
+static void same_outputs(const char* dir, const char* ref, size_t n) {
+    char name[32];
+    for (size_t i = 0; i <= n; ++i) {
+        if (i < n) snprintf(name, sizeof(name), "p%03zu", i);
+        else snprintf(name, sizeof(name), "processor");
+        char* a = output(dir, name);
+        char* b = output(ref, name);
+        assert(!a == !b && (!a || !strcmp(a, b)));
+        free(a);
+        free(b);
+    }
+}
+
+int main(void) {
+    bej_dictionary_t d;
+    int rc = dict_load(EXAMPLES_DIR "/Memory_v1.bin", &d);
+    assert(rc == 0);
+    bej_encoder_t* enc = bej_encoder_new(&d);
+    mkdir(in_dir, 0755);
+
+    /* Payloads of different sizes; one is cut short and one is missing. */
+    FILE* list = fopen("test_batch.list", "w");
+    assert(list);
+    char** want = (char**)calloc(NPAYLOADS, sizeof(char*));
+    assert(want);
+    for (int i = 0; i < NPAYLOADS; ++i) {
+        char json[4096], path[256];
+        int n = snprintf(json, sizeof(json), "{\"Id\": \"m%03d\", \"AllowedSpeedsMHz\": [", i);
+        for (int k = 0; k < i * 3; ++k) n += snprintf(json + n, sizeof(json) - (size_t)n, "%s%d", k ? ", " : "", k);
+        snprintf(json + n, sizeof(json) - (size_t)n, "]}");
+        uint8_t* bej = NULL; size_t sz = 0;
+        rc = bej_encode(enc, json, strlen(json), &bej, &sz);
+        assert(rc == 0);
+        rc = bej_decode_to_buffer(bej, sz, &d, &want[i], NULL);
+        assert(rc == 0);
+        snprintf(path, sizeof(path), "%s/p%03d.bej", in_dir, i);
+        if (i == 7) sz -= 1;
+        if (i != 11) {
+            rc = write_file_all(path, (const char*)bej, sz);
+            assert(rc == 0);
+        }
+        else unlink(path);
+        fprintf(list, "%s\n", path);
+        free(bej);
+    }
+    fclose(list);
+    bej_encoder_free(enc);
+
+    batch_item_t* items = NULL; size_t count = 0;
+    rc = batch_collect("test_batch.list", &items, &count);
+    assert(rc == 0 && count == NPAYLOADS);
+
+    /* One worker per file, the reference. */
+    batch_opts_t opts = { .dict = &d, .out_dir = "test_batch_ref", .threads = 3 };
+    clear_outputs(opts.out_dir, NPAYLOADS);
+    rc = batch_decode(items, count, &opts);
+    assert(rc == 2);
+    for (size_t i = 0; i < NPAYLOADS; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "p%03zu", i);
+        char* got = output(opts.out_dir, name);
+        if (i == 11) assert(!got);
+        else if (i != 7) assert(got && !strcmp(got, want[i]));
+        free(got);
+    }
+
+    /* The pipeline writes the same files and counts the same failures, with
+     * any mix of stage widths and window depths, a cache included. */
+    static const struct { int readers, threads; size_t depth; } shapes[] = {
+        { 0, 0, 0 }, { 2, 3, 3 }, { 1, 1, 1 }, { 4, 2, 64 }, { 3, 8, 2 },
+    };
+    opts.out_dir = "test_batch_out";
+    for (size_t k = 0; k < sizeof(shapes) / sizeof(shapes[0]); ++k) {
+        opts.readers = shapes[k].readers;
+        opts.threads = shapes[k].threads;
+        opts.depth = shapes[k].depth;
+        clear_outputs(opts.out_dir, NPAYLOADS);
+        rc = batch_pipeline(items, count, &opts);
+        assert(rc == 2);
+        same_outputs(opts.out_dir, "test_batch_ref", NPAYLOADS);
+    }
+    bej_cache_t* cache = NULL;
+    rc = bej_cache_open(1 << 20, &cache);
+    assert(rc == 0);
+    opts.cache = cache;
+    for (int pass = 0; pass < 2; ++pass) {
+        clear_outputs(opts.out_dir, NPAYLOADS);
+        rc = batch_pipeline(items, count, &opts);
+        assert(rc == 2);
+        same_outputs(opts.out_dir, "test_batch_ref", NPAYLOADS);
+    }
+    bej_cache_stats_t st;
+    bej_cache_stats(cache, &st);
+    assert(st.entries == NPAYLOADS - 2 && st.hits == NPAYLOADS - 2);
+    opts.cache = NULL;
+    bej_cache_close(cache);
+    rc = batch_pipeline(items, 0, &opts);
+    assert(rc == 0);
+    batch_free_items(items, count);
+
+    /* Per-item schemas from a bundle, one of them unknown. */
+    const char* dicts[] = { EXAMPLES_DIR "/Memory_v1.bin", EXAMPLES_DIR "/Processor_v1.bin" };
+    rc = dict_bundle_write("test_batch.bejb", dicts, 2);
+    assert(rc == 0);
+    dict_registry_t* reg = NULL;
+    rc = dict_registry_open("test_batch.bejb", 0, &reg);
+    assert(rc == 0);
+    list = fopen("test_batch.list", "w");
+    assert(list);
+    for (int i = 0; i < 20; ++i) fprintf(list, "%s/p%03d.bej%s\n", in_dir, i, i == 5 ? "\tNoSuch" : "");
+    fprintf(list, "%s\tProcessor\n", EXAMPLES_DIR "/processor.bej");
+    fclose(list);
+    rc = batch_collect("test_batch.list", &items, &count);
+    assert(rc == 0 && count == 21);
+    batch_opts_t ropts = { .registry = reg, .schema = "Memory", .out_dir = "test_batch_ref", .threads = 2 };
+    clear_outputs(ropts.out_dir, NPAYLOADS);
+    rc = batch_decode(items, count, &ropts);
+    assert(rc == 3);
+    ropts.out_dir = "test_batch_out";
+    ropts.depth = 4;
+    clear_outputs(ropts.out_dir, NPAYLOADS);
+    rc = batch_pipeline(items, count, &ropts);
+    assert(rc == 3);
+    same_outputs(ropts.out_dir, "test_batch_ref", 20);
+    char* got = output(ropts.out_dir, "processor");
+    assert(got && strstr(got, "\"CPU-777\""));
+    free(got);
+    batch_free_items(items, count);
+    dict_registry_close(reg);
+
+    /* Two payloads with one basename would write the same output: refused. */
+    list = fopen("test_batch.list", "w");
+    assert(list);
+    fprintf(list, "%s/p001.bej\n%s/p001.bej\n", in_dir, EXAMPLES_DIR);
+    fclose(list);
+    rc = batch_collect("test_batch.list", &items, &count);
+    assert(rc == -2 && !items && count == 0);
+
+    for (int i = 0; i < NPAYLOADS; ++i) free(want[i]);
+    free(want);
+    dict_free(&d);
+    return 0;
+}
@@ -0,0 +1,273 @@
+#include "bej_binary.h"
+#include "bej_encode.h"
+#include "bej_project.h"
+#include "dict.h"
+#include "io.h"
+#include "json_escape.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+/* Both readers render compact JSON, to compare with the JSON writer's output. */
+
+static uint64_t be(const uint8_t** p, int n) {
+    uint64_t v = 0;
+    for (int i = 0; i < n; ++i) v = v << 8 | *(*p)++;
+    return v;
+}
+
+static void put_text(bej_sink_t* t, const uint8_t** p, size_t n) {
+    bej_sink_putc(t, '"');
+    json_escape_run(t, (const char*)*p, n);
+    bej_sink_putc(t, '"');
+    *p += n;
+}
+
+/* Shortest %g that reads back the same; ".0" keeps a whole number a real. */
+static void format_double(char buf[48], double d) {
+    for (int prec = 15; prec <= 17; ++prec) {
+        snprintf(buf, 40, "%.*g", prec, d);
+        if (strtod(buf, NULL) == d) break;
+    }
+    if (!strpbrk(buf, ".e")) strcat(buf, ".0");
+}
+
+static void put_double(bej_sink_t* t, double d) {
+    char buf[48];
+    format_double(buf, d);
+    bej_sink_puts(t, buf);
+}
+
+static double get_float(const uint8_t** p, int n) {
+    uint64_t u = be(p, n);
+    if (n == 8) { double d; memcpy(&d, &u, 8); return d; }
+    uint32_t u32 = (uint32_t)u;
+    float f;
+    memcpy(&f, &u32, 4);
+    return f;
+}
+
+static const uint8_t* cbor_json(const uint8_t* p, bej_sink_t* t) {
+    uint8_t ib = *p++, major = ib >> 5, ai = ib & 31;
+    if (major == 7) {
+        if (ai == 20 || ai == 21) bej_sink_puts(t, ai == 21 ? "true" : "false");
+        else if (ai == 22) bej_sink_puts(t, "null");
+        else { assert(ai == 26 || ai == 27); put_double(t, get_float(&p, ai == 26 ? 4 : 8)); }
+        return p;
+    }
+    uint64_t v = ai < 24 ? ai : ai == 31 ? 0 : be(&p, 1 << (ai - 24));
+    switch (major) {
+    case 0: bej_sink_put_u64(t, v); break;
+    case 1: bej_sink_put_i64(t, -1 - (int64_t)v); break;
+    case 3: put_text(t, &p, (size_t)v); break;
+    case 4:
+    case 5:
+        assert(ai == 31);
+        bej_sink_putc(t, major == 5 ? '{' : '[');
+        for (int first = 1; *p != 0xFF; first = 0) {
+            if (!first) bej_sink_putc(t, ',');
+            if (major == 5) { p = cbor_json(p, t); bej_sink_putc(t, ':'); }
+            p = cbor_json(p, t);
+        }
+        ++p;
+        bej_sink_putc(t, major == 5 ? '}' : ']');
+        break;
+    default: assert(0);
+    }
+    return p;
+}
+
+static const uint8_t* msgpack_json(const uint8_t* p, bej_sink_t* t) {
+    uint8_t b = *p++;
+    uint64_t n = 0;
+    int is_map = 0;
+    if (b < 0x80) { bej_sink_put_u64(t, b); return p; }
+    if (b >= 0xE0) { bej_sink_put_i64(t, (int8_t)b); return p; }
+    if ((b & 0xE0) == 0xA0) { put_text(t, &p, b & 31); return p; }
+    if ((b & 0xE0) == 0x80) { is_map = !(b & 0x10); n = b & 15; }
+    else switch (b) {
+    case 0xC0: bej_sink_puts(t, "null"); return p;
+    case 0xC2: bej_sink_puts(t, "false"); return p;
+    case 0xC3: bej_sink_puts(t, "true"); return p;
+    case 0xCA: put_double(t, get_float(&p, 4)); return p;
+    case 0xCB: put_double(t, get_float(&p, 8)); return p;
+    case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+        bej_sink_put_u64(t, be(&p, 1 << (b - 0xCC))); return p;
+    case 0xD0: bej_sink_put_i64(t, (int8_t)be(&p, 1)); return p;
+    case 0xD1: bej_sink_put_i64(t, (int16_t)be(&p, 2)); return p;
+    case 0xD2: bej_sink_put_i64(t, (int32_t)be(&p, 4)); return p;
+    case 0xD3: bej_sink_put_i64(t, (int64_t)be(&p, 8)); return p;
+    case 0xD9: case 0xDA: case 0xDB: {
+        size_t len = (size_t)be(&p, 1 << (b - 0xD9));
+        put_text(t, &p, len);
+        return p;
+    }
+    case 0xDC: case 0xDD: n = be(&p, b == 0xDC ? 2 : 4); break;
+    case 0xDE: case 0xDF: n = be(&p, b == 0xDE ? 2 : 4); is_map = 1; break;
+    default: assert(0);
+    }
+    bej_sink_putc(t, is_map ? '{' : '[');
+    for (uint64_t i = 0; i < n; ++i) {
+        if (i) bej_sink_putc(t, ',');
+        if (is_map) { p = msgpack_json(p, t); bej_sink_putc(t, ':'); }
+        p = msgpack_json(p, t);
+    }
+    bej_sink_putc(t, is_map ? '}' : ']');
+    return p;
+}
+
+/* JSON text without the whitespace between tokens; reals are written as put_double writes them. */
+static char* compact(const char* s) {
+    char* out = (char*)malloc(strlen(s) * 8 + 48), *o = out;
+    assert(out);
+    for (int in_str = 0; *s; ++s) {
+        if (in_str && *s == '\\') { *o++ = *s++; *o++ = *s; continue; }
+        if (*s == '"') in_str = !in_str;
+        size_t n = in_str ? 0 : strspn(s, "+-.eE0123456789");
+        if (n && memchr(s, '.', n)) {
+            char num[48];
+            format_double(num, strtod(s, NULL));
+            o += sprintf(o, "%s", num);
+            s += n - 1;
+            continue;
+        }
+        if (in_str || !strchr(" \n\t\r", *s)) *o++ = *s;
+    }
+    *o = '\0';
+    return out;
+}
+
+typedef const uint8_t* (*reader_fn)(const uint8_t* p, bej_sink_t* t);
+
+static void check_same(const bej_dictionary_t* d, const uint8_t* bej, size_t sz, const bej_projection_t* proj) {
+    bej_sink_t js;
+    int rc = bej_sink_init_mem(&js, 256);
+    assert(rc == 0);
+    rc = bej_decode_projected(&js, bej, sz, d, proj);
+    assert(rc == 0);
+    char* json = bej_sink_take(&js, NULL);
+    char* want = compact(json);
+
+    for (int k = 0; k < 2; ++k) {
+        bej_sink_t bin;
+        rc = bej_sink_init_mem(&bin, 16);
+        assert(rc == 0);
+        if (k == 0) rc = bej_decode_to_cbor(&bin, bej, sz, d, proj);
+        else rc = bej_decode_to_msgpack(&bin, bej, sz, d, proj);
+        assert(rc == 0);
+        reader_fn read = k == 0 ? cbor_json : msgpack_json;
+        bej_sink_t t;
+        rc = bej_sink_init_mem(&t, 256);
+        assert(rc == 0);
+        const uint8_t* end = read((const uint8_t*)bin.buf, &t);
+        assert(end == (const uint8_t*)bin.buf + bin.len);
+        char* got = bej_sink_take(&t, NULL);
+        if (strcmp(got, want)) fprintf(stderr, "%s\n%s\n", got, want);
+        assert(!strcmp(got, want));
+        free(got);
+        bej_sink_free(&t);
+
+        /* A sink that flushes gets the same bytes. */
+        FILE* f = tmpfile();
+        assert(f);
+        char buf[64];
+        bej_sink_t fs;
+        rc = bej_sink_init_file(&fs, f, buf, sizeof(buf));
+        assert(rc == 0);
+        if (k == 0) rc = bej_decode_to_cbor(&fs, bej, sz, d, proj);
+        else rc = bej_decode_to_msgpack(&fs, bej, sz, d, proj);
+        assert(rc == 0);
+        rc = bej_sink_finish(&fs);
+        assert(rc == 0);
+        assert((size_t)ftell(f) == bin.len);
+        rewind(f);
+        char* back = (char*)malloc(bin.len + 1);
+        assert(back);
+        size_t got_len = fread(back, 1, bin.len, f);
+        assert(got_len == bin.len && !memcmp(back, bin.buf, bin.len));
+        free(back);
+        fclose(f);
+        bej_sink_free(&fs);
+        bej_sink_free(&bin);
+    }
+    free(want);
+    free(json);
+}
+
+static void check_file(const char* dict_path, const char* bej_path) {
+    bej_dictionary_t d;
+    uint8_t* bej = NULL; size_t sz = 0;
+    int rc = dict_load(dict_path, &d);
+    assert(rc == 0);
+    rc = read_file_all(bej_path, &bej, &sz);
+    assert(rc == 0);
+    check_same(&d, bej, sz, NULL);
+    free(bej);
+    dict_free(&d);
+}
+
+int main(void) {
+    check_file(EXAMPLES_DIR "/Memory_v1.bin", EXAMPLES_DIR "/example.bej");
+    check_file(EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/processor.bej");
+
+    bej_dictionary_t d;
+    uint8_t* bej = NULL; size_t sz = 0;
+    int rc = dict_load(EXAMPLES_DIR "/Memory_v1.bin", &d);
+    assert(rc == 0);
+    rc = read_file_all(EXAMPLES_DIR "/example.bej", &bej, &sz);
+    assert(rc == 0);
+
+    /* Exact bytes for a small projection: {"MemoryLocation": {"Slot": 0}}. */
+    const char* paths[] = { "/MemoryLocation/Slot" };
+    bej_projection_t* proj = NULL;
+    rc = bej_projection_new(&d, paths, 1, &proj, NULL);
+    assert(rc == 0);
+    check_same(&d, bej, sz, proj);
+    bej_sink_t s;
+    rc = bej_sink_init_mem(&s, 16);
+    assert(rc == 0);
+    rc = bej_decode_to_cbor(&s, bej, sz, &d, proj);
+    assert(rc == 0);
+    assert(s.len == 25 && !memcmp(s.buf, "\xBF\x6EMemoryLocation\xBF\x64Slot\x00\xFF\xFF", 25));
+    s.len = 0;
+    rc = bej_decode_to_msgpack(&s, bej, sz, &d, proj);
+    assert(rc == 0);
+    assert(s.len == 23 && !memcmp(s.buf, "\x81\xAEMemoryLocation\x81\xA4Slot\x00", 23));
+    bej_sink_free(&s);
+    bej_projection_free(proj);
+
+    /* Errors come back as from the JSON writer. */
+    rc = bej_sink_init_mem(&s, 16);
+    assert(rc == 0);
+    rc = bej_decode_to_cbor(&s, bej, sz - 1, &d, NULL);
+    assert(rc == -1);
+    s.len = 0;
+    rc = bej_decode_to_msgpack(&s, bej, sz - 1, &d, NULL);
+    assert(rc == -1);
+    bej_sink_free(&s);
+    free(bej);
+
+    /* Every integer width, reals, long strings, big containers and unknown names. */
+    bej_encoder_t* enc = bej_encoder_new(&d);
+    char src[16384];
+    size_t n = (size_t)snprintf(src, sizeof(src), "{\"Oem\": {\"_1\": -2.005, \"_2\": true, \"_3\": null,"
+        " \"_4\": [0, 127, 128, 255, 256, 65535, 65536, 4294967295, 4294967296, -1, -32, -33, -128, -129,"
+        " -32768, -32769, -2147483648, -2147483649, 9223372036854775807, -9223372036854775807],"
+        " \"_5\": [1.5, 0.1, -0.25, 3.14159265358979], \"_6\": \"a\\\"b\\\\c\\t\\u00e9\"");
+    for (int k = 7; k < 40; ++k) n += (size_t)snprintf(src + n, sizeof(src) - n, ", \"_%d\": \"%0*d\"", k, k * 9, k);
+    snprintf(src + n, sizeof(src) - n, "}, \"AllowedSpeedsMHz\": [%s]}",
+        "1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17");
+    rc = bej_encode(enc, src, strlen(src), &bej, &sz);
+    assert(rc == 0);
+    check_same(&d, bej, sz, NULL);
+    free(bej);
+    bej_encoder_free(enc);
+    dict_free(&d);
+    return 0;
+}
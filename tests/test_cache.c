@@ -0,0 +1,209 @@
+#include "bej_cache.h"
+#include "bej_encode.h"
+#include "dict.h"
+#include "io.h"
+#include "pool.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+typedef struct {
+    const uint8_t* bej;
+    size_t sz;
+    char*  want;
+} payload_t;
+
+static bej_cache_t* cache;
+static const bej_dictionary_t* dict;
+
+/* Decodes through the cache into a memory sink, or a file sink when @p to_file. */
+static void check(const payload_t* p, int to_file) {
+    bej_sink_t s;
+    FILE* f = NULL;
+    char buf[64];
+    int rc;
+    if (to_file) {
+        f = tmpfile();
+        assert(f);
+        rc = bej_sink_init_file(&s, f, buf, sizeof(buf));
+    }
+    else rc = bej_sink_init_mem(&s, 16);
+    assert(rc == 0);
+    bej_sink_putc(&s, '>');     /* output already in the sink stays in front */
+    rc = bej_cache_decode(cache, &s, p->bej, p->sz, dict);
+    assert(rc == 0);
+    size_t n = strlen(p->want);
+    if (to_file) {
+        rc = bej_sink_finish(&s);
+        assert(rc == 0);
+        char* got = (char*)malloc(n + 2);
+        assert(got);
+        rewind(f);
+        size_t got_len = fread(got, 1, n + 2, f);
+        assert(got_len == n + 1 && got[0] == '>' && !memcmp(got + 1, p->want, n));
+        free(got);
+        fclose(f);
+    }
+    else assert(s.len == n + 1 && s.buf[0] == '>' && !memcmp(s.buf + 1, p->want, n));
+    bej_sink_free(&s);
+}
+
+static void stats(size_t hits, size_t misses, size_t entries, size_t evictions) {
+    bej_cache_stats_t st;
+    bej_cache_stats(cache, &st);
+    assert(st.hits == hits && st.misses == misses && st.entries == entries && st.evictions == evictions);
+}
+
+#define NPAYLOADS 600
+
+static payload_t* many;
+
+static void hammer(void* ctx, size_t idx) {
+    size_t spread = *(const size_t*)ctx;
+    check(&many[idx * 7 % spread], idx % 3 == 0);
+}
+
+int main(void) {
+    bej_dictionary_t d, other;
+    int rc = dict_load(EXAMPLES_DIR "/Memory_v1.bin", &d);
+    assert(rc == 0);
+    rc = dict_load(EXAMPLES_DIR "/Memory_v1.bin", &other);
+    assert(rc == 0);
+    dict = &d;
+    uint8_t* bej = NULL; size_t sz = 0;
+    rc = read_file_all(EXAMPLES_DIR "/example.bej", &bej, &sz);
+    assert(rc == 0);
+    payload_t ex = { bej, sz, NULL };
+    rc = bej_decode_to_buffer(bej, sz, &d, &ex.want, NULL);
+    assert(rc == 0);
+
+    /* Misses fill the cache, hits come back byte for byte, through either kind of sink. */
+    rc = bej_cache_open(1 << 20, &cache);
+    assert(rc == 0);
+    check(&ex, 0);
+    stats(0, 1, 1, 0);
+    check(&ex, 0);
+    check(&ex, 1);
+    stats(2, 1, 1, 0);
+    bej_cache_clear(cache);
+    stats(2, 1, 0, 0);
+    check(&ex, 1);
+    check(&ex, 0);
+    stats(3, 2, 1, 0);
+
+    /* The key is the dictionary's content, not its address: a second copy hits... */
+    dict = &other;
+    check(&ex, 0);
+    stats(4, 2, 1, 0);
+
+    /* ...and another dictionary loaded into the same struct misses. */
+    size_t renamed_size = other.size;
+    uint8_t* renamed = (uint8_t*)malloc(renamed_size);
+    assert(renamed);
+    memcpy(renamed, other.bytes, renamed_size);
+    for (size_t i = 1; i < other.entry_count; ++i) {
+        const bej_dict_entry_t* e = &other.entries[i];
+        char quoted[64];
+        if (!e->name_off || e->name_len + 3u > sizeof(quoted)) continue;
+        snprintf(quoted, sizeof(quoted), "\"%s\"", dict_entry_name(&other, e));
+        if (strstr(ex.want, quoted)) { renamed[e->name_off] = 'X'; break; }
+    }
+    dict_free(&other);
+    rc = dict_load_mem(renamed, renamed_size, &other, NULL);
+    assert(rc == 0);
+    payload_t ex_renamed = { bej, sz, NULL };
+    rc = bej_decode_to_buffer(bej, sz, &other, &ex_renamed.want, NULL);
+    assert(rc == 0);
+    assert(strcmp(ex_renamed.want, ex.want) != 0);
+    check(&ex_renamed, 0);
+    stats(4, 3, 2, 0);
+    dict = &d;
+
+    /* Failed decodes fail as without the cache and are not kept. */
+    bej_sink_t s;
+    rc = bej_sink_init_mem(&s, 16);
+    assert(rc == 0);
+    rc = bej_cache_decode(cache, &s, bej, sz - 1, &d);
+    assert(rc == -1);
+    rc = bej_cache_decode(cache, &s, bej, sz - 1, &d);
+    assert(rc == -1);
+    bej_sink_free(&s);
+    stats(4, 5, 2, 0);
+    bej_cache_close(cache);
+
+    /* Payloads of the same size that differ by a byte are different entries. */
+    bej_encoder_t* enc = bej_encoder_new(&d);
+    many = (payload_t*)calloc(NPAYLOADS, sizeof(*many));
+    assert(many);
+    for (int i = 0; i < NPAYLOADS; ++i) {
+        char json[128];
+        snprintf(json, sizeof(json), "{\"Id\": \"m%03d\", \"CapacityMiB\": %d}", i, 1000 + i);
+        uint8_t* b = NULL;
+        rc = bej_encode(enc, json, strlen(json), &b, &many[i].sz);
+        assert(rc == 0);
+        many[i].bej = b;
+        rc = bej_decode_to_buffer(b, many[i].sz, &d, &many[i].want, NULL);
+        assert(rc == 0);
+    }
+    bej_encoder_free(enc);
+
+    /* LRU: a budget for about three entries keeps the three used last. */
+    rc = bej_cache_open(1, &cache);
+    assert(rc == 0);
+    check(&many[0], 0);
+    stats(0, 1, 0, 0);      /* nothing fits in a byte */
+    bej_cache_close(cache);
+    bej_cache_stats_t st;
+    rc = bej_cache_open(1 << 20, &cache);
+    assert(rc == 0);
+    check(&many[0], 0);
+    bej_cache_stats(cache, &st);
+    bej_cache_close(cache);
+    rc = bej_cache_open(st.bytes * 3 + st.bytes / 2, &cache);
+    assert(rc == 0);
+    for (int i = 0; i < 4; ++i) check(&many[i], 0);
+    stats(0, 4, 3, 1);                  /* 0 went */
+    check(&many[1], 0);                 /* 1 is now the most recent */
+    check(&many[4], 0);                 /* 2 goes */
+    stats(1, 5, 3, 2);
+    check(&many[1], 0);
+    check(&many[3], 0);
+    check(&many[4], 0);
+    stats(4, 5, 3, 2);
+    check(&many[2], 0);
+    stats(4, 6, 3, 3);
+    bej_cache_close(cache);
+
+    /* Many threads: hits and misses with evictions, then with the table growing. */
+    size_t spread = 16;
+    rc = bej_cache_open(st.bytes * 10, &cache);
+    assert(rc == 0);
+    rc = pool_run(4, 4000, hammer, &spread);
+    assert(rc == 0);
+    bej_cache_stats(cache, &st);
+    assert(st.hits + st.misses == 4000 && st.entries <= 10 && st.evictions > 0);
+    bej_cache_close(cache);
+    spread = NPAYLOADS;
+    rc = bej_cache_open(1 << 20, &cache);
+    assert(rc == 0);
+    rc = pool_run(4, 4 * NPAYLOADS, hammer, &spread);
+    assert(rc == 0);
+    bej_cache_stats(cache, &st);
+    assert(st.entries == NPAYLOADS && st.evictions == 0 && st.hits >= 3 * NPAYLOADS - 8);
+    bej_cache_close(cache);
+
+    for (int i = 0; i < NPAYLOADS; ++i) { free((void*)many[i].bej); free(many[i].want); }
+    free(many);
+    free(ex.want);
+    free(ex_renamed.want);
+    free(bej);
+    dict_free(&other);
+    free(renamed);
+    dict_free(&d);
+    return 0;
+}
@@ -0,0 +1,194 @@
+#define _POSIX_C_SOURCE 200809L
+#include "daemon.h"
+#include "io.h"
+#include "pool.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+static const char* sock_path = "test_daemon.sock";
+
+typedef struct {
+    const uint8_t* bej;
+    size_t sz;
+    const char* want;
+    const char* schema;
+} client_t;
+
+static void* run_server(void* srv) {
+    int rc = bejd_server_run((bejd_server_t*)srv);
+    assert(rc == 0);
+    return NULL;
+}
+
+/* Each client sends 50 requests on one connection. */
+static void client(void* ctx, size_t idx) {
+    int rc;
+    const client_t* c = (const client_t*)ctx + idx % 2;
+    int fd = bejd_connect(sock_path);
+    assert(fd >= 0);
+    bejd_reply_t reply = { 0 };
+    for (int i = 0; i < 50; ++i) {
+        rc = bejd_request(fd, c->schema, c->bej, c->sz, &reply);
+        assert(rc == 0);
+        assert(reply.status == 0 && reply.len == strlen(c->want) && !strcmp(reply.body, c->want));
+    }
+    close(fd);
+    bejd_reply_free(&reply);
+}
+
+static void load(const char* dict_path, const char* bej_path, bej_dictionary_t* d, client_t* c) {
+    uint8_t* bej = NULL; char* json = NULL;
+    int rc = dict_load(dict_path, d);
+    assert(rc == 0);
+    rc = read_file_all(bej_path, &bej, &c->sz);
+    assert(rc == 0);
+    rc = bej_decode_to_buffer(bej, c->sz, d, &json, NULL);
+    assert(rc == 0);
+    c->bej = bej;
+    c->want = json;
+}
+
+int main(void) {
+    bej_dictionary_t mem, proc;
+    client_t c[2] = { { .schema = "Memory" }, { .schema = "Processor" } };
+    load(EXAMPLES_DIR "/Memory_v1.bin", EXAMPLES_DIR "/example.bej", &mem, &c[0]);
+    load(EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/processor.bej", &proc, &c[1]);
+
+    /* One dictionary: schema keys are ignored. Errors pass the cache by. */
+    bej_cache_t* cache = NULL;
+    int rc = bej_cache_open(1 << 20, &cache);
+    assert(rc == 0);
+    bejd_opts_t opts = { .socket_path = sock_path, .dict = &mem, .threads = 3, .max_payload = 4096, .cache = cache,
+        .idle_timeout_ms = 300, .request_timeout_ms = 200 };
+    bejd_server_t* srv = NULL;
+    rc = bejd_server_open(&opts, &srv);
+    assert(rc == 0);
+    bejd_server_t* second = NULL;
+    rc = bejd_server_open(&opts, &second);
+    assert(rc == -1);    /* the socket is live */
+    pthread_t tid;
+    rc = pthread_create(&tid, NULL, run_server, srv);
+    assert(rc == 0);
+
+    int fd = bejd_connect(sock_path);
+    assert(fd >= 0);
+    bejd_reply_t reply = { 0 };
+    rc = bejd_request(fd, "Anything", c[0].bej, c[0].sz, &reply);
+    assert(rc == 0);
+    assert(reply.status == 0 && !strcmp(reply.body, c[0].want));
+    /* Errors come back as a status, the offset and a message; the connection stays usable. */
+    rc = bejd_request(fd, NULL, c[0].bej, c[0].sz - 1, &reply);
+    assert(rc == 0);
+    assert(reply.status == -1 && reply.offset > 0 && strstr(reply.body, "malformed"));
+    rc = bejd_request(fd, NULL, c[0].bej, c[0].sz, &reply);
+    assert(rc == 0 && reply.status == 0);
+    /* Oversized payloads are refused and the connection is closed. */
+    uint8_t* big = (uint8_t*)calloc(1, 1 << 20);
+    rc = bejd_request(fd, NULL, big, 1 << 20, &reply);
+    assert(rc == 0 && reply.status == BEJD_TOO_LARGE);
+    rc = bejd_request(fd, NULL, c[0].bej, c[0].sz, &reply);
+    assert(rc == -1);
+    close(fd);
+    free(big);
+
+    /* Garbage instead of a header. */
+    fd = bejd_connect(sock_path);
+    assert(fd >= 0);
+    ssize_t n = write(fd, "GET / HTTP/1.0\r\n", 16);
+    assert(n == 16);
+    uint8_t hdr[BEJD_HEADER_SIZE];
+    n = read(fd, hdr, sizeof(hdr));
+    assert(n == (ssize_t)sizeof(hdr) && !memcmp(hdr, "BEJR", 4));
+    close(fd);
+
+    /* Clients that stop mid-header or never send take every worker for a
+     * while; the timeouts drop them and the next client is served. */
+    int stalled[3];
+    for (int i = 0; i < 3; ++i) {
+        stalled[i] = bejd_connect(sock_path);
+        assert(stalled[i] >= 0);
+        if (i < 2) {
+            n = write(stalled[i], "BEJQ\0\0", 6);
+            assert(n == 6);
+        }
+    }
+    fd = bejd_connect(sock_path);
+    rc = bejd_request(fd, NULL, c[0].bej, c[0].sz, &reply);
+    assert(rc == 0 && reply.status == 0);
+    close(fd);
+    for (int i = 0; i < 3; ++i) {
+        n = read(stalled[i], hdr, sizeof(hdr));
+        assert(n == 0);     /* hung up on */
+        close(stalled[i]);
+    }
+
+    bejd_server_stop(srv);
+    rc = pthread_join(tid, NULL);
+    assert(rc == 0);
+    bejd_server_close(srv);
+    assert(access(sock_path, F_OK) != 0);
+
+    /* A bundle: each request picks its dictionary by schema key. */
+    const char* dicts[] = { EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/Memory_v1.bin" };
+    const char* bundle = "test_daemon.bejb";
+    rc = dict_bundle_write(bundle, dicts, 2);
+    assert(rc == 0);
+    dict_registry_t* reg = NULL;
+    rc = dict_registry_open(bundle, 0, &reg);
+    assert(rc == 0);
+    bej_cache_clear(cache);
+    bej_cache_stats_t st0, st;
+    bej_cache_stats(cache, &st0);
+    bejd_opts_t bopts = { .socket_path = sock_path, .registry = reg, .schema = "Memory", .threads = 4, .cache = cache };
+    rc = bejd_server_open(&bopts, &srv);
+    assert(rc == 0);
+    rc = pthread_create(&tid, NULL, run_server, srv);
+    assert(rc == 0);
+
+    rc = pool_run(4, 8, client, c);
+    assert(rc == 0);
+    fd = bejd_connect(sock_path);
+    rc = bejd_request(fd, NULL, c[0].bej, c[0].sz, &reply);
+    assert(rc == 0 && reply.status == 0);
+    assert(!strcmp(reply.body, c[0].want));
+    rc = bejd_request(fd, "Thermal", c[0].bej, c[0].sz, &reply);
+    assert(rc == 0);
+    assert(reply.status == BEJD_NO_SCHEMA && strstr(reply.body, "Thermal"));
+    close(fd);
+    /* 401 decodes of two distinct payloads: each is looked up once and
+     * missed at least once; how many workers miss together is up to timing. */
+    bej_cache_stats(cache, &st);
+    assert(st.entries == 2 && st.hits + st.misses - st0.hits - st0.misses == 401);
+    assert(st.misses - st0.misses >= 2);
+
+    /* Stopping does not wait for a request that never completes. */
+    fd = bejd_connect(sock_path);
+    assert(fd >= 0);
+    n = write(fd, "BEJQ", 4);
+    assert(n == 4);
+    struct timespec pause = { 0, 50 * 1000 * 1000 };
+    nanosleep(&pause, NULL);     /* let a worker take it */
+    bejd_server_stop(srv);
+    rc = pthread_join(tid, NULL);
+    assert(rc == 0);
+    close(fd);
+    bejd_server_close(srv);
+    dict_registry_close(reg);
+    bej_cache_close(cache);
+    remove(bundle);
+
+    bejd_reply_free(&reply);
+    for (int i = 0; i < 2; ++i) { free((void*)c[i].bej); free((void*)c[i].want); }
+    dict_free(&mem);
+    dict_free(&proc);
+    return 0;
+}
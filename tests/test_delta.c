@@ -0,0 +1,152 @@
+#include "bej_delta.h"
+#include "bej_encode.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+static bej_encoder_t* enc;
+
+static uint8_t* encode(const char* json, size_t* sz) {
+    uint8_t* bej = NULL;
+    int rc = bej_encode(enc, json, strlen(json), &bej, sz);
+    assert(rc == 0);
+    return bej;
+}
+
+static char* delta(const bej_dictionary_t* d, const uint8_t* prev, size_t psz,
+    const uint8_t* cur, size_t csz, int* rc) {
+    bej_sink_t s;
+    int err = bej_sink_init_mem(&s, 64);
+    assert(err == 0);
+    *rc = bej_decode_delta(&s, prev, psz, cur, csz, d);
+    char* out = bej_sink_take(&s, NULL);
+    assert(out);
+    bej_sink_free(&s);
+    return out;
+}
+
+/* JSON text without the whitespace between tokens. */
+static void compact(char* s) {
+    char* o = s;
+    for (int in_str = 0; *s; ++s) {
+        if (in_str && *s == '\\') { *o++ = *s++; *o++ = *s; continue; }
+        if (*s == '"') in_str = !in_str;
+        if (in_str || !strchr(" \n\t\r", *s)) *o++ = *s;
+    }
+    *o = '\0';
+}
+
+static void check(const bej_dictionary_t* d, const char* prev_json, const char* cur_json, const char* want) {
+    size_t psz, csz;
+    uint8_t* prev = encode(prev_json, &psz);
+    uint8_t* cur = encode(cur_json, &csz);
+    int rc;
+    char* got = delta(d, prev, psz, cur, csz, &rc);
+    assert(rc == 0);
+    compact(got);
+    if (strcmp(got, want)) fprintf(stderr, "%s\n%s\n", got, want);
+    assert(!strcmp(got, want));
+    free(got);
+    free(cur);
+    free(prev);
+}
+
+int main(void) {
+    bej_dictionary_t d;
+    int rc = dict_load(EXAMPLES_DIR "/Memory_v1.bin", &d);
+    assert(rc == 0);
+    enc = bej_encoder_new(&d);
+    uint8_t* bej = NULL; size_t sz = 0;
+    rc = read_file_all(EXAMPLES_DIR "/example.bej", &bej, &sz);
+    assert(rc == 0);
+
+    /* Nothing changed. */
+    char* got = delta(&d, bej, sz, bej, sz, &rc);
+    assert(rc == 0 && !strcmp(got, "{}"));
+    free(got);
+
+    /* Everything added: the patch is the full decode, layout included. */
+    size_t esz;
+    uint8_t* empty = encode("{}", &esz);
+    got = delta(&d, empty, esz, bej, sz, &rc);
+    char* full = NULL; size_t full_len = 0;
+    rc = bej_decode_to_buffer(bej, sz, &d, &full, &full_len);
+    assert(rc == 0);
+    assert(rc == 0 && !strcmp(got, full));
+    free(full);
+    free(got);
+
+    /* Everything removed. */
+    got = delta(&d, bej, sz, empty, esz, &rc);
+    compact(got);
+    assert(rc == 0 && !strcmp(got, "{\"CapacityMiB\":null,\"DataWidthBits\":null,\"AllowedSpeedsMHz\":null,"
+        "\"ErrorCorrection\":null,\"MemoryLocation\":null}"));
+    free(got);
+
+    const char* base = "{\"Id\": \"m\", \"CapacityMiB\": 65536, \"AllowedSpeedsMHz\": [2400, 3200],"
+        " \"ErrorCorrection\": \"NoECC\", \"MemoryLocation\": {\"Channel\": 0, \"Slot\": 0},"
+        " \"Oem\": {\"_1\": {\"_1\": 1, \"_2\": \"x\"}, \"_2\": true}}";
+    /* Changed leaves, deep in sets; unchanged siblings stay out. */
+    check(&d, base, "{\"Id\": \"m\", \"CapacityMiB\": 32768, \"AllowedSpeedsMHz\": [2400, 3200],"
+        " \"ErrorCorrection\": \"SingleBitECC\", \"MemoryLocation\": {\"Channel\": 0, \"Slot\": 1},"
+        " \"Oem\": {\"_1\": {\"_1\": 1, \"_2\": \"y\"}, \"_2\": true}}",
+        "{\"CapacityMiB\":32768,\"ErrorCorrection\":\"SingleBitECC\",\"MemoryLocation\":{\"Slot\":1},"
+        "\"Oem\":{\"_1\":{\"BaseModuleType\":\"y\"}}}");
+    /* Arrays are replaced whole; added and removed members; a new type. */
+    check(&d, base, "{\"Id\": \"m\", \"CapacityMiB\": 65536, \"AllowedSpeedsMHz\": [2400, 3200, 4800],"
+        " \"ErrorCorrection\": \"NoECC\", \"MemoryLocation\": {\"Channel\": 0},"
+        " \"Oem\": {\"_1\": \"flat\", \"_2\": true, \"_3\": null}, \"DataWidthBits\": 64}",
+        "{\"AllowedSpeedsMHz\":[2400,3200,4800],\"MemoryLocation\":{\"Slot\":null},"
+        "\"Oem\":{\"_1\":\"flat\",\"_3\":null},\"DataWidthBits\":64}");
+    /* Members in another order pair up by seq; a set that only moved is unchanged. */
+    check(&d, base, "{\"Oem\": {\"_2\": true, \"_1\": {\"_2\": \"x\", \"_1\": 1}},"
+        " \"MemoryLocation\": {\"Channel\": 0, \"Slot\": 0}, \"ErrorCorrection\": \"NoECC\","
+        " \"AllowedSpeedsMHz\": [2400, 3200], \"CapacityMiB\": 65535, \"Id\": \"m\"}",
+        "{\"CapacityMiB\":65535}");
+    /* Sets the dictionary does not describe are named as the full decode names them. */
+    check(&d, "{\"Oem\": {\"_7\": {\"_2\": \"a\", \"_3\": 1}}}", "{\"Oem\": {\"_7\": {\"_2\": \"b\", \"_3\": 1}}}",
+        "{\"Oem\":{\"_7\":{\"BaseModuleType\":\"b\"}}}");
+    /* Repeated seqs pair up in order. */
+    check(&d, "{\"Oem\": {\"_5\": 1, \"_5\": 2}}", "{\"Oem\": {\"_5\": 1, \"_5\": 3, \"_5\": 4}}",
+        "{\"Oem\":{\"_5\":3,\"_5\":4}}");
+
+    /* Damaged and unsupported payloads, either side. */
+    got = delta(&d, bej, sz, bej, sz - 1, &rc);
+    assert(rc == -1);
+    free(got);
+    got = delta(&d, bej, 5, bej, sz, &rc);
+    assert(rc == -1);
+    free(got);
+    uint8_t* bad = (uint8_t*)malloc(sz);
+    assert(bad);
+    memcpy(bad, bej, sz);
+    bad[6] = 7;
+    got = delta(&d, bad, sz, bej, sz, &rc);
+    assert(rc == -2);
+    free(got);
+    /* Any damaged byte, on either side, fails cleanly or gives a patch. */
+    bad[6] = bej[6];
+    for (size_t i = 7; i < sz; ++i) {
+        bad[i] ^= 0x5A;
+        for (int side = 0; side < 2; ++side) {
+            got = side ? delta(&d, bej, sz, bad, sz, &rc) : delta(&d, bad, sz, bej, sz, &rc);
+            assert(rc <= 0 && rc >= -3);
+            free(got);
+        }
+        bad[i] = bej[i];
+    }
+    free(bad);
+
+    free(empty);
+    free(bej);
+    bej_encoder_free(enc);
+    dict_free(&d);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "dict.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+static void check_same(const bej_dictionary_t* a, const bej_dictionary_t* b) {
+    assert(a->entry_count == b->entry_count);
+    assert(a->schema_version == b->schema_version);
+    for (int p = -1; p < (int)a->entry_count; ++p) {
+        dict_subset_t sa = dict_children(a, p), sb = dict_children(b, p);
+        assert(sa.count == sb.count);
+        for (uint16_t k = 0; k < sa.count; ++k) {
+            const bej_dict_entry_t* ea = &sa.list[k];
+            const bej_dict_entry_t* eb = dict_child_by_seq(&sb, ea->seq);
+            assert(eb && eb->format == ea->format && eb->child_count == ea->child_count);
+            assert(eb->name_len == ea->name_len);
+            if (ea->name_off) assert(memcmp(dict_entry_name(a, ea), dict_entry_name(b, eb), ea->name_len + 1) == 0);
+            else assert(!eb->name_off);
+            size_t ka_len, kb_len;
+            const char* ka = dict_entry_key(a, ea, &ka_len);
+            const char* kb = dict_entry_key(b, eb, &kb_len);
+            if (ka && kb) assert(ka_len == kb_len && !memcmp(ka, kb, ka_len));
+        }
+    }
+}
+
+/* Every named entry's key is the quoted name and ": ". */
+static void check_keys(const bej_dictionary_t* d) {
+    for (uint16_t i = 0; i < d->entry_count; ++i) {
+        const bej_dict_entry_t* e = &d->entries[i];
+        size_t n = 0;
+        const char* key = dict_entry_key(d, e, &n);
+        if (!e->name_off) { assert(!key); continue; }
+        assert(key && n == e->name_len + 4u && key[0] == '"');
+        assert(!memcmp(key + 1, dict_entry_name(d, e), e->name_len) && !memcmp(key + n - 3, "\": ", 3));
+    }
+}
+
+int main(void) {
+    int rc;
+    const char* dicts[] = { EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/Memory_v1.bin" };
+    for (size_t i = 0; i < sizeof(dicts) / sizeof(dicts[0]); ++i) {
+        bej_dictionary_t raw;
+        rc = dict_load(dicts[i], &raw);
+        assert(rc == 0);
+        check_keys(&raw);
+
+        uint8_t* img = NULL; size_t img_sz = 0;
+        rc = dict_image_build(&raw, &img, &img_sz);
+        assert(rc == 0);
+
+        bej_dictionary_t compiled = { 0 };
+        compiled.bytes = img;
+        compiled.size = img_sz;
+        rc = dict_image_attach(&compiled);
+        assert(rc == 0);
+        check_keys(&compiled);
+        check_same(&raw, &compiled);
+        assert(compiled.keys > (const char*)img && compiled.keys < (const char*)img + img_sz);
+        rc = dict_build_keys(&compiled);
+        assert(rc == -1);
+
+        /* Any flipped bit after the header must trip the checksum. */
+        img[img_sz / 2] ^= 0x40;
+        bej_dictionary_t corrupt = { 0 };
+        corrupt.bytes = img;
+        corrupt.size = img_sz;
+        rc = dict_image_attach(&corrupt);
+        assert(rc != 0);
+
+        free(img);
+        dict_free(&raw);
+    }
+    /* Names are escaped once, when the keys are built. */
+    uint8_t* buf = NULL; size_t sz = 0;
+    bej_dictionary_t d;
+    rc = dict_load(dicts[1], &d);
+    assert(rc == 0);
+    sz = d.size;
+    buf = (uint8_t*)malloc(sz);
+    assert(buf);
+    memcpy(buf, d.bytes, sz);
+    const bej_dict_entry_t* root = &d.entries[0];
+    buf[root->name_off] = '"';
+    buf[root->name_off + 1] = '\n';
+    dict_free(&d);
+    rc = dict_load_mem(buf, sz, &d, NULL);
+    assert(rc == 0);
+    size_t n = 0;
+    const char* key = dict_entry_key(&d, &d.entries[0], &n);
+    assert(key && n == d.entries[0].name_len + 6u && !memcmp(key, "\"\\\"\\n", 5));
+    dict_free(&d);
+    free(buf);
+    puts("OK");
+    return 0;
+}
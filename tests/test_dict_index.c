@@ -0,0 +1,91 @@
+#include "dict.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+static const bej_dict_entry_t* linear_lookup(const dict_subset_t* sub, uint16_t seq) {
+    for (uint16_t i = 0; i < sub->count; ++i) {
+        if (sub->list[i].seq == seq) return &sub->list[i];
+    }
+    return NULL;
+}
+
+static void check_all(const bej_dictionary_t* d) {
+    for (int p = -1; p < (int)d->entry_count; ++p) {
+        dict_subset_t sub = dict_children(d, p);
+        if (!sub.list) continue;
+        for (uint32_t seq = 0; seq <= 0xFFFF; ++seq) {
+            assert(dict_child_by_seq(&sub, (uint16_t)seq) == linear_lookup(&sub, (uint16_t)seq));
+        }
+    }
+}
+
+static void check_dict(const char* path, size_t budget) {
+    bej_dictionary_t d;
+    dict_load_opts_t opts = { .seq_index_budget = budget, .no_seq_tables = budget == 0 };
+    int rc = dict_load_ex(path, &d, &opts);
+    assert(rc == 0);
+    check_all(&d);
+    dict_free(&d);
+}
+
+/* Real dictionaries number children contiguously, so build one that forces
+ * the DIRECT (small gaps) and HASH (sparse) table forms. */
+static void check_synthetic(void) {
+    enum { N = 40 };
+    bej_dict_entry_t entries[1 + 2 * N] = { 0 };
+    bej_dictionary_t d = { 0 };
+    d.entries = entries;
+    d.entry_count = 1 + 2 * N;
+    entries[0].child_first_idx = 1;
+    entries[0].child_count = N;
+    for (int i = 0; i < N; ++i) {
+        entries[1 + i].seq = (uint16_t)(i * 3);
+        entries[1 + i].child_first_idx = i == 0 ? 1 + N : -1;
+        entries[1 + i].child_count = i == 0 ? N : 0;
+        entries[1 + N + i].seq = (uint16_t)(i * 1601 + 7);
+        entries[1 + N + i].child_first_idx = -1;
+    }
+    int rc = dict_build_seq_index(&d, (size_t)-1);
+    assert(rc == 0);
+    assert(d.seq_index[0].kind == BEJ_SEQ_IDX_DIRECT);
+    assert(d.seq_index[1].kind == BEJ_SEQ_IDX_HASH);
+    check_all(&d);
+
+    rc = dict_build_seq_index(&d, 0);
+    assert(rc == 0);
+    assert(d.seq_index[0].kind == BEJ_SEQ_IDX_NONE && d.seq_pool_len == 0);
+    check_all(&d);
+
+    free((void*)d.seq_index);
+    free((void*)d.seq_pool);
+}
+
+int main(void) {
+    int rc;
+    const char* dicts[] = { EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/Memory_v1.bin" };
+    for (size_t i = 0; i < sizeof(dicts) / sizeof(dicts[0]); ++i) {
+        check_dict(dicts[i], DICT_SEQ_INDEX_BUDGET_DEFAULT);
+        check_dict(dicts[i], 0);
+
+        /* Zeroed options load exactly as NULL ones do. */
+        bej_dictionary_t a, z;
+        dict_load_opts_t zero = { 0 };
+        rc = dict_load(dicts[i], &a);
+        assert(rc == 0);
+        rc = dict_load_ex(dicts[i], &z, &zero);
+        assert(rc == 0);
+        assert(a.bytes_mapped == z.bytes_mapped && a.seq_pool_len == z.seq_pool_len);
+        assert(!memcmp(a.seq_index, z.seq_index, a.entry_count * sizeof(bej_seq_index_t)));
+        dict_free(&a);
+        dict_free(&z);
+    }
+    check_synthetic();
+    puts("OK");
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "bej_dict_memory.h"
+#include "bej_dict_processor.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+/* The built-in tables answer every lookup as the loaded dictionary does. */
+static void check_tables(const bej_dictionary_t* built_in, const char* dict_path) {
+    bej_dictionary_t d;
+    int rc = dict_load(dict_path, &d);
+    assert(rc == 0);
+    assert(built_in->entry_count == d.entry_count && built_in->schema_version == d.schema_version);
+    assert(built_in->seq_pool_len == d.seq_pool_len);
+    for (uint16_t i = 0; i < d.entry_count; ++i) {
+        const bej_dict_entry_t* a = &d.entries[i];
+        const bej_dict_entry_t* b = &built_in->entries[i];
+        assert(a->format == b->format && a->flags == b->flags && a->seq == b->seq);
+        assert(a->child_first_idx == b->child_first_idx && a->child_count == b->child_count);
+        assert(a->name_len == b->name_len && !a->name_off == !b->name_off);
+        if (a->name_off) assert(!strcmp(dict_entry_name(&d, a), dict_entry_name(built_in, b)));
+        size_t ka_len = 0, kb_len = 0;
+        const char* ka = dict_entry_key(&d, a, &ka_len);
+        const char* kb = dict_entry_key(built_in, b, &kb_len);
+        assert(!ka == !kb && ka_len == kb_len && (!ka || !memcmp(ka, kb, ka_len)));
+        dict_subset_t sa = dict_children(&d, i), sb = dict_children(built_in, i);
+        assert(sa.count == sb.count);
+        for (uint16_t k = 0; k < sa.count; ++k)
+            assert(dict_child_by_seq(&sb, sa.list[k].seq) - built_in->entries == dict_child_by_seq(&sa, sa.list[k].seq) - d.entries);
+    }
+    dict_free(&d);
+}
+
+static void check_decode(const bej_dictionary_t* built_in, const char* bej_path, const char* json_path) {
+    uint8_t* bej = NULL; size_t sz = 0;
+    uint8_t* want = NULL; size_t want_sz = 0;
+    char* json = NULL; size_t len = 0;
+    int rc = read_file_all(bej_path, &bej, &sz);
+    assert(rc == 0);
+    rc = read_file_all(json_path, &want, &want_sz);
+    assert(rc == 0);
+    rc = bej_decode_to_buffer(bej, sz, built_in, &json, &len);
+    assert(rc == 0);
+    assert(len == want_sz && !memcmp(json, want, len));
+    free(json);
+    free(want);
+    free(bej);
+}
+
+int main(void) {
+    check_tables(&bej_dict_memory, EXAMPLES_DIR "/Memory_v1.bin");
+    check_tables(&bej_dict_processor, EXAMPLES_DIR "/Processor_v1.bin");
+    check_decode(&bej_dict_memory, EXAMPLES_DIR "/example.bej", EXAMPLES_DIR "/example_decoded.json");
+    check_decode(&bej_dict_processor, EXAMPLES_DIR "/processor.bej", EXAMPLES_DIR "/processor_decoded.json");
+    return 0;
+}
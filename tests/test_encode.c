@@ -0,0 +1,142 @@
+#include "bej_encode.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+static int encode(bej_encoder_t* enc, const char* json, uint8_t** bej, size_t* sz) {
+    return bej_encode(enc, json, strlen(json), bej, sz);
+}
+
+/* JSON -> BEJ -> JSON must give back the same text. */
+static void round_trip(const bej_dictionary_t* d, bej_encoder_t* enc, const char* json) {
+    uint8_t* bej = NULL; size_t sz = 0;
+    int rc = encode(enc, json, &bej, &sz);
+    assert(rc == 0);
+    char* back = NULL; size_t back_len = 0;
+    rc = bej_decode_to_buffer(bej, sz, d, &back, &back_len);
+    assert(rc == 0);
+    assert(back_len == strlen(json) && memcmp(back, json, back_len) == 0);
+    free(back);
+    free(bej);
+}
+
+int main(void) {
+    int rc;
+    const char* dicts[] = { EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/Memory_v1.bin" };
+    const char* payloads[] = { EXAMPLES_DIR "/processor.bej", EXAMPLES_DIR "/example.bej" };
+    for (size_t i = 0; i < 2; ++i) {
+        bej_dictionary_t d;
+        rc = dict_load(dicts[i], &d);
+        assert(rc == 0);
+        bej_encoder_t* enc = bej_encoder_new(&d);
+        assert(enc);
+
+        /* BEJ -> JSON -> BEJ reproduces the sample payloads byte for byte. */
+        uint8_t* orig = NULL; size_t orig_sz = 0;
+        rc = read_file_all(payloads[i], &orig, &orig_sz);
+        assert(rc == 0);
+        char* json = NULL; size_t json_len = 0;
+        rc = bej_decode_to_buffer(orig, orig_sz, &d, &json, &json_len);
+        assert(rc == 0);
+        uint8_t* bej = NULL; size_t sz = 0;
+        rc = bej_encode(enc, json, json_len, &bej, &sz);
+        assert(rc == 0);
+        assert(sz == orig_sz && memcmp(bej, orig, sz) == 0);
+        free(bej);
+        free(json);
+        free(orig);
+
+        bej_encoder_free(enc);
+        dict_free(&d);
+    }
+
+    bej_dictionary_t d;
+    rc = dict_load(dicts[1], &d);
+    assert(rc == 0);
+    bej_encoder_t* enc = bej_encoder_new(&d);
+
+    /* Every value kind, escapes, wide integers, reals and unnamed "_<seq>" keys. */
+    round_trip(&d, enc,
+        "{\n"
+        "  \"CapacityMiB\": -129,\n"
+        "  \"BusWidthBits\": 9223372036854775807,\n"
+        "  \"Description\": \"tab\\there \\\"q\\\" \\u0001 caf\xc3\xa9\",\n"
+        "  \"IsRankSpareEnabled\": true,\n"
+        "  \"IsSpareDeviceEnabled\": false,\n"
+        "  \"Manufacturer\": null,\n"
+        "  \"ErrorCorrection\": \"MultiBitECC\",\n"
+        "  \"AllowedSpeedsMHz\": [\n"
+        "    1,\n"
+        "    -1\n"
+        "  ],\n"
+        "  \"MemoryLocation\": {\n"
+        "    \"Channel\": 3\n"
+        "  },\n"
+        "  \"Oem\": {},\n"
+        "  \"_900\": [],\n"
+        "  \"_901\": 1.0025e-3\n"
+        "}");
+
+    uint8_t* bej = NULL; size_t sz = 0;
+    /* \u escapes decode to UTF-8, including surrogate pairs. */
+    rc = encode(enc, "{\"Id\": \"\\u00e9\\ud83d\\ude00\"}", &bej, &sz);
+    assert(rc == 0);
+    char* back = NULL;
+    rc = bej_decode_to_buffer(bej, sz, &d, &back, NULL);
+    assert(rc == 0);
+    assert(strcmp(back, "{\n  \"Id\": \"\xc3\xa9\xf0\x9f\x98\x80\"\n}") == 0);
+    free(back);
+    free(bej);
+
+    /* Negative reals between -1 and 0 keep their sign: the digits move into
+     * the whole part, and the decoded form encodes back to the same bytes. */
+    static const char* const negs[][2] = {
+        { "-0.5", "-5.0e-1" }, { "-0.0025e3", "-25.0e-1" }, { "-0.1e-2", "-1.0e-3" }, { "-0.0", "0.0" },
+    };
+    for (size_t i = 0; i < sizeof(negs) / sizeof(negs[0]); ++i) {
+        char json[64], want[64];
+        snprintf(json, sizeof(json), "{\"Oem\": {\"_5\": %s}}", negs[i][0]);
+        snprintf(want, sizeof(want), "{\n  \"Oem\": {\n    \"_5\": %s\n  }\n}", negs[i][1]);
+        rc = encode(enc, json, &bej, &sz);
+        assert(rc == 0);
+        rc = bej_decode_to_buffer(bej, sz, &d, &back, NULL);
+        assert(rc == 0);
+        assert(strcmp(back, want) == 0);
+        free(back);
+        free(bej);
+        round_trip(&d, enc, want);
+    }
+
+    /* Malformed JSON, then values the dictionary cannot take. */
+    rc = encode(enc, "{\"Id\": \"x\"", &bej, &sz);
+    assert(rc == -1);
+    rc = encode(enc, "{\"Id\": 01}", &bej, &sz);
+    assert(rc == -1);
+    rc = encode(enc, "{\"Id\": \"x\"} x", &bej, &sz);
+    assert(rc == -1);
+    rc = encode(enc, "{\"NoSuchProperty\": 1}", &bej, &sz);
+    assert(rc == -2);
+    assert(bej_encoder_offset(enc) == 1);
+    rc = encode(enc, "{\"ErrorCorrection\": \"NoSuchValue\"}", &bej, &sz);
+    assert(rc == -2);
+    rc = encode(enc, "{\"CapacityMiB\": \"text\"}", &bej, &sz);
+    assert(rc == -2);
+    rc = encode(enc, "{\"CapacityMiB\": 1.5}", &bej, &sz);
+    assert(rc == -2);
+    rc = encode(enc, "{\"@odata.id\": \"/x\"}", &bej, &sz);
+    assert(rc == -2);
+    rc = encode(enc, "[1]", &bej, &sz);
+    assert(rc == -2);
+    assert(!bej);
+
+    bej_encoder_free(enc);
+    dict_free(&d);
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "json_escape.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The original per-character escaper, kept as the reference output. */
+static void reference_escape(bej_sink_t* out, const char* s, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)s[i];
+        switch (c) {
+        case '\"': bej_sink_puts(out, "\\\""); break;
+        case '\\': bej_sink_puts(out, "\\\\"); break;
+        case '\b': bej_sink_puts(out, "\\b"); break;
+        case '\f': bej_sink_puts(out, "\\f"); break;
+        case '\n': bej_sink_puts(out, "\\n"); break;
+        case '\r': bej_sink_puts(out, "\\r"); break;
+        case '\t': bej_sink_puts(out, "\\t"); break;
+        default:
+            if (c < 0x20) {
+                char u[7];
+                snprintf(u, sizeof(u), "\\u%04x", c);
+                bej_sink_puts(out, u);
+            }
+            else bej_sink_putc(out, (char)c);
+        }
+    }
+}
+
+static char* escape_with(void (*fn)(bej_sink_t*, const char*, size_t), const char* s, size_t n, size_t* len) {
+    bej_sink_t sink;
+    int rc = bej_sink_init_mem(&sink, 64);
+    assert(rc == 0);
+    fn(&sink, s, n);
+    char* r = bej_sink_take(&sink, len);
+    bej_sink_free(&sink);
+    assert(r);
+    return r;
+}
+
+int main(void) {
+    static const char alphabet[] = "abcXYZ019 -_.:/{}\"\\\n\t\r\b\f\x01\x1f\x7f\x80\xc3\xa9\xff";
+    const int impls[] = { JSON_ESCAPE_SCALAR, JSON_ESCAPE_SSE2, JSON_ESCAPE_AVX2 };
+    char buf[600];
+    unsigned seed = 12345;
+
+    for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); ++k) {
+        if (json_escape_select(impls[k]) != 0) {
+            printf("escape kernel %d not available, skipped\n", impls[k]);
+            continue;
+        }
+        for (int round = 0; round < 4000; ++round) {
+            size_t n = (size_t)(round % 300);
+            /* Mostly clean text with the occasional special byte at any position. */
+            int density = 1 + round % 97;
+            for (size_t i = 0; i < n; ++i) {
+                seed = seed * 1103515245u + 12345u;
+                unsigned r = seed >> 16;
+                buf[i] = (int)(r % 100) < density ? alphabet[r % (sizeof(alphabet) - 1)] : (char)('a' + r % 26);
+            }
+            /* Misaligned starts exercise partial vectors at both ends. */
+            size_t off = (size_t)round % 7 < n ? (size_t)round % 7 : 0;
+            size_t want_len, got_len;
+            char* want = escape_with(reference_escape, buf + off, n - off, &want_len);
+            char* got = escape_with(json_escape_run, buf + off, n - off, &got_len);
+            assert(got_len == want_len && memcmp(got, want, want_len) == 0);
+            free(want);
+            free(got);
+
+            size_t first = json_escape_scan(buf, n);
+            size_t expect = 0;
+            while (expect < n && !((unsigned char)buf[expect] < 0x20 || buf[expect] == '"' || buf[expect] == '\\')) ++expect;
+            assert(first == expect);
+        }
+    }
+    int rc = json_escape_select(JSON_ESCAPE_AUTO);
+    assert(rc == 0);
+    printf("escape kernel: %s\n", json_escape_impl());
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "bej_encode.h"
+#include "bej_index.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+/* Renders @p pointer through @p dom; returns the malloc'd JSON, or NULL with the lookup code in @p rc. */
+static char* render(const bej_dom_t* dom, const char* pointer, int* rc) {
+    bej_dom_node_t node;
+    *rc = bej_dom_lookup(dom, pointer, &node);
+    if (*rc != 0) return NULL;
+    bej_sink_t sink;
+    int err = bej_sink_init_mem(&sink, 64);
+    assert(err == 0);
+    err = bej_dom_render(dom, &node, &sink);
+    assert(err == 0);
+    char* json = bej_sink_take(&sink, NULL);
+    bej_sink_free(&sink);
+    return json;
+}
+
+static void expect(const bej_dom_t* dom, const char* pointer, const char* want) {
+    int rc;
+    char* json = render(dom, pointer, &rc);
+    assert(json && rc == 0);
+    if (strcmp(json, want) != 0) fprintf(stderr, "%s: got\n%s\nwant\n%s\n", pointer, json, want);
+    assert(strcmp(json, want) == 0);
+    free(json);
+}
+
+int main(void) {
+    int rc;
+    const char* dicts[] = { EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/Memory_v1.bin" };
+    const char* payloads[] = { EXAMPLES_DIR "/processor.bej", EXAMPLES_DIR "/example.bej" };
+    for (size_t i = 0; i < 2; ++i) {
+        bej_dictionary_t d;
+        rc = dict_load(dicts[i], &d);
+        assert(rc == 0);
+        uint8_t* bej = NULL; size_t sz = 0;
+        rc = read_file_all(payloads[i], &bej, &sz);
+        assert(rc == 0);
+        bej_index_t* idx = NULL;
+        rc = bej_index_build(bej, sz, &idx);
+        assert(rc == 0);
+
+        /* The root renders as the full decode; so does each member on its own. */
+        bej_dom_t dom;
+        rc = bej_dom_init(&dom, idx, bej, sz, &d);
+        assert(rc == 0);
+        char* full = NULL;
+        rc = bej_decode_to_buffer(bej, sz, &d, &full, NULL);
+        assert(rc == 0);
+        int rc;
+        char* json = render(&dom, "", &rc);
+        assert(json && !strcmp(json, full));
+        free(json);
+        bej_dom_node_t root, member;
+        bej_dom_root(&dom, &root);
+        assert(bej_dom_format(&dom, &root) == BEJ_FMT_SET && bej_dom_count(&dom, &root) > 0);
+        for (size_t k = 0; k < bej_dom_count(&dom, &root); ++k) {
+            rc = bej_dom_child(&dom, &root, k, &member);
+            assert(rc == 0);
+            bej_sink_t sink;
+            rc = bej_sink_init_mem(&sink, 64);
+            assert(rc == 0);
+            rc = bej_dom_render(&dom, &member, &sink);
+            assert(rc == 0);
+            char* value = bej_sink_take(&sink, NULL);
+            bej_sink_free(&sink);
+            if (bej_dom_format(&dom, &member) != BEJ_FMT_SET && bej_dom_format(&dom, &member) != BEJ_FMT_ARRAY)
+                assert(strstr(full, value));
+            free(value);
+        }
+        rc = bej_dom_child(&dom, &root, bej_dom_count(&dom, &root), &member);
+        assert(rc == BEJ_DOM_ABSENT);
+        free(full);
+
+        /* Save/load round trip, bound to the payload size. */
+        uint8_t* blob = NULL; size_t blob_len = 0;
+        rc = bej_index_save(idx, &blob, &blob_len);
+        assert(rc == 0);
+        bej_index_t* loaded = NULL;
+        rc = bej_index_load(blob, blob_len, sz + 1, &loaded);
+        assert(rc == -1 && !loaded);
+        rc = bej_index_load(blob, blob_len - 1, sz, &loaded);
+        assert(rc == -1);
+        rc = bej_index_load(blob, blob_len, sz, &loaded);
+        assert(rc == 0);
+        uint8_t* again = NULL; size_t again_len = 0;
+        rc = bej_index_save(loaded, &again, &again_len);
+        assert(rc == 0);
+        assert(again_len == blob_len && !memcmp(again, blob, blob_len));
+        /* A container that lists itself as its child is rejected. */
+        size_t ncont = 0;
+        bej_index_counts(idx, &ncont, NULL);
+        uint8_t* first_kid = blob + 28 + ncont * 12;
+        first_kid[0] = first_kid[1] = first_kid[2] = 0; first_kid[3] = 0x80;
+        bej_index_t* bad = NULL;
+        rc = bej_index_load(blob, blob_len, sz, &bad);
+        assert(rc == -1);
+        free(again); free(blob);
+        bej_index_free(loaded);
+
+        /* Truncated payloads do not index. */
+        for (size_t cut = 0; cut < sz; ++cut) {
+            bej_index_t* t = NULL;
+            rc = bej_index_build(bej, cut, &t);
+            assert(rc == -1 && !t);
+        }
+        bej_index_free(idx);
+        free(bej);
+        dict_free(&d);
+    }
+
+    bej_dictionary_t d;
+    rc = dict_load(dicts[1], &d);
+    assert(rc == 0);
+    uint8_t* bej = NULL; size_t sz = 0;
+    rc = read_file_all(payloads[1], &bej, &sz);
+    assert(rc == 0);
+    bej_index_t* idx = NULL;
+    rc = bej_index_build(bej, sz, &idx);
+    assert(rc == 0);
+    bej_dom_t dom;
+    rc = bej_dom_init(&dom, idx, bej, sz, &d);
+    assert(rc == 0);
+    rc = bej_dom_init(&dom, idx, bej, sz - 1, &d);
+    assert(rc == -1);
+    expect(&dom, "/MemoryLocation/Channel", "0");
+    expect(&dom, "/MemoryLocation", "{\n  \"Channel\": 0,\n  \"Slot\": 0\n}");
+    expect(&dom, "/AllowedSpeedsMHz/1", "3200");
+    expect(&dom, "/ErrorCorrection", "\"NoECC\"");
+    static const struct { const char* pointer; int rc; } misses[] = {
+        { "/AllowedSpeedsMHz/2", BEJ_DOM_ABSENT }, { "/Id", BEJ_DOM_ABSENT },
+        { "/Nope", -2 }, { "/CapacityMiB/0", -2 }, { "/AllowedSpeedsMHz/x", -2 },
+    };
+    for (size_t k = 0; k < sizeof(misses) / sizeof(misses[0]); ++k) {
+        char* none = render(&dom, misses[k].pointer, &rc);
+        assert(!none && rc == misses[k].rc);
+    }
+    bej_index_free(idx);
+    free(bej);
+
+    /* Members written out of seq order are still found. */
+    bej_encoder_t* enc = bej_encoder_new(&d);
+    const char* src = "{\"MemoryLocation\": {\"Slot\": 2, \"Channel\": 1}, \"Id\": \"m\", \"CapacityMiB\": 4}";
+    rc = bej_encode(enc, src, strlen(src), &bej, &sz);
+    assert(rc == 0);
+    rc = bej_index_build(bej, sz, &idx);
+    assert(rc == 0);
+    rc = bej_dom_init(&dom, idx, bej, sz, &d);
+    assert(rc == 0);
+    expect(&dom, "/CapacityMiB", "4");
+    expect(&dom, "/Id", "\"m\"");
+    expect(&dom, "/MemoryLocation/Channel", "1");
+    expect(&dom, "/MemoryLocation/Slot", "2");
+    bej_index_free(idx);
+    free(bej);
+    bej_encoder_free(enc);
+    dict_free(&d);
+    return 0;
+}
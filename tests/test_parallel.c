@@ -0,0 +1,126 @@
+#include "bej_encode.h"
+#include "bej_stats.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+static char* decode(const bej_dictionary_t* d, const uint8_t* bej, size_t sz, int threads, int* rc,
+    bej_stats_t* st) {
+    bej_sink_t sink;
+    int err = bej_sink_init_mem(&sink, 256);
+    assert(err == 0);
+    memset(st, 0, sizeof(*st));
+    if (threads) *rc = bej_decode_parallel(&sink, bej, sz, d, threads, st);
+    else {
+        bej_decoder_t dec;
+        bej_decoder_init(&dec, d, &sink);
+        dec.stats = st;
+        *rc = bej_decoder_run(&dec, bej, sz);
+    }
+    char* json = bej_sink_take(&sink, NULL);
+    assert(json);
+    bej_sink_free(&sink);
+    return json;
+}
+
+/* Every thread count gives the serial decoder's return code, bytes and counts. */
+static void same(const bej_dictionary_t* d, const uint8_t* bej, size_t sz) {
+    int want_rc, rc;
+    bej_stats_t want_st, st;
+    char* want = decode(d, bej, sz, 0, &want_rc, &want_st);
+    const int threads[] = { 1, 2, 3, 8, 0 };
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+        char* got = decode(d, bej, sz, threads[i], &rc, &st);
+        assert(rc == want_rc && !strcmp(got, want));
+        st.decode_ns = want_st.decode_ns;
+        assert(!memcmp(&st, &want_st, sizeof(st)));
+        free(got);
+    }
+    free(want);
+}
+
+typedef struct {
+    char* s;
+    size_t len, cap;
+} text_t;
+
+static void put(text_t* t, const char* fmt, ...) {
+    if (t->cap - t->len < 256) {
+        t->cap = t->cap * 2 + 4096;
+        t->s = (char*)realloc(t->s, t->cap);
+        assert(t->s);
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    t->len += (size_t)vsnprintf(t->s + t->len, t->cap - t->len, fmt, ap);
+    va_end(ap);
+}
+
+/* BEJ tuple with a one-byte value: seq/selector, format, length 1, value. */
+static uint8_t* tuple(uint8_t* p, unsigned seq, unsigned sel, uint8_t fmt, uint8_t v) {
+    *p++ = 2; *p++ = (uint8_t)((seq << 1 | sel) & 0xFF); *p++ = (uint8_t)((seq << 1 | sel) >> 8);
+    *p++ = (uint8_t)(fmt << 4); *p++ = 1; *p++ = 1; *p++ = v;
+    return p;
+}
+
+int main(void) {
+    bej_dictionary_t d;
+    int rc = dict_load(EXAMPLES_DIR "/Memory_v1.bin", &d);
+    assert(rc == 0);
+    uint8_t* bej = NULL; size_t sz = 0;
+    rc = read_file_all(EXAMPLES_DIR "/example.bej", &bej, &sz);
+    assert(rc == 0);
+    same(&d, bej, sz);
+    free(bej);
+
+    /* A long array, then an open set of sets (some big enough to split again), in one payload. */
+    text_t t = { 0 };
+    put(&t, "{\"Id\": \"m\", \"AllowedSpeedsMHz\": [0");
+    for (size_t i = 1; i < 60000; ++i) put(&t, ", %zu", i * 7);
+    put(&t, "], \"Oem\": {\"_1\": {\"_1\": [\"v0\"");
+    for (size_t i = 1; i < 40000; ++i) put(&t, ", \"v%zu\\t\\u00e9\"", i);
+    put(&t, "]}");
+    for (size_t i = 2; i < 3000; ++i)
+        put(&t, ", \"_%zu\": {\"_1\": %zu, \"_2\": \"x\\\"y\", \"_3\": [true, null, 1.5]}", i, i);
+    put(&t, "}, \"CapacityMiB\": 4}");
+    bej_encoder_t* enc = bej_encoder_new(&d);
+    rc = bej_encode(enc, t.s, t.len, &bej, &sz);
+    assert(rc == 0);
+    same(&d, bej, sz);
+    /* Damaged payloads fail (and print) exactly as the serial decoder does. */
+    for (size_t cut = sz / 3; cut < sz; cut += sz / 5) same(&d, bej, cut);
+    bej[sz / 2] ^= 0xFF;
+    same(&d, bej, sz);
+    free(bej);
+    bej_encoder_free(enc);
+    free(t.s);
+
+    /* An open set where whole runs are annotations, which print nothing. */
+    size_t n = 60000;
+    bej = (uint8_t*)malloc(7 + 16 + n * 7);
+    assert(bej);
+    uint8_t* p = bej;
+    const uint8_t head[] = { 0, 0xF0, 0xF0, 0xF1, 0, 0, 0,
+        1, 0, BEJ_FMT_SET << 4, 4, 0, 0, 0, 0,          /* root; length patched below */
+        3, 0x60, 0xEA, 0 };                              /* 60000 members */
+    memcpy(p, head, sizeof(head));
+    p += sizeof(head);
+    for (size_t i = 0; i < n; ++i)
+        p = tuple(p, (unsigned)(i % 1000 + 1), (i / 5000) % 2, BEJ_FMT_INTEGER, (uint8_t)i);
+    size_t root_len = (size_t)(p - bej) - 15;
+    bej[11] = (uint8_t)root_len; bej[12] = (uint8_t)(root_len >> 8);
+    bej[13] = (uint8_t)(root_len >> 16); bej[14] = (uint8_t)(root_len >> 24);
+    same(&d, bej, (size_t)(p - bej));
+    free(bej);
+
+    dict_free(&d);
+    return 0;
+}
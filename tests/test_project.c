@@ -0,0 +1,112 @@
+#include "bej_encode.h"
+#include "bej_project.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+/* Decodes @p bej through a projection of @p n pointers; returns the malloc'd JSON. */
+static char* project(const bej_dictionary_t* d, const uint8_t* bej, size_t sz,
+    const char* const* paths, size_t n) {
+    bej_projection_t* proj = NULL;
+    int rc = bej_projection_new(d, paths, n, &proj, NULL);
+    assert(rc == 0);
+    bej_sink_t sink;
+    rc = bej_sink_init_mem(&sink, 256);
+    assert(rc == 0);
+    rc = bej_decode_projected(&sink, bej, sz, d, proj);
+    assert(rc == 0);
+    char* json = bej_sink_take(&sink, NULL);
+    assert(json);
+    bej_sink_free(&sink);
+    bej_projection_free(proj);
+    return json;
+}
+
+static void expect(const bej_dictionary_t* d, const uint8_t* bej, size_t sz,
+    const char* const* paths, size_t n, const char* want) {
+    char* json = project(d, bej, sz, paths, n);
+    if (strcmp(json, want) != 0) fprintf(stderr, "got:\n%s\nwant:\n%s\n", json, want);
+    assert(strcmp(json, want) == 0);
+    free(json);
+}
+
+int main(void) {
+    bej_dictionary_t d;
+    int rc = dict_load(EXAMPLES_DIR "/Memory_v1.bin", &d);
+    assert(rc == 0);
+    uint8_t* bej = NULL; size_t sz = 0;
+    rc = read_file_all(EXAMPLES_DIR "/example.bej", &bej, &sz);
+    assert(rc == 0);
+
+    /* "" and no projection at all both give the full document. */
+    char* full = NULL;
+    rc = bej_decode_to_buffer(bej, sz, &d, &full, NULL);
+    assert(rc == 0);
+    const char* whole[] = { "" };
+    char* json = project(&d, bej, sz, whole, 1);
+    assert(strcmp(json, full) == 0);
+    free(json);
+    json = project(&d, bej, sz, NULL, 0);
+    assert(strcmp(json, "{}") == 0);
+    free(json);
+
+    const char* loc[] = { "/MemoryLocation/Channel" };
+    expect(&d, bej, sz, loc, 1, "{\n  \"MemoryLocation\": {\n    \"Channel\": 0\n  }\n}");
+    /* Document order is kept whatever the order of the pointers. */
+    const char* two[] = { "/MemoryLocation/Slot", "/CapacityMiB" };
+    expect(&d, bej, sz, two, 2,
+        "{\n  \"CapacityMiB\": 65536,\n  \"MemoryLocation\": {\n    \"Slot\": 0\n  }\n}");
+    const char* elem[] = { "/AllowedSpeedsMHz/1" };
+    expect(&d, bej, sz, elem, 1, "{\n  \"AllowedSpeedsMHz\": [\n    3200\n  ]\n}");
+    /* A wider pointer wins over a narrower one below it. */
+    const char* wide[] = { "/MemoryLocation/Slot", "/MemoryLocation" };
+    expect(&d, bej, sz, wide, 2,
+        "{\n  \"MemoryLocation\": {\n    \"Channel\": 0,\n    \"Slot\": 0\n  }\n}");
+    /* Selected properties missing from the payload leave nothing behind. */
+    const char* absent[] = { "/Id", "/AllowedSpeedsMHz/7" };
+    expect(&d, bej, sz, absent, 2, "{\n  \"AllowedSpeedsMHz\": []\n}");
+    free(bej);
+    free(full);
+
+    /* Open sets take "_<seq>" pointers; the result is the full decode of just that part. */
+    bej_encoder_t* enc = bej_encoder_new(&d);
+    const char* part = "{\"Oem\": {\"_6\": {\"_2\": 3}}}";
+    rc = bej_encode(enc, part, strlen(part), &bej, &sz);
+    assert(rc == 0);
+    rc = bej_decode_to_buffer(bej, sz, &d, &full, NULL);
+    assert(rc == 0);
+    free(bej);
+    const char* src = "{\"Id\": \"x\", \"Oem\": {\"_5\": 1, \"_6\": {\"_1\": true, \"_2\": 3}}}";
+    rc = bej_encode(enc, src, strlen(src), &bej, &sz);
+    assert(rc == 0);
+    const char* oem[] = { "/Oem/_6/_2" };
+    expect(&d, bej, sz, oem, 1, full);
+    free(full);
+    /* A pointer running past a leaf in an open set selects nothing there. */
+    const char* past[] = { "/Oem/_5/_1" };
+    expect(&d, bej, sz, past, 1, "{\n  \"Oem\": {}\n}");
+    free(bej);
+    bej_encoder_free(enc);
+
+    /* Pointers that do not resolve are reported by index. */
+    const char* bad[][2] = {
+        { "/Id", "/Nope" }, { "/Id", "Id" }, { "/Id", "/Id/x" }, { "/Id", "/AllowedSpeedsMHz/x" },
+        { "/Id", "/AllowedSpeedsMHz/01" }, { "/Id", "/Memory~2Location" },
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        bej_projection_t* proj = (bej_projection_t*)&d;
+        size_t at = 0;
+        rc = bej_projection_new(&d, bad[i], 2, &proj, &at);
+        assert(rc == -2);
+        assert(proj == NULL && at == 1);
+    }
+    dict_free(&d);
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "bej_push.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+/* Feeds the payload in chunks of @p step bytes; returns the push result. */
+static int push_decode(const bej_dictionary_t* d, const uint8_t* bej, size_t sz, size_t step,
+    char** json, size_t* len) {
+    bej_sink_t sink;
+    int rc = bej_sink_init_mem(&sink, 256);
+    assert(rc == 0);
+    bej_push_t* p = bej_push_new(d, &sink, 0);
+    assert(p);
+    rc = BEJ_PUSH_NEED_MORE;
+    for (size_t off = 0; off < sz && rc == BEJ_PUSH_NEED_MORE; off += step)
+        rc = bej_push_feed(p, bej + off, off + step <= sz ? step : sz - off);
+    if (rc >= 0) rc = bej_push_finish(p);
+    bej_push_free(p);
+    *json = bej_sink_take(&sink, len);
+    bej_sink_free(&sink);
+    return rc;
+}
+
+int main(void) {
+    int rc;
+    const char* dicts[] = { EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/Memory_v1.bin" };
+    const char* payloads[] = { EXAMPLES_DIR "/processor.bej", EXAMPLES_DIR "/example.bej" };
+    for (size_t i = 0; i < 2; ++i) {
+        bej_dictionary_t d;
+        rc = dict_load(dicts[i], &d);
+        assert(rc == 0);
+        uint8_t* bej = NULL; size_t sz = 0;
+        rc = read_file_all(payloads[i], &bej, &sz);
+        assert(rc == 0);
+
+        char* want = NULL; size_t want_len = 0;
+        rc = bej_decode_to_buffer(bej, sz, &d, &want, &want_len);
+        assert(rc == 0);
+
+        /* Every chunk size, so each tuple straddles a boundary at each offset. */
+        for (size_t step = 1; step <= sz; ++step) {
+            char* got = NULL; size_t got_len = 0;
+            rc = push_decode(&d, bej, sz, step, &got, &got_len);
+            assert(rc == 0);
+            assert(got_len == want_len && memcmp(got, want, want_len) == 0);
+            free(got);
+        }
+
+        /* A truncated payload is not an error until the input ends. */
+        for (size_t cut = 0; cut < sz; cut += 7) {
+            char* got = NULL; size_t got_len = 0;
+            rc = push_decode(&d, bej, cut, 3, &got, &got_len);
+            assert(rc == -1);
+            free(got);
+        }
+
+        free(want);
+        free(bej);
+        dict_free(&d);
+    }
+
+    /* Unsupported schema class, and nesting past the depth limit. */
+    bej_dictionary_t d;
+    rc = dict_load(dicts[0], &d);
+    assert(rc == 0);
+    const uint8_t bad_class[] = { 0, 0xF0, 0xF1, 0xF1, 0, 0, 0x07 };
+    char* got = NULL; size_t got_len = 0;
+    rc = push_decode(&d, bad_class, sizeof(bad_class), 1, &got, &got_len);
+    assert(rc == -2);
+    free(got);
+
+    /* A set holding only an annotation prints as an empty object, in both decoders. */
+    const uint8_t annot_only[] = { 0, 0xF0, 0xF0, 0xF1, 0, 0, 0, 1, 0, BEJ_FMT_SET << 4, 1, 8,
+        1, 1, 1, 3, BEJ_FMT_BOOLEAN << 4, 1, 1, 1 };
+    char* full = NULL;
+    rc = bej_decode_to_buffer(annot_only, sizeof(annot_only), &d, &full, NULL);
+    assert(rc == 0);
+    rc = push_decode(&d, annot_only, sizeof(annot_only), 1, &got, &got_len);
+    assert(rc == 0);
+    assert(!strcmp(full, "{}") && !strcmp(got, "{}"));
+    free(full);
+    free(got);
+
+    /* Eight nested one-element arrays: seq 0 | ARRAY | length 0 | count 1. */
+    const uint8_t level[] = { 1, 0, BEJ_FMT_ARRAY << 4, 1, 0, 1, 1 };
+    uint8_t deep[7 + 8 * sizeof(level)] = { 0, 0xF0, 0xF1, 0xF1, 0, 0, 0 };
+    for (size_t k = 7; k < sizeof(deep); k += sizeof(level)) memcpy(deep + k, level, sizeof(level));
+    bej_sink_t sink;
+    rc = bej_sink_init_mem(&sink, 256);
+    assert(rc == 0);
+    bej_push_t* p = bej_push_new(&d, &sink, 4);
+    rc = bej_push_feed(p, deep, sizeof(deep));
+    assert(rc == -3);
+    rc = bej_push_finish(p);
+    assert(rc == -3);
+    bej_push_free(p);
+
+    /* Strings past 2 GiB stream like any other: the first bytes go out as they come. */
+    const uint8_t huge[] = { 0, 0xF0, 0xF1, 0xF1, 0, 0, 0, 1, 0, BEJ_FMT_STRING << 4, 4, 1, 0, 0, 0x80 };
+    uint8_t text[4096];
+    memset(text, 'a', sizeof(text));
+    sink.len = 0;
+    p = bej_push_new(&d, &sink, 0);
+    rc = bej_push_feed(p, huge, sizeof(huge));
+    assert(rc == BEJ_PUSH_NEED_MORE);
+    rc = bej_push_feed(p, text, sizeof(text));
+    assert(rc == BEJ_PUSH_NEED_MORE && sink.len == 1 + sizeof(text));
+    bej_push_free(p);
+    bej_sink_free(&sink);
+    dict_free(&d);
+    return 0;
+}
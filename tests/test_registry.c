@@ -0,0 +1,74 @@
+#include "registry.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+static const char* root_name(const bej_dictionary_t* d) {
+    return dict_entry_name(d, &d->entries[0]);
+}
+
+int main(void) {
+    const char* dicts[] = { EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/Memory_v1.bin" };
+    const char* bundle = "test_registry.bejb";
+    int rc = dict_bundle_write(bundle, dicts, 2);
+    assert(rc == 0);
+
+    /* A 1-byte budget keeps at most the pinned dictionaries resident. */
+    dict_registry_t* r = NULL;
+    rc = dict_registry_open(bundle, 1, &r);
+    assert(rc == 0);
+    dict_registry_stats_t st;
+
+    const bej_dictionary_t* proc = dict_registry_acquire(r, "Processor", 0);
+    assert(proc && !strcmp(root_name(proc), "Processor"));
+    const bej_dictionary_t* same = dict_registry_acquire(r, "Processor", proc->schema_version);
+    assert(same == proc);
+    const bej_dictionary_t* none = dict_registry_acquire(r, "Processor", proc->schema_version + 1);
+    assert(!none);
+    none = dict_registry_acquire(r, "Thermal", 0);
+    assert(!none);
+
+    const bej_dictionary_t* mem = dict_registry_acquire_key(r, "Memory");
+    assert(mem && !strcmp(root_name(mem), "Memory"));
+    dict_registry_stats(r, &st);
+    assert(st.members == 2 && st.resident == 2 && st.evictions == 0);
+
+    /* Processor is pinned twice; the first release keeps it loaded. */
+    dict_registry_release(r, proc);
+    dict_registry_stats(r, &st);
+    assert(st.resident == 2);
+    dict_registry_release(r, proc);
+    dict_registry_stats(r, &st);
+    assert(st.resident == 1 && st.evictions == 1);
+
+    dict_registry_release(r, mem);
+    dict_registry_stats(r, &st);
+    assert(st.resident == 0 && st.evictions == 2);
+
+    dict_registry_close(r);
+
+    rc = dict_registry_open(bundle, 0, &r);
+    assert(rc == 0);
+    mem = dict_registry_acquire(r, "Memory", 0);
+    assert(mem);
+    char key[64];
+    snprintf(key, sizeof(key), "Memory:%x", (unsigned)mem->schema_version);
+    const bej_dictionary_t* by_key = dict_registry_acquire_key(r, key);
+    assert(by_key == mem);
+    /* Bundle members are images: tables and keys are part of the mapped bytes. */
+    assert(mem->tables_borrowed && mem->keys);
+    size_t mem_size = mem->size;
+    dict_registry_release(r, mem);
+    dict_registry_release(r, mem);
+    dict_registry_stats(r, &st);
+    assert(st.resident == 1 && st.loads == 1 && st.resident_bytes == mem_size);
+    dict_registry_close(r);
+
+    remove(bundle);
+    puts("OK");
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "bej_encode.h"
+#include "bej_project.h"
+#include "bej_sax.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+/* Collects events as a compact trace: {n:v,...} with typed markers. */
+typedef struct {
+    char   buf[4096];
+    size_t len;
+    int    events;
+    int    stop_at;     /* stop with 7 on this event (0: never) */
+} trace_t;
+
+static int add(trace_t* t, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(t->buf + t->len, sizeof(t->buf) - t->len, fmt, ap);
+    va_end(ap);
+    assert(n >= 0 && (size_t)n < sizeof(t->buf) - t->len);
+    t->len += (size_t)n;
+    return ++t->events == t->stop_at ? 7 : 0;
+}
+
+static int t_begin_set(void* c, uint64_t n) { (void)n; return add(c, "{"); }
+static int t_end_set(void* c) { return add(c, "}"); }
+static int t_begin_array(void* c, uint64_t n) { return add(c, "[%d:", (int)n); }
+static int t_end_array(void* c) { return add(c, "]"); }
+static int t_name(void* c, const char* s, size_t n, uint16_t seq) {
+    return s ? add(c, "%.*s=", (int)n, s) : add(c, "#%u=", (unsigned)seq);
+}
+static int t_int(void* c, int64_t v) { return add(c, "i%lld,", (long long)v); }
+static int t_real(void* c, const bej_real_t* r) {
+    return add(c, "r%lld/%llu/%llu/%lld,", (long long)r->whole, (unsigned long long)r->leading_zeros,
+        (unsigned long long)r->fract, (long long)r->exp);
+}
+static int t_string(void* c, const char* s, size_t n) { return add(c, "s'%.*s',", (int)n, s); }
+static int t_bool(void* c, bool v) { return add(c, "b%d,", (int)v); }
+static int t_enum(void* c, const char* s, size_t n, uint64_t v) {
+    return s ? add(c, "e%.*s,", (int)n, s) : add(c, "e#%llu,", (unsigned long long)v);
+}
+static int t_null(void* c) { return add(c, "null,"); }
+
+/* Entry callbacks: names come from the resolved entries, tagged to tell them apart. */
+static const bej_dictionary_t* trace_dict;
+static int t_member(void* c, const bej_dict_entry_t* def, uint16_t seq) {
+    return def ? add(c, "%.*s@%u=", (int)def->name_len, dict_entry_name(trace_dict, def), (unsigned)seq)
+        : add(c, "#%u=", (unsigned)seq);
+}
+static int t_enum_entry(void* c, const bej_dict_entry_t* variant, uint64_t v) {
+    return variant ? add(c, "e%.*s@%llu,", (int)variant->name_len, dict_entry_name(trace_dict, variant),
+        (unsigned long long)v) : add(c, "e#%llu,", (unsigned long long)v);
+}
+
+static const bej_sax_t trace_sax = {
+    t_begin_set, t_end_set, t_begin_array, t_end_array, t_name,
+    t_int, t_real, t_string, t_bool, t_enum, t_null, NULL, NULL
+};
+
+int main(void) {
+    bej_dictionary_t d;
+    int rc = dict_load(EXAMPLES_DIR "/Memory_v1.bin", &d);
+    assert(rc == 0);
+    uint8_t* bej = NULL; size_t sz = 0;
+    rc = read_file_all(EXAMPLES_DIR "/example.bej", &bej, &sz);
+    assert(rc == 0);
+
+    /* Typed values, straight from the payload. */
+    trace_t t = { .len = 0 };
+    rc = bej_sax_run(&trace_sax, &t, bej, sz, &d, NULL);
+    assert(rc == 0);
+    assert(!strcmp(t.buf, "{CapacityMiB=i65536,DataWidthBits=i64,AllowedSpeedsMHz=[2:i2400,i3200,]"
+        "ErrorCorrection=eNoECC,MemoryLocation={Channel=i0,Slot=i0,}}"));
+    int total = t.events;
+
+    /* With entry callbacks set, the name and enum_value events are not sent. */
+    bej_sax_t entries = trace_sax;
+    entries.member = t_member;
+    entries.enum_entry = t_enum_entry;
+    trace_dict = &d;
+    trace_t e = { .len = 0 };
+    rc = bej_sax_run(&entries, &e, bej, sz, &d, NULL);
+    assert(rc == 0);
+    assert(!strcmp(e.buf, "{CapacityMiB@4=i65536,DataWidthBits@5=i64,AllowedSpeedsMHz@1=[2:i2400,i3200,]"
+        "ErrorCorrection@9=eNoECC@2,MemoryLocation@19={Channel@0=i0,Slot@2=i0,}}"));
+
+    /* A callback's nonzero return stops the walk and comes back out. */
+    for (int k = 1; k <= total; ++k) {
+        trace_t s = { .len = 0, .stop_at = k };
+        rc = bej_sax_run(&trace_sax, &s, bej, sz, &d, NULL);
+        assert(rc == 7 && s.events == k);
+    }
+
+    /* Missing callbacks are skipped; a table with none just walks the payload. */
+    const bej_sax_t none = { 0 };
+    rc = bej_sax_run(&none, NULL, bej, sz, &d, NULL);
+    assert(rc == 0);
+    rc = bej_sax_run(&none, NULL, bej, sz - 1, &d, NULL);
+    assert(rc == -1);
+
+    /* Projections apply to events as they do to JSON. */
+    const char* paths[] = { "/MemoryLocation/Slot", "/AllowedSpeedsMHz/0" };
+    bej_projection_t* proj = NULL;
+    rc = bej_projection_new(&d, paths, 2, &proj, NULL);
+    assert(rc == 0);
+    trace_t p = { .len = 0 };
+    rc = bej_sax_run(&trace_sax, &p, bej, sz, &d, proj);
+    assert(rc == 0);
+    assert(!strcmp(p.buf, "{AllowedSpeedsMHz=[2:i2400,]MemoryLocation={Slot=i0,}}"));
+    bej_projection_free(proj);
+    free(bej);
+
+    /* Reals, booleans, nulls, negative integers and names missing from the dictionary. */
+    bej_encoder_t* enc = bej_encoder_new(&d);
+    const char* src = "{\"Oem\": {\"_1\": -2.005e3, \"_2\": true, \"_3\": null, \"_4\": -32768}}";
+    rc = bej_encode(enc, src, strlen(src), &bej, &sz);
+    assert(rc == 0);
+    trace_t m = { .len = 0 };
+    rc = bej_sax_run(&trace_sax, &m, bej, sz, &d, NULL);
+    assert(rc == 0);
+    if (strcmp(m.buf, "{Oem={#1=r-2/2/5/3,#2=b1,#3=null,#4=i-32768,}}")) fprintf(stderr, "%s\n", m.buf);
+    assert(!strcmp(m.buf, "{Oem={#1=r-2/2/5/3,#2=b1,#3=null,#4=i-32768,}}"));
+    free(bej);
+    bej_encoder_free(enc);
+    dict_free(&d);
+    return 0;
+}
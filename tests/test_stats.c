@@ -0,0 +1,96 @@
+#include "bej_encode.h"
+#include "bej_stats.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+static int count(const bej_dictionary_t* d, const uint8_t* bej, size_t sz, bej_stats_t* st) {
+    bej_sink_t sink;
+    int rc = bej_sink_init_mem(&sink, 256);
+    assert(rc == 0);
+    bej_decoder_t dec;
+    bej_decoder_init(&dec, d, &sink);
+    dec.stats = st;
+    rc = bej_decoder_run(&dec, bej, sz);
+    bej_sink_free(&sink);
+    return rc;
+}
+
+int main(void) {
+    bej_dictionary_t d;
+    int rc = dict_load(EXAMPLES_DIR "/Memory_v1.bin", &d);
+    assert(rc == 0);
+    uint8_t* bej = NULL; size_t sz = 0;
+    rc = read_file_all(EXAMPLES_DIR "/example.bej", &bej, &sz);
+    assert(rc == 0);
+    bej_stats_t st = { 0 }, zero = { 0 };
+    rc = count(&d, bej, sz, &st);
+    assert(rc == 0);
+    if (!bej_stats_enabled()) {
+        /* Compiled out: nothing is counted, not even time. */
+        assert(!memcmp(&st, &zero, sizeof(st)));
+        free(bej);
+        dict_free(&d);
+        return 0;
+    }
+    /* {CapacityMiB, DataWidthBits, AllowedSpeedsMHz: [2], ErrorCorrection, MemoryLocation: {2}} */
+    assert(st.bytes == sz && st.max_depth == 2 && st.depth == 0);
+    assert(st.tuples[BEJ_FMT_SET] == 2 && st.tuples[BEJ_FMT_ARRAY] == 1);
+    assert(st.tuples[BEJ_FMT_INTEGER] == 6 && st.tuples[BEJ_FMT_ENUM] == 1);
+    assert(st.dict_lookups == 8 && st.dict_misses == 0 && st.annotation_bytes == 0);
+    /* Counts add up over decodes. */
+    bej_stats_t twice = st;
+    rc = count(&d, bej, sz, &twice);
+    assert(rc == 0);
+    assert(twice.bytes == 2 * sz && twice.tuples[BEJ_FMT_INTEGER] == 12 && twice.max_depth == 2);
+    /* Payloads cut off inside a container leave the depth where it was. */
+    for (size_t cut = 1; cut < sz; ++cut) {
+        bej_stats_t part = { 0 };
+        rc = count(&d, bej, cut, &part);
+        assert(rc != 0);
+        assert(part.depth == 0 && part.max_depth <= 2);
+    }
+    free(bej);
+
+    /* Names missing from the dictionary are misses (they print as "_<seq>"). */
+    bej_encoder_t* enc = bej_encoder_new(&d);
+    const char* src = "{\"Oem\": {\"_5\": 1, \"_6\": [true]}, \"ErrorCorrection\": \"NoECC\"}";
+    rc = bej_encode(enc, src, strlen(src), &bej, &sz);
+    assert(rc == 0);
+    memset(&st, 0, sizeof(st));
+    rc = count(&d, bej, sz, &st);
+    assert(rc == 0);
+    assert(st.max_depth == 3 && st.dict_lookups == 5 && st.dict_misses == 2);
+    free(bej);
+    bej_encoder_free(enc);
+
+    /* A set holding one annotation: its 6-byte tuple is skipped and counted. */
+    const uint8_t annot[] = { 0, 0xF0, 0xF0, 0xF1, 0, 0, 0, 1, 0, BEJ_FMT_SET << 4, 1, 8,
+        1, 1, 1, 3, BEJ_FMT_BOOLEAN << 4, 1, 1, 1 };
+    memset(&st, 0, sizeof(st));
+    rc = count(&d, annot, sizeof(annot), &st);
+    assert(rc == 0);
+    assert(st.annotation_bytes == 6 && st.tuples[BEJ_FMT_BOOLEAN] == 0 && st.dict_lookups == 0);
+
+    /* The JSON report. */
+    FILE* f = tmpfile();
+    assert(f);
+    rc = bej_stats_write_json(f, &st);
+    assert(rc == 0);
+    char buf[512];
+    rewind(f);
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[n] = '\0';
+    fclose(f);
+    assert(!strncmp(buf, "{\"enabled\": true, \"bytes\": 20, \"tuples\": {\"set\": 1}, ", 52));
+    assert(strstr(buf, "\"annotation_bytes\": 6, \"max_depth\": 1, \"time_ns\": {") && buf[n - 1] == '\n');
+    dict_free(&d);
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "bej_encode.h"
+#include "dict.h"
+#include "io.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "examples"
+#endif
+
+static int validate_json(const bej_dictionary_t* d, bej_encoder_t* enc, const char* json, size_t* off) {
+    uint8_t* bej = NULL; size_t sz = 0;
+    int rc = bej_encode(enc, json, strlen(json), &bej, &sz);
+    assert(rc == 0);
+    rc = bej_validate(bej, sz, d, off);
+    free(bej);
+    return rc;
+}
+
+int main(void) {
+    int rc;
+    const char* dicts[] = { EXAMPLES_DIR "/Processor_v1.bin", EXAMPLES_DIR "/Memory_v1.bin" };
+    const char* payloads[] = { EXAMPLES_DIR "/processor.bej", EXAMPLES_DIR "/example.bej" };
+    for (size_t i = 0; i < 2; ++i) {
+        bej_dictionary_t d;
+        rc = dict_load(dicts[i], &d);
+        assert(rc == 0);
+        uint8_t* bej = NULL; size_t sz = 0;
+        rc = read_file_all(payloads[i], &bej, &sz);
+        assert(rc == 0);
+        size_t off = 99;
+        rc = bej_validate(bej, sz, &d, &off);
+        assert(rc == 0);
+
+        /* Any truncation is caught, at or before the cut. */
+        for (size_t cut = 0; cut < sz; ++cut) {
+            rc = bej_validate(bej, cut, &d, &off);
+            assert(rc == -1);
+            assert(off <= cut);
+        }
+        /* So is a root length that does not match its contents. */
+        bej[11]++;
+        rc = bej_validate(bej, sz, &d, &off);
+        assert(rc == -1);
+        bej[11] -= 2;
+        rc = bej_validate(bej, sz, &d, &off);
+        assert(rc == -1);
+        bej[11]++;
+        bej[6] = 0x07;
+        rc = bej_validate(bej, sz, &d, &off);
+        assert(rc == -2 && off == 6);
+        free(bej);
+        dict_free(&d);
+    }
+
+    bej_dictionary_t d;
+    rc = dict_load(dicts[1], &d);
+    assert(rc == 0);
+    bej_encoder_t* enc = bej_encoder_new(&d);
+    size_t off = 0;
+    rc = validate_json(&d, enc, "{\"Id\": \"x\", \"Oem\": {\"_5\": 1}, \"AllowedSpeedsMHz\": [1, 2]}", &off);
+    assert(rc == 0);
+
+    /* The decoder renders these as "_<seq>" or numbers; validation rejects them. */
+    rc = validate_json(&d, enc, "{\"Id\": \"x\", \"_900\": 1}", &off);
+    assert(rc == -3);
+    assert(off == 7 + 5 + 2 + 7);     /* header, root SFL, count, "Id" tuple */
+    rc = validate_json(&d, enc, "{\"MemoryLocation\": {\"_77\": 1}}", &off);
+    assert(rc == -3);
+
+    /* An enum value outside the entry's variants. */
+    uint8_t* bej = NULL; size_t sz = 0;
+    rc = bej_encode(enc, "{\"ErrorCorrection\": \"NoECC\"}", 28, &bej, &sz);
+    assert(rc == 0);
+    rc = bej_validate(bej, sz, &d, &off);
+    assert(rc == 0);
+    bej[sz - 1] = 0x7F;
+    rc = bej_validate(bej, sz, &d, &off);
+    assert(rc == -3 && off == 7 + 5 + 2);
+    free(bej);
+
+    bej_encoder_free(enc);
+    dict_free(&d);
+    return 0;
+}
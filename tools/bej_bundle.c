@@ -0,0 +1,20 @@
+/** @file bej_bundle.c
+ *  @brief Bundle builder: bej_bundle <out.bejb> <schema_dict.bin>...
+ *
+ *  Each dictionary is compiled and keyed by its root entry name and schema version.
+ */
+
+#include "registry.h"
+#include <stdio.h>
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage:\n  %s <out.bejb> <schema_dict.bin>...\n", argv[0]);
+        return 2;
+    }
+    if (dict_bundle_write(argv[1], (const char* const*)(argv + 2), (size_t)(argc - 2)) != 0) {
+        fprintf(stderr, "Failed to write bundle: %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
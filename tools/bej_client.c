@@ -0,0 +1,66 @@
+/** @file bej_client.c
+ *  @brief Daemon client: bej_client -L <socket> [-d <schema>] -b <payload.bej> [-o <out.json>]
+ */
+
+#include "daemon.h"
+#include "io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage:\n"
+        "  %s -L <socket> [-d <schema[:version]>] -b <payload.bej> [-o <out.json>]\n"
+        "Options:\n"
+        "  -L   Socket of a daemon started with bej2json -L\n"
+        "  -d   Schema to decode with, when the daemon serves a bundle\n"
+        "  -b   Path to BEJ-encoded payload (\"-\" reads stdin)\n"
+        "  -o   Output JSON file (default: stdout)\n", prog);
+}
+
+int main(int argc, char** argv) {
+    const char* socket_path = NULL;
+    const char* schema = NULL;
+    const char* bej_path = NULL;
+    const char* out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-L") && i + 1 < argc) socket_path = argv[++i];
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc) schema = argv[++i];
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) bej_path = argv[++i];
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) out_path = argv[++i];
+        else { usage(argv[0]); return 2; }
+    }
+    if (!socket_path || !bej_path) { usage(argv[0]); return 2; }
+
+    const uint8_t* bej = NULL; size_t bej_sz = 0; int bej_mapped = 0;
+    if (map_file_all(bej_path, &bej, &bej_sz, &bej_mapped) != 0) {
+        fprintf(stderr, "Failed to read BEJ payload: %s\n", bej_path);
+        return 1;
+    }
+    int fd = bejd_connect(socket_path);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot connect to %s\n", socket_path);
+        unmap_file_all(bej, bej_sz, bej_mapped);
+        return 1;
+    }
+
+    bejd_reply_t reply = { 0 };
+    int rc = bejd_request(fd, schema, bej, bej_sz, &reply);
+    close(fd);
+    unmap_file_all(bej, bej_sz, bej_mapped);
+    if (rc != 0) fprintf(stderr, "No reply from %s\n", socket_path);
+    else if (reply.status != 0) {
+        fprintf(stderr, "Decode failed (code %d) at offset %u: %s\n", (int)reply.status, (unsigned)reply.offset, reply.body);
+        rc = -1;
+    }
+    else if (out_path ? write_file_all(out_path, reply.body, reply.len) != 0
+        : fwrite(reply.body, 1, reply.len, stdout) != reply.len) {
+        fprintf(stderr, "Cannot write output: %s\n", out_path ? out_path : "(stdout)");
+        rc = -1;
+    }
+    bejd_reply_free(&reply);
+    return rc == 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+/** @file bej_dict2c.c
+ *  @brief Dictionary to C: bej_dict2c <schema_dict.bin> <symbol> <out.c> <out.h>
+ *
+ *  Loads a dictionary (raw or compiled) and writes its resolved tables as
+ *  static const arrays: entries, seq lookup tables, name pool and JSON keys,
+ *  with a bej_dictionary_t named @p symbol over them. Linked into a program,
+ *  the dictionary is ready without any file I/O or parsing, and the tables
+ *  sit in read-only data. See bej_embed_dictionary() in CMakeLists.txt.
+ */
+
+#include "dict.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+/* Bytes as one line of a string literal; anything but plain ASCII as octal. */
+static void put_literal(FILE* f, const char* p, size_t n) {
+    fputs("    \"", f);
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)p[i];
+        if (c == '"' || c == '\\') { fputc('\\', f); fputc(c, f); }
+        else if (c >= 0x20 && c < 0x7F && c != '?') fputc(c, f);
+        else fprintf(f, "\\%03o", (unsigned)c);
+    }
+    fputs("\"\n", f);
+}
+
+static int write_source(FILE* f, const bej_dictionary_t* d, const char* sym,
+    const char* src_name, const char* hdr_name) {
+    /* Names are packed into a pool of their own: a raw dictionary's offsets
+     * point into the whole file. Offset 0 stays the "unnamed" marker. */
+    uint32_t* name_off = (uint32_t*)calloc(d->entry_count ? d->entry_count : 1, sizeof(uint32_t));
+    if (!name_off) return -1;
+    size_t names_size = 1;
+    for (uint16_t i = 0; i < d->entry_count; ++i) {
+        if (!d->entries[i].name_off) continue;
+        name_off[i] = (uint32_t)names_size;
+        names_size += (size_t)d->entries[i].name_len + 1;
+    }
+
+    fprintf(f, "/* Generated by bej_dict2c from %s; do not edit. */\n\n#include \"%s\"\n\n", src_name, hdr_name);
+
+    if (d->entry_count) {
+        fprintf(f, "static const bej_dict_entry_t %s_entries[%u] = {\n", sym, (unsigned)d->entry_count);
+        fprintf(f, "    /* format, flags, seq, child_first_idx, child_count, name_len, name_off */\n");
+        for (uint16_t i = 0; i < d->entry_count; ++i) {
+            const bej_dict_entry_t* e = &d->entries[i];
+            fprintf(f, "    { %u, %u, %u, %ld, %u, %u, %lu },\n", (unsigned)e->format, (unsigned)e->flags,
+                (unsigned)e->seq, (long)e->child_first_idx, (unsigned)e->child_count, (unsigned)e->name_len,
+                (unsigned long)name_off[i]);
+        }
+        fprintf(f, "};\n\n");
+    }
+
+    fprintf(f, "static const char %s_names[] =\n    \"\\000\"\n", sym);
+    for (uint16_t i = 0; i < d->entry_count; ++i) {
+        const bej_dict_entry_t* e = &d->entries[i];
+        if (e->name_off) put_literal(f, dict_entry_name(d, e), (size_t)e->name_len + 1);
+    }
+    fprintf(f, "    ;\n\n");
+
+    if (d->seq_index && d->entry_count) {
+        fprintf(f, "static const bej_seq_index_t %s_seq_index[%u] = {\n", sym, (unsigned)d->entry_count);
+        fprintf(f, "    /* kind, reserved, span, off */\n");
+        for (uint16_t i = 0; i < d->entry_count; ++i) {
+            const bej_seq_index_t* ix = &d->seq_index[i];
+            fprintf(f, "    { %u, { 0, 0, 0 }, %lu, %lu },\n", (unsigned)ix->kind,
+                (unsigned long)ix->span, (unsigned long)ix->off);
+        }
+        fprintf(f, "};\n\n");
+    }
+    if (d->seq_pool_len) {
+        fprintf(f, "static const uint16_t %s_seq_pool[%zu] = {\n", sym, d->seq_pool_len);
+        for (size_t i = 0; i < d->seq_pool_len; ++i)
+            fprintf(f, "%s%u,%s", i % 16 ? " " : "    ", (unsigned)d->seq_pool[i],
+                i % 16 == 15 || i + 1 == d->seq_pool_len ? "\n" : "");
+        fprintf(f, "};\n\n");
+    }
+
+    if (d->key_off) {
+        fprintf(f, "static const uint32_t %s_key_off[%u] = {\n", sym, (unsigned)d->entry_count + 1);
+        for (size_t i = 0; i <= d->entry_count; ++i)
+            fprintf(f, "%s%lu,%s", i % 16 ? " " : "    ", (unsigned long)d->key_off[i],
+                i % 16 == 15 || i == d->entry_count ? "\n" : "");
+        fprintf(f, "};\n\n");
+        fprintf(f, "static const char %s_keys[] =\n    \"\"\n", sym);
+        for (uint16_t i = 0; i < d->entry_count; ++i)
+            if (d->key_off[i + 1] > d->key_off[i])
+                put_literal(f, d->keys + d->key_off[i], d->key_off[i + 1] - d->key_off[i]);
+        fprintf(f, "    ;\n\n");
+    }
+
+    fprintf(f, "const bej_dictionary_t %s = {\n", sym);
+    fprintf(f, "    .bytes_borrowed = 1,\n    .tables_borrowed = 1,\n");
+    fprintf(f, "    .version_tag = %u,\n    .dict_flags = %u,\n    .entry_count = %u,\n",
+        (unsigned)d->version_tag, (unsigned)d->dict_flags, (unsigned)d->entry_count);
+    fprintf(f, "    .schema_version = 0x%08lxu,\n    .dict_size = %lu,\n    .identity = 0x%016llxull,\n",
+        (unsigned long)d->schema_version, (unsigned long)d->dict_size, (unsigned long long)d->identity);
+    if (d->entry_count) fprintf(f, "    .entries = %s_entries,\n", sym);
+    fprintf(f, "    .names = %s_names,\n", sym);
+    if (d->key_off) fprintf(f, "    .keys = %s_keys,\n    .key_off = %s_key_off,\n", sym, sym);
+    if (d->seq_index && d->entry_count) fprintf(f, "    .seq_index = %s_seq_index,\n", sym);
+    if (d->seq_pool_len) fprintf(f, "    .seq_pool = %s_seq_pool,\n    .seq_pool_len = %zu,\n", sym, d->seq_pool_len);
+    fprintf(f, "    .header_size = %lu,\n    .entry_size = %lu\n};\n",
+        (unsigned long)d->header_size, (unsigned long)d->entry_size);
+    free(name_off);
+    return ferror(f) ? -1 : 0;
+}
+
+static int write_header(FILE* f, const char* sym, const char* src_name) {
+    char guard[128];
+    size_t n = 0;
+    for (const char* s = sym; *s && n + 3 < sizeof(guard); ++s) guard[n++] = (char)toupper((unsigned char)*s);
+    memcpy(guard + n, "_H", 3);
+    fprintf(f, "/* Generated by bej_dict2c from %s; do not edit. */\n\n", src_name);
+    fprintf(f, "#ifndef %s\n#define %s\n\n#include \"bej.h\"\n\n", guard, guard);
+    fprintf(f, "/** %s, built in: ready without loading. Not for dict_free. */\n", src_name);
+    fprintf(f, "extern const bej_dictionary_t %s;\n\n#endif /* %s */\n", sym, guard);
+    return ferror(f) ? -1 : 0;
+}
+
+static int valid_symbol(const char* s) {
+    if (!*s || isdigit((unsigned char)*s)) return 0;
+    for (; *s; ++s) if (!isalnum((unsigned char)*s) && *s != '_') return 0;
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 5 || !valid_symbol(argv[2])) {
+        fprintf(stderr, "Usage:\n  %s <schema_dict.bin> <symbol> <out.c> <out.h>\n", argv[0]);
+        return 2;
+    }
+    bej_dictionary_t dict = { 0 };
+    if (dict_load(argv[1], &dict) != 0) {
+        fprintf(stderr, "Failed to load dictionary: %s\n", argv[1]);
+        dict_free(&dict);
+        return 1;
+    }
+
+    int rc = 0;
+    const char* src_name = base_name(argv[1]);
+    FILE* c = fopen(argv[3], "w");
+    FILE* h = fopen(argv[4], "w");
+    if (!c || !h) rc = -1;
+    else {
+        rc = write_source(c, &dict, argv[2], src_name, base_name(argv[4]));
+        if (rc == 0) rc = write_header(h, argv[2], src_name);
+    }
+    if (c && fclose(c) != 0) rc = -1;
+    if (h && fclose(h) != 0) rc = -1;
+    dict_free(&dict);
+    if (rc != 0) {
+        fprintf(stderr, "Cannot write output: %s, %s\n", argv[3], argv[4]);
+        remove(argv[3]);
+        remove(argv[4]);
+        return 1;
+    }
+    return 0;
+}
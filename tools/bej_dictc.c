@@ -0,0 +1,45 @@
+/** @file bej_dictc.c
+ *  @brief Dictionary compiler: bej_dictc <schema_dict.bin> <out.bejdc>
+ *
+ *  Writes a compiled image that dict_load maps and uses in place.
+ */
+
+#include "dict.h"
+#include "io.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage:\n  %s <schema_dict.bin> <out.bejdc>\n", argv[0]);
+        return 2;
+    }
+
+    bej_dictionary_t dict = { 0 };
+    if (dict_load(argv[1], &dict) != 0) {
+        fprintf(stderr, "Failed to load dictionary: %s\n", argv[1]);
+        dict_free(&dict);
+        return 1;
+    }
+
+    uint8_t* image = NULL; size_t image_sz = 0;
+    int rc = dict_image_build(&dict, &image, &image_sz);
+    dict_free(&dict);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to compile dictionary: %s\n", argv[1]);
+        return 1;
+    }
+    if (write_file_all(argv[2], (const char*)image, image_sz) != 0) {
+        fprintf(stderr, "Cannot write output: %s\n", argv[2]);
+        free(image);
+        return 1;
+    }
+    free(image);
+
+    if (dict_load(argv[2], &dict) != 0) {
+        fprintf(stderr, "Compiled image does not load back: %s\n", argv[2]);
+        return 1;
+    }
+    dict_free(&dict);
+    return 0;
+}
@@ -0,0 +1,62 @@
+/** @file json2bej.c
+ *  @brief Encoder CLI: json2bej -s <schema.bin> -j <in.json> -o <out.bej>
+ */
+
+#include "bej_encode.h"
+#include "dict.h"
+#include "io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage:\n"
+        "  %s -s <schema_dict.bin> -j <in.json> -o <out.bej>\n"
+        "Options:\n"
+        "  -s   Path to major schema binary dictionary (.bin or compiled .bejdc)\n"
+        "  -j   JSON document to encode (\"-\" reads stdin)\n"
+        "  -o   Output BEJ payload\n", prog);
+}
+
+int main(int argc, char** argv) {
+    const char* dict_path = NULL;
+    const char* json_path = NULL;
+    const char* out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) dict_path = argv[++i];
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc) json_path = argv[++i];
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) out_path = argv[++i];
+        else { usage(argv[0]); return 2; }
+    }
+    if (!dict_path || !json_path || !out_path) { usage(argv[0]); return 2; }
+
+    bej_dictionary_t dict = { 0 };
+    if (dict_load(dict_path, &dict) != 0) {
+        fprintf(stderr, "Failed to load dictionary: %s\n", dict_path);
+        return 1;
+    }
+    uint8_t* json = NULL; size_t json_sz = 0;
+    if (read_file_all(json_path, &json, &json_sz) != 0) {
+        fprintf(stderr, "Failed to read JSON: %s\n", json_path);
+        dict_free(&dict);
+        return 1;
+    }
+
+    bej_encoder_t* enc = bej_encoder_new(&dict);
+    uint8_t* bej = NULL; size_t bej_sz = 0;
+    int rc = enc ? bej_encode(enc, (const char*)json, json_sz, &bej, &bej_sz) : -1;
+    if (rc != 0) {
+        fprintf(stderr, "Encode failed (code %d) at offset %zu\n", rc, enc ? bej_encoder_offset(enc) : (size_t)0);
+    }
+    else if (write_file_all(out_path, (const char*)bej, bej_sz) != 0) {
+        fprintf(stderr, "Cannot write output: %s\n", out_path);
+        rc = -1;
+    }
+    free(bej);
+    bej_encoder_free(enc);
+    free(json);
+    dict_free(&dict);
+    return rc == 0 ? 0 : 1;
+}